@@ -0,0 +1,234 @@
+#include <atomic>
+#include <cstdlib>
+#include <functional>
+#include <mutex>
+#include <new>
+#include <unordered_map>
+
+#include "AllocationCounter.h"
+
+/* Allocator for the bookkeeping containers. It must not call operator
+new, which would recurse into the counter. */
+template <class T>
+struct MallocAllocator
+{
+	using value_type = T;
+
+	MallocAllocator() = default;
+	template <class U>
+	MallocAllocator(const MallocAllocator<U>&) {}
+
+	T* allocate(size_t n)
+	{
+		void* pointer = std::malloc(n * sizeof(T));
+		if (pointer == nullptr) throw std::bad_alloc();
+		return static_cast<T*>(pointer);
+	}
+	void deallocate(T* pointer, size_t) { std::free(pointer); }
+};
+
+template <class T, class U>
+bool operator==(const MallocAllocator<T>&, const MallocAllocator<U>&)
+{
+	return true;
+}
+template <class T, class U>
+bool operator!=(const MallocAllocator<T>&, const MallocAllocator<U>&)
+{
+	return false;
+}
+
+/* Live blocks allocated while subsystem tracking is on. The table is
+split in shards with their own locks to reduce contention between
+threads. */
+struct BlockInfo {
+	size_t size;
+	AllocationCounter::Subsystem subsystem;
+};
+using BlockMap = std::unordered_map<void*, BlockInfo, std::hash<void*>,
+	std::equal_to<void*>,
+	MallocAllocator<std::pair<void* const, BlockInfo>>>;
+struct BlockTableShard {
+	std::mutex mutex;
+	BlockMap blocks;
+};
+static const size_t n_shards{ 64 };
+
+struct SubsystemCounters {
+	std::atomic<uint64_t> n_allocations{ 0 };
+	std::atomic<uint64_t> n_deallocations{ 0 };
+	std::atomic<uint64_t> allocated_bytes{ 0 };
+	std::atomic<uint64_t> current_bytes{ 0 };
+	std::atomic<uint64_t> peak_bytes{ 0 };
+};
+
+static std::atomic<uint64_t> n_allocations{ 0 };
+static std::atomic<uint64_t> n_deallocations{ 0 };
+static std::atomic<uint64_t> allocated_bytes{ 0 };
+
+static std::atomic<bool> is_tracking{ false };
+/* Never destroyed, since blocks may be freed during static destruction */
+static BlockTableShard* block_table{ nullptr };
+static SubsystemCounters
+	subsystem_counters[AllocationCounter::n_subsystems];
+static thread_local AllocationCounter::Subsystem current_subsystem{
+	AllocationCounter::Subsystem::other };
+
+static BlockTableShard& find_shard(void* pointer)
+{
+	uintptr_t address = reinterpret_cast<uintptr_t>(pointer);
+	return block_table[((address >> 4) * 0x9E3779B97F4A7C15ULL >> 58)
+		% n_shards];
+}
+
+AllocationCounter::Scope::Scope(Subsystem subsystem) :
+	previous_subsystem{ current_subsystem }
+{
+	current_subsystem = subsystem;
+}
+
+AllocationCounter::Scope::~Scope()
+{
+	current_subsystem = previous_subsystem;
+}
+
+AllocationCounter::Counts AllocationCounter::get_counts()
+{
+	Counts counts;
+	counts.n_allocations = n_allocations.load(std::memory_order_relaxed);
+	counts.n_deallocations = n_deallocations.load(std::memory_order_relaxed);
+	counts.allocated_bytes = allocated_bytes.load(std::memory_order_relaxed);
+	return counts;
+}
+
+void AllocationCounter::start_subsystem_tracking()
+{
+	if (is_tracking_subsystems()) return;
+	void* memory = std::malloc(n_shards * sizeof(BlockTableShard));
+	if (memory == nullptr) return;
+	block_table = static_cast<BlockTableShard*>(memory);
+	for (size_t i = 0; i < n_shards; i++)
+	{
+		new (&block_table[i]) BlockTableShard();
+	}
+	is_tracking.store(true, std::memory_order_release);
+}
+
+bool AllocationCounter::is_tracking_subsystems()
+{
+	return is_tracking.load(std::memory_order_acquire);
+}
+
+AllocationCounter::SubsystemCounts AllocationCounter::get_subsystem_counts(
+	Subsystem subsystem)
+{
+	const SubsystemCounters& counters =
+		subsystem_counters[static_cast<int>(subsystem)];
+	SubsystemCounts counts;
+	counts.n_allocations = counters.n_allocations.load();
+	counts.n_deallocations = counters.n_deallocations.load();
+	counts.allocated_bytes = counters.allocated_bytes.load();
+	counts.current_bytes = counters.current_bytes.load();
+	counts.peak_bytes = counters.peak_bytes.load();
+	return counts;
+}
+
+void AllocationCounter::reset_subsystem_peaks()
+{
+	for (SubsystemCounters& counters : subsystem_counters)
+	{
+		counters.peak_bytes.store(
+			counters.current_bytes.load(std::memory_order_relaxed),
+			std::memory_order_relaxed);
+	}
+}
+
+std::string AllocationCounter::subsystem_to_string(Subsystem subsystem)
+{
+	switch (subsystem)
+	{
+	case Subsystem::other:
+		return "other";
+	case Subsystem::vehicle_objects:
+		return "vehicle objects";
+	case Subsystem::histories:
+		return "histories";
+	case Subsystem::nearby_vehicles:
+		return "nearby vehicles";
+	case Subsystem::controllers:
+		return "controllers";
+	case Subsystem::logging:
+		return "logging";
+	case Subsystem::signal_tables:
+		return "signal tables";
+	default:
+		return "unknown subsystem";
+	}
+}
+
+void AllocationCounter::add_allocation(void* pointer, size_t size)
+{
+	n_allocations.fetch_add(1, std::memory_order_relaxed);
+	allocated_bytes.fetch_add(size, std::memory_order_relaxed);
+	if (!is_tracking_subsystems()) return;
+
+	Subsystem subsystem = current_subsystem;
+	{
+		BlockTableShard& shard = find_shard(pointer);
+		std::lock_guard<std::mutex> lock(shard.mutex);
+		shard.blocks[pointer] = { size, subsystem };
+	}
+	SubsystemCounters& counters =
+		subsystem_counters[static_cast<int>(subsystem)];
+	counters.n_allocations.fetch_add(1, std::memory_order_relaxed);
+	counters.allocated_bytes.fetch_add(size, std::memory_order_relaxed);
+	uint64_t current_bytes = counters.current_bytes.fetch_add(size,
+		std::memory_order_relaxed) + size;
+	uint64_t peak_bytes = counters.peak_bytes.load(std::memory_order_relaxed);
+	while (current_bytes > peak_bytes
+		&& !counters.peak_bytes.compare_exchange_weak(peak_bytes,
+			current_bytes, std::memory_order_relaxed)) {}
+}
+
+void AllocationCounter::add_deallocation(void* pointer)
+{
+	n_deallocations.fetch_add(1, std::memory_order_relaxed);
+	if (!is_tracking_subsystems()) return;
+
+	BlockInfo block;
+	{
+		BlockTableShard& shard = find_shard(pointer);
+		std::lock_guard<std::mutex> lock(shard.mutex);
+		BlockMap::iterator it = shard.blocks.find(pointer);
+		/* Allocated before tracking started or by another module */
+		if (it == shard.blocks.end()) return;
+		block = it->second;
+		shard.blocks.erase(it);
+	}
+	SubsystemCounters& counters =
+		subsystem_counters[static_cast<int>(block.subsystem)];
+	counters.n_deallocations.fetch_add(1, std::memory_order_relaxed);
+	counters.current_bytes.fetch_sub(block.size, std::memory_order_relaxed);
+}
+
+/* The array and nothrow versions of the operators call these ones */
+
+void* operator new(size_t size)
+{
+	void* pointer = std::malloc(size > 0 ? size : 1);
+	if (pointer == nullptr) throw std::bad_alloc();
+	AllocationCounter::add_allocation(pointer, size);
+	return pointer;
+}
+
+void operator delete(void* pointer) noexcept
+{
+	if (pointer == nullptr) return;
+	AllocationCounter::add_deallocation(pointer);
+	std::free(pointer);
+}
+
+void operator delete(void* pointer, size_t) noexcept
+{
+	operator delete(pointer);
+}
@@ -0,0 +1,82 @@
+/*==========================================================================*/
+/*  AllocationCounter.h														*/
+/*  Counts the dynamic memory allocations made by the DLL					*/
+/*                                                                          */
+/*  Version of 2022-06	                              Fernando V. Monteiro  */
+/*==========================================================================*/
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+/* The DLL replaces the global operator new and operator delete (see
+AllocationCounter.cpp) to count every allocation made by its code. The
+global counters are cumulative since the DLL was loaded.
+
+Allocations can also be attributed to subsystems. Code that allocates on
+behalf of a subsystem opens a Scope, and every allocation made by the same
+thread while the scope exists is counted for that subsystem. Deallocations
+are counted for the subsystem that made the allocation, wherever they
+happen, so the current and peak usage of each subsystem are known. Peaks
+are since the start of the current run (see reset_subsystem_peaks). Since
+this requires keeping a table of all live blocks, subsystem tracking is
+off unless start_subsystem_tracking is called. */
+class AllocationCounter
+{
+public:
+	enum class Subsystem {
+		other,
+		vehicle_objects,
+		histories,
+		nearby_vehicles,
+		controllers,
+		logging,
+		signal_tables,
+	};
+	static const int n_subsystems{ 7 };
+
+	struct Counts {
+		uint64_t n_allocations{ 0 };
+		uint64_t n_deallocations{ 0 };
+		uint64_t allocated_bytes{ 0 };
+	};
+
+	struct SubsystemCounts {
+		uint64_t n_allocations{ 0 };
+		uint64_t n_deallocations{ 0 };
+		uint64_t allocated_bytes{ 0 }; // cumulative
+		uint64_t current_bytes{ 0 };
+		uint64_t peak_bytes{ 0 };
+	};
+
+	/* Allocations made by this thread while the scope exists are
+	attributed to the given subsystem. Scopes can be nested. */
+	class Scope
+	{
+	public:
+		explicit Scope(Subsystem subsystem);
+		~Scope();
+		Scope(const Scope&) = delete;
+		Scope& operator=(const Scope&) = delete;
+
+	private:
+		Subsystem previous_subsystem;
+	};
+
+	static Counts get_counts();
+
+	/* Blocks allocated before this call are not attributed to any
+	subsystem */
+	static void start_subsystem_tracking();
+	static bool is_tracking_subsystems();
+	static SubsystemCounts get_subsystem_counts(Subsystem subsystem);
+	/* Starts the peak of each subsystem again from its current usage.
+	Called when a simulation run ends. */
+	static void reset_subsystem_peaks();
+	static std::string subsystem_to_string(Subsystem subsystem);
+
+	/* Used by the replaced operators only */
+	static void add_allocation(void* pointer, size_t size);
+	static void add_deallocation(void* pointer);
+};
@@ -0,0 +1,105 @@
+#include <algorithm>
+
+#include "ApproachQueueIndex.h"
+#include "Constants.h"
+
+void ApproachQueueIndex::update(int traffic_light_id, const Entry& entry)
+{
+	if (traffic_light_id == 0)
+	{
+		index.remove(entry.id);
+		return;
+	}
+	index.update(traffic_light_id, entry);
+}
+
+void ApproachQueueIndex::remove(long id)
+{
+	index.remove(id);
+}
+
+void ApproachQueueIndex::start_step(double time,
+	const std::unordered_map<int, TrafficLight>& traffic_lights)
+{
+	if (time == current_time) return;
+	double data_time = current_time;
+	current_time = time;
+	index.apply_updates(
+		[&](int traffic_light_id, const std::vector<Entry>& entries) {
+			compute_queue(traffic_light_id, entries, traffic_lights);
+			queues[traffic_light_id].time = data_time;
+		});
+}
+
+void ApproachQueueIndex::clear()
+{
+	index.clear();
+	queues.clear();
+	current_time = -1.0;
+}
+
+const ApproachQueueIndex::Queue& ApproachQueueIndex::get_queue(
+	int traffic_light_id) const
+{
+	static const Queue empty_queue;
+	std::unordered_map<int, Queue>::const_iterator queue =
+		queues.find(traffic_light_id);
+	return queue == queues.end() ? empty_queue : queue->second;
+}
+
+const std::vector<ApproachQueueIndex::Entry>&
+ApproachQueueIndex::get_approaching_vehicles(int traffic_light_id) const
+{
+	static const std::vector<Entry> no_vehicles;
+	const std::vector<Entry>* entries = index.find_group(traffic_light_id);
+	return entries == nullptr ? no_vehicles : *entries;
+}
+
+long ApproachQueueIndex::get_n_vehicles_ahead(long id) const
+{
+	const Index::Location* location = index.find_location(id);
+	return location == nullptr ? -1 : static_cast<long>(location->index);
+}
+
+void ApproachQueueIndex::compute_queue(int traffic_light_id,
+	const std::vector<Entry>& entries,
+	const std::unordered_map<int, TrafficLight>& traffic_lights)
+{
+	Queue& queue = queues[traffic_light_id];
+	queue = Queue();
+	for (const Entry& entry : entries)
+	{
+		if (entry.velocity >= STOPPED_VELOCITY
+			|| entry.distance - queue.length > max_queue_gap) break;
+		queue.n_vehicles++;
+		queue.length = entry.distance + entry.length;
+		queue.last_vehicle_id = entry.id;
+	}
+	if (queue.n_vehicles == 0) return;
+
+	/* The queue starts moving a start-up lost time after the light turns
+	green */
+	double discharge_start = current_time + startup_lost_time;
+	std::unordered_map<int, TrafficLight>::const_iterator traffic_light =
+		traffic_lights.find(traffic_light_id);
+	if (traffic_light != traffic_lights.end())
+	{
+		const TrafficLight& light = traffic_light->second;
+		switch (light.get_current_state())
+		{
+		case TrafficLight::State::green:
+			discharge_start = std::max(current_time,
+				light.get_time_of_last_green() + startup_lost_time);
+			break;
+		case TrafficLight::State::red:
+		case TrafficLight::State::amber:
+			discharge_start = light.get_time_of_next_green()
+				+ startup_lost_time;
+			break;
+		default:
+			break;
+		}
+	}
+	queue.discharge_time = discharge_start
+		+ queue.n_vehicles * saturation_headway;
+}
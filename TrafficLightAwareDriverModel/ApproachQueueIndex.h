@@ -0,0 +1,99 @@
+/*==========================================================================*/
+/*  ApproachQueueIndex.h													*/
+/*  Vehicles approaching each traffic light and the queue at its stop line	*/
+/*                                                                          */
+/*  Version of 2022-06	                              Fernando V. Monteiro  */
+/*==========================================================================*/
+
+#pragma once
+
+#include <unordered_map>
+#include <vector>
+
+#include "GroupedSortedIndex.h"
+#include "TrafficLight.h"
+
+/* Groups the vehicles by the traffic light they approach (as read from
+DRIVER_DATA_SIGNAL_DISTANCE), nearest to the stop line first, and
+summarizes the queue at each traffic light, so that queue-aware controllers
+and queue KPIs need not scan nearby vehicles:
+- get_queue: O(1);
+- get_n_vehicles_ahead: O(1).
+Vehicles of all lanes approaching the same traffic light form one queue.
+
+The queue is made of the stopped vehicles (see STOPPED_VELOCITY) nearest to
+the stop line: the first one at most max_queue_gap from it and each of the
+others at most max_queue_gap behind the previous one. Its discharge is
+predicted with a start-up lost time and a saturation headway, from the
+start of the green light (or from the data time if the light is green and
+the queue is already moving).
+
+As in LaneVehicleIndex, updates become visible at the next call to
+start_step, so queries see the previous step. The groups are maintained
+incrementally (see GroupedSortedIndex). Not thread safe. */
+class ApproachQueueIndex
+{
+public:
+	struct Entry {
+		long id{ 0 };
+		double distance{ 0.0 }; // front end to the stop line [m]
+		double velocity{ 0.0 }; // [m/s]
+		double length{ 0.0 }; // [m]
+	};
+	struct Queue {
+		long n_vehicles{ 0 };
+		/* Distance from the stop line to the rear of the last queued
+		vehicle [m] */
+		double length{ 0.0 };
+		long last_vehicle_id{ 0 };
+		/* Predicted time at which the last queued vehicle crosses the stop
+		line. Negative if there is no queue. [s] */
+		double discharge_time{ -1.0 };
+		/* Time of the data the queue was computed from [s] */
+		double time{ -1.0 };
+	};
+
+	static constexpr double max_queue_gap{ 10.0 }; // [m]
+	static constexpr double startup_lost_time{ 2.0 }; // [s]
+	static constexpr double saturation_headway{ 2.0 }; // [s/veh]
+
+	/* Records the vehicle's next traffic light in the current step. Zero
+	traffic_light_id means no traffic light ahead. */
+	void update(int traffic_light_id, const Entry& entry);
+	/* The vehicle left the simulation */
+	void remove(long id);
+	/* Must be called when the simulation time changes. Makes the updates
+	of the previous step visible to queries, using the traffic light states
+	of the previous step to predict the discharge. */
+	void start_step(double time,
+		const std::unordered_map<int, TrafficLight>& traffic_lights);
+	/* Discards all vehicles (new simulation run) */
+	void clear();
+
+	/* Empty queue if no vehicle approaches the traffic light */
+	const Queue& get_queue(int traffic_light_id) const;
+	/* Vehicles approaching the traffic light, nearest to the stop line
+	first. Empty if none. */
+	const std::vector<Entry>& get_approaching_vehicles(
+		int traffic_light_id) const;
+	/* Vehicles between this one and its next traffic light, or -1 if the
+	vehicle is not approaching any */
+	long get_n_vehicles_ahead(long id) const;
+	size_t size() const { return index.size(); };
+
+private:
+	struct IsCloser {
+		bool operator()(const Entry& a, const Entry& b) const {
+			return a.distance < b.distance;
+		};
+	};
+	using Index = GroupedSortedIndex<int, Entry, IsCloser>;
+
+	void compute_queue(int traffic_light_id,
+		const std::vector<Entry>& entries,
+		const std::unordered_map<int, TrafficLight>& traffic_lights);
+
+	Index index;
+	std::unordered_map<int, Queue> queues;
+	double current_time{ -1.0 };
+};
@@ -0,0 +1,116 @@
+#include <cmath>
+
+#include "CompressedTimeSeries.h"
+
+CompressedTimeSeries::CompressedTimeSeries(double resolution) :
+	resolution{ resolution } {}
+
+void CompressedTimeSeries::push_back(double value)
+{
+	int64_t quantized_value = std::llround(value / resolution);
+	size_t position_in_block = n_samples % block_size;
+	if (position_in_block == 0)
+	{
+		/* Seal the previous block */
+		if (!blocks.empty()) blocks.back().shrink_to_fit();
+		blocks.emplace_back();
+		blocks.back().reserve(block_size + block_size / 2);
+		write_varint(quantized_value);
+		last_delta = 0;
+	}
+	else
+	{
+		int64_t delta = quantized_value - last_quantized_value;
+		if (position_in_block == 1)
+		{
+			write_varint(delta);
+		}
+		else
+		{
+			write_varint(delta - last_delta);
+		}
+		last_delta = delta;
+	}
+	last_quantized_value = quantized_value;
+	last_value = value;
+	n_samples++;
+}
+
+size_t CompressedTimeSeries::memory_usage() const
+{
+	size_t bytes = blocks.capacity() * sizeof(std::vector<uint8_t>);
+	for (const std::vector<uint8_t>& block : blocks)
+	{
+		bytes += block.capacity();
+	}
+	return bytes;
+}
+
+void CompressedTimeSeries::write_varint(int64_t value)
+{
+	/* Zigzag: small negative numbers become small positive numbers */
+	uint64_t zigzag = (static_cast<uint64_t>(value) << 1)
+		^ static_cast<uint64_t>(value >> 63);
+	std::vector<uint8_t>& block = blocks.back();
+	while (zigzag >= 0x80)
+	{
+		block.push_back(static_cast<uint8_t>(zigzag | 0x80));
+		zigzag >>= 7;
+	}
+	block.push_back(static_cast<uint8_t>(zigzag));
+}
+
+int64_t CompressedTimeSeries::read_varint(const std::vector<uint8_t>& bytes,
+	size_t& byte_index)
+{
+	uint64_t zigzag = 0;
+	int shift = 0;
+	uint8_t byte;
+	do
+	{
+		byte = bytes[byte_index++];
+		zigzag |= static_cast<uint64_t>(byte & 0x7F) << shift;
+		shift += 7;
+	} while (byte & 0x80);
+	return static_cast<int64_t>(zigzag >> 1)
+		^ -static_cast<int64_t>(zigzag & 1);
+}
+
+/* Reader ----------------------------------------------------------------- */
+
+CompressedTimeSeries::Reader::Reader(const CompressedTimeSeries& series) :
+	series{ series } {}
+
+bool CompressedTimeSeries::Reader::has_next() const
+{
+	return sample_index < series.n_samples;
+}
+
+double CompressedTimeSeries::Reader::next()
+{
+	const std::vector<uint8_t>& block = series.blocks[block_index];
+	size_t position_in_block = sample_index % block_size;
+	if (position_in_block == 0)
+	{
+		quantized_value = read_varint(block, byte_index);
+		delta = 0;
+	}
+	else if (position_in_block == 1)
+	{
+		delta = read_varint(block, byte_index);
+		quantized_value += delta;
+	}
+	else
+	{
+		delta += read_varint(block, byte_index);
+		quantized_value += delta;
+	}
+
+	sample_index++;
+	if (sample_index % block_size == 0)
+	{
+		block_index++;
+		byte_index = 0;
+	}
+	return quantized_value * series.resolution;
+}
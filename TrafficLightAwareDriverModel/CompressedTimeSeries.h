@@ -0,0 +1,69 @@
+/*==========================================================================*/
+/*  CompressedTimeSeries.h													*/
+/*  Memory efficient storage of double valued vehicle histories				*/
+/*                                                                          */
+/*  Version of 2022-06	                              Fernando V. Monteiro  */
+/*==========================================================================*/
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/* Append-only time series compressed in blocks as values are appended.
+Values are quantized to a multiple of the given resolution, so the
+reconstruction error is at most resolution / 2. Each block stores its first
+value and first difference, followed by the differences of consecutive
+differences (delta-of-delta), all as zigzag encoded variable length
+integers. Smooth signals such as velocities need about one byte per sample.
+
+The most recent value is kept uncompressed, so back() returns exactly what
+was appended. Older values can only be read sequentially through a Reader.
+*/
+class CompressedTimeSeries
+{
+public:
+	/* Sequential decoder */
+	class Reader
+	{
+	public:
+		Reader(const CompressedTimeSeries& series);
+		bool has_next() const;
+		double next();
+
+	private:
+		const CompressedTimeSeries& series;
+		size_t block_index{ 0 };
+		size_t byte_index{ 0 };
+		size_t sample_index{ 0 };
+		int64_t quantized_value{ 0 };
+		int64_t delta{ 0 };
+	};
+
+	explicit CompressedTimeSeries(double resolution);
+
+	void push_back(double value);
+	double back() const { return last_value; };
+	bool empty() const { return n_samples == 0; };
+	size_t size() const { return n_samples; };
+	double get_resolution() const { return resolution; };
+	/* Bytes used by the compressed data (not counting this object) */
+	size_t memory_usage() const;
+
+	Reader get_reader() const { return Reader(*this); };
+
+private:
+	static const size_t block_size{ 256 }; // samples
+
+	void write_varint(int64_t value);
+	static int64_t read_varint(const std::vector<uint8_t>& bytes,
+		size_t& byte_index);
+
+	double resolution{ 0.01 };
+	double last_value{ 0.0 };
+	int64_t last_quantized_value{ 0 };
+	int64_t last_delta{ 0 };
+	size_t n_samples{ 0 };
+	std::vector<std::vector<uint8_t>> blocks;
+};
@@ -34,6 +34,10 @@ const double CAR_MAX_BRAKE{ 6.0 }; // absolute value [m/s^2]
 const double TRUCK_MAX_BRAKE{ 5.5 }; // absolute value  [m/s^2]
 const double COMFORTABLE_ACCELERATION{ 2.0 }; // [m/s^2]
 const double COMFORTABLE_BRAKE{ 4.0 }; // absolute value [m/s^2]
+/* Vehicles slower than this are considered stopped (used for KPIs) */
+const double STOPPED_VELOCITY{ 1.0 }; // [m/s]
+/* Resolution of the stored velocity and acceleration histories */
+const double HISTORY_RESOLUTION{ 0.01 }; // [m/s] or [m/s^2]
 
 /* Categories set by VISSIM */
 enum class VehicleCategory {
@@ -0,0 +1,118 @@
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+
+#include "ControlDecimation.h"
+
+ControlDecimation::Parameters ControlDecimation::parameters;
+uint64_t ControlDecimation::clock_overhead_ns{ 0 };
+
+static std::atomic<uint64_t> n_evaluations{ 0 };
+static std::atomic<uint64_t> n_reused{ 0 };
+static std::atomic<uint64_t> n_timed_evaluations{ 0 };
+static std::atomic<uint64_t> n_timed_reused{ 0 };
+static std::atomic<uint64_t> evaluation_time_ns{ 0 };
+static std::atomic<uint64_t> reused_time_ns{ 0 };
+
+ControlDecimation::Timer::Timer(const ControlDecimation& decimation,
+	bool is_evaluation) :
+	is_evaluation{ is_evaluation }
+{
+	if (!is_enabled() || decimation.is_full_rate) return;
+	std::atomic<uint64_t>& count = is_evaluation ?
+		n_evaluations : n_reused;
+	is_timed = count.fetch_add(1, std::memory_order_relaxed)
+		% timing_period == 0;
+	if (is_timed) start = std::chrono::steady_clock::now();
+}
+
+ControlDecimation::Timer::~Timer()
+{
+	if (!is_timed) return;
+	uint64_t elapsed_ns = std::chrono::duration_cast<
+		std::chrono::nanoseconds>(
+			std::chrono::steady_clock::now() - start).count();
+	elapsed_ns -= std::min(elapsed_ns, clock_overhead_ns);
+	if (is_evaluation)
+	{
+		n_timed_evaluations.fetch_add(1, std::memory_order_relaxed);
+		evaluation_time_ns.fetch_add(elapsed_ns, std::memory_order_relaxed);
+	}
+	else
+	{
+		n_timed_reused.fetch_add(1, std::memory_order_relaxed);
+		reused_time_ns.fetch_add(elapsed_ns, std::memory_order_relaxed);
+	}
+}
+
+void ControlDecimation::set_parameters(const Parameters& new_parameters)
+{
+	parameters = new_parameters;
+	if (is_enabled()) clock_overhead_ns = measure_clock_overhead();
+}
+
+uint64_t ControlDecimation::measure_clock_overhead()
+{
+	/* The smallest of many samples excludes interruptions */
+	const int n_samples = 1000;
+	uint64_t overhead_ns = UINT64_MAX;
+	for (int i = 0; i < n_samples; i++)
+	{
+		std::chrono::steady_clock::time_point start =
+			std::chrono::steady_clock::now();
+		uint64_t elapsed_ns = std::chrono::duration_cast<
+			std::chrono::nanoseconds>(
+				std::chrono::steady_clock::now() - start).count();
+		overhead_ns = std::min(overhead_ns, elapsed_ns);
+	}
+	return overhead_ns;
+}
+
+ControlDecimation::Counts ControlDecimation::get_counts()
+{
+	Counts counts;
+	counts.n_evaluations = n_evaluations.load(std::memory_order_relaxed);
+	counts.n_reused = n_reused.load(std::memory_order_relaxed);
+	counts.n_timed_evaluations =
+		n_timed_evaluations.load(std::memory_order_relaxed);
+	counts.n_timed_reused = n_timed_reused.load(std::memory_order_relaxed);
+	counts.evaluation_time_ns =
+		evaluation_time_ns.load(std::memory_order_relaxed);
+	counts.reused_time_ns = reused_time_ns.load(std::memory_order_relaxed);
+	return counts;
+}
+
+bool ControlDecimation::must_evaluate(const PerceptionFrame& frame) const
+{
+	if (!is_enabled() || is_full_rate || !has_evaluated
+		|| n_reused_steps >= parameters.max_reused_steps) return true;
+
+	const PerceptionFrame& last = last_evaluated_frame;
+	if (frame.leader_id != last.leader_id
+		|| frame.desired_velocity != last.desired_velocity) return true;
+	if (frame.has_leader
+		&& (std::abs(frame.gap - last.gap) > parameters.gap_change
+			|| std::abs(frame.relative_velocity - last.relative_velocity)
+			> parameters.relative_velocity_change)) return true;
+	if (frame.has_traffic_light != last.has_traffic_light
+		|| frame.traffic_light_id != last.traffic_light_id
+		|| frame.traffic_light_state != last.traffic_light_state) return true;
+	if (frame.has_traffic_light && frame.distance_to_traffic_light
+		< parameters.traffic_light_distance) return true;
+	return false;
+}
+
+void ControlDecimation::add_step(const PerceptionFrame& frame,
+	bool is_evaluation)
+{
+	if (is_evaluation)
+	{
+		has_evaluated = true;
+		n_reused_steps = 0;
+		last_evaluated_frame = frame;
+	}
+	else
+	{
+		n_reused_steps++;
+	}
+}
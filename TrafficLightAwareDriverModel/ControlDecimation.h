@@ -0,0 +1,106 @@
+/*==========================================================================*/
+/*  ControlDecimation.h														*/
+/*  Decides when a vehicle may reuse its last controller output			*/
+/*                                                                          */
+/*  Version of 2022-06	                              Fernando V. Monteiro  */
+/*==========================================================================*/
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+
+#include "PerceptionFrame.h"
+
+/* Opt-in decimated control. In free flow far from signals, the controller
+output barely changes from one step to the next, so a vehicle may reuse
+its last nominal acceleration (the minimum over the controller modes)
+instead of evaluating all modes again. The controller is evaluated again
+when any of these happens:
+- max_reused_steps steps were reused in a row;
+- the leader or the desired velocity changes;
+- the gap or the relative velocity to the leader moves more than the
+threshold away from their values at the last evaluation;
+- the next traffic light or its state changes;
+- the next traffic light is closer than traffic_light_distance.
+The safety override of the controller (too close to the leader) still runs
+every step, see LongitudinalControllerWithTrafficLights.
+
+Each vehicle's controller owns one object. Parameters and counters are
+shared by all vehicles. The counters include the time spent computing the
+accelerations, so that the run summary can estimate the CPU time saved.
+Reading the clock costs about as much as reusing an acceleration, so only
+one in timing_period computations of each kind is timed, and the cost of
+reading the clock (measured when the parameters are set) is subtracted
+from the timed intervals.
+
+An object can also be kept at full rate (see set_full_rate), for instance
+to compare decimated and full rate control on the same inputs (see
+StepInputReplayer). Its steps are not counted. */
+class ControlDecimation
+{
+public:
+	struct Parameters {
+		/* Zero evaluates the controller every step */
+		long max_reused_steps{ 0 };
+		double gap_change{ 1.0 }; // [m]
+		double relative_velocity_change{ 0.5 }; // [m/s]
+		double traffic_light_distance{ 100.0 }; // [m]
+	};
+
+	/* Cumulative since the DLL was loaded */
+	struct Counts {
+		uint64_t n_evaluations{ 0 };
+		uint64_t n_reused{ 0 };
+		/* Computations included in the times below */
+		uint64_t n_timed_evaluations{ 0 };
+		uint64_t n_timed_reused{ 0 };
+		uint64_t evaluation_time_ns{ 0 };
+		uint64_t reused_time_ns{ 0 };
+	};
+
+	/* Counts one acceleration computation and, for one in timing_period
+	computations, measures its time while the timer exists. Does nothing
+	if decimation is disabled. */
+	class Timer
+	{
+	public:
+		Timer(const ControlDecimation& decimation, bool is_evaluation);
+		~Timer();
+		Timer(const Timer&) = delete;
+		Timer& operator=(const Timer&) = delete;
+
+	private:
+		bool is_evaluation{ true };
+		bool is_timed{ false };
+		std::chrono::steady_clock::time_point start;
+	};
+
+	static const uint64_t timing_period{ 32 };
+
+	static void set_parameters(const Parameters& new_parameters);
+	static const Parameters& get_parameters() { return parameters; };
+	static bool is_enabled() { return parameters.max_reused_steps > 0; };
+	static Counts get_counts();
+	/* Time of two consecutive clock reads, which timed intervals should
+	not include [ns] */
+	static uint64_t measure_clock_overhead();
+
+	/* Evaluates the controller every step regardless of the parameters */
+	void set_full_rate() { is_full_rate = true; };
+	/* Always true if decimation is disabled or the object is kept at full
+	rate */
+	bool must_evaluate(const PerceptionFrame& frame) const;
+	/* Must be called every step with the result of must_evaluate */
+	void add_step(const PerceptionFrame& frame, bool is_evaluation);
+
+private:
+	static Parameters parameters;
+	/* Measured when the parameters are set */
+	static uint64_t clock_overhead_ns;
+
+	bool is_full_rate{ false };
+	bool has_evaluated{ false };
+	long n_reused_steps{ 0 };
+	PerceptionFrame last_evaluated_frame;
+};
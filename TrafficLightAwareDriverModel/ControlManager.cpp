@@ -1,12 +1,20 @@
+#include <algorithm>
+#include <iostream>
+
+#include "AllocationCounter.h"
 #include "ControlManager.h"
 #include "EgoVehicle.h"
 #include "NearbyVehicle.h"
-#include "TrafficLightACCVehicle.h"
+
+bool ControlManager::verify_mode_culling{ false };
 
 ControlManager::ControlManager(const EgoVehicle& ego_vehicle,
 	bool verbose) :
 	verbose{ verbose } 
 {
+	AllocationCounter::Scope scope{
+		AllocationCounter::Subsystem::controllers };
+
 	if (verbose) 
 	{
 		std::clog << "Creating control manager " << std::endl;
@@ -17,7 +25,8 @@ ControlManager::ControlManager(const EgoVehicle& ego_vehicle,
 	switch (ego_vehicle.get_type())
 	{
 	case VehicleType::traffic_light_acc_car:
-	case VehicleType::traffic_light_cacc_car: // both get the same controller
+	case VehicleType::traffic_light_cacc_car:
+	case VehicleType::platoon_car: // all get the same controller
 		with_traffic_lights_controller =
 			LongitudinalControllerWithTrafficLights(ego_vehicle,
 				is_long_control_verbose);
@@ -43,26 +52,96 @@ double ControlManager::use_vissim_desired_acceleration(
 }
 
 double ControlManager::get_traffic_light_acc_acceleration(
-	const TrafficLightACCVehicle& ego_vehicle,
-	const std::unordered_map<int, TrafficLight>& traffic_lights)
+	const EgoVehicle& ego_vehicle)
 {
 	if (verbose) std::clog << "Inside get traffic_light_acc_acceleration\n";
 
-	std::unordered_map<LongitudinalControllerWithTrafficLights::State, double>
-		possible_accelerations;
+	AllocationCounter::Scope scope{
+		AllocationCounter::Subsystem::controllers };
+
+	const PerceptionFrame& frame = ego_vehicle.get_perception_frame();
+	bool must_evaluate = decimation.must_evaluate(frame);
+	ControlDecimation::Timer timer{ decimation, must_evaluate };
+	decimation.add_step(frame, must_evaluate);
+	active_longitudinal_controller = LongControlType::traffic_light_acc;
+	if (!must_evaluate)
+	{
+		return with_traffic_lights_controller.reuse_nominal_acceleration(
+			ego_vehicle);
+	}
+
+	if (!verify_mode_culling)
+	{
+		return evaluate_relevant_modes(ego_vehicle);
+	}
+	LongitudinalControllerWithTrafficLights reference_controller =
+		with_traffic_lights_controller;
+	double acceleration = evaluate_relevant_modes(ego_vehicle);
+	check_mode_culling(ego_vehicle, reference_controller, acceleration);
+	return acceleration;
+}
+
+double ControlManager::evaluate_relevant_modes(const EgoVehicle& ego_vehicle)
+{
+	using State = LongitudinalControllerWithTrafficLights::State;
+	const PerceptionFrame& frame = ego_vehicle.get_perception_frame();
+	std::unordered_map<State, double> possible_accelerations;
 
+	/* The cheap modes first: their minimum bounds the other modes */
 	with_traffic_lights_controller.get_nominal_input(possible_accelerations);
-	with_traffic_lights_controller.compute_vehicle_following_input(
-		ego_vehicle, possible_accelerations);
 	with_traffic_lights_controller.compute_velocity_control_input(
 		ego_vehicle, possible_accelerations);
-	with_traffic_lights_controller.compute_traffic_light_input(
-		ego_vehicle, traffic_lights, possible_accelerations);
+	double upper_bound = std::min(possible_accelerations[State::max_accel],
+		possible_accelerations[State::velocity_control]);
 
-	active_longitudinal_controller = LongControlType::traffic_light_acc;
+	if (with_traffic_lights_controller.can_vehicle_following_bind(frame,
+		upper_bound))
+	{
+		with_traffic_lights_controller.compute_vehicle_following_input(
+			ego_vehicle, possible_accelerations);
+		upper_bound = std::min(upper_bound,
+			possible_accelerations[State::vehicle_following]);
+	}
+	if (with_traffic_lights_controller.can_traffic_light_bind(frame,
+		upper_bound))
+	{
+		with_traffic_lights_controller.compute_traffic_light_input(
+			ego_vehicle, possible_accelerations);
+	}
+
+	return with_traffic_lights_controller.
+		choose_acceleration(ego_vehicle, possible_accelerations);
+}
 
-	double ret = with_traffic_lights_controller.
+void ControlManager::check_mode_culling(const EgoVehicle& ego_vehicle,
+	LongitudinalControllerWithTrafficLights reference_controller,
+	double acceleration) const
+{
+	std::unordered_map<LongitudinalControllerWithTrafficLights::State, double>
+		possible_accelerations;
+	reference_controller.get_nominal_input(possible_accelerations);
+	reference_controller.compute_vehicle_following_input(
+		ego_vehicle, possible_accelerations);
+	reference_controller.compute_velocity_control_input(
+		ego_vehicle, possible_accelerations);
+	reference_controller.compute_traffic_light_input(
+		ego_vehicle, possible_accelerations);
+	double reference_acceleration = reference_controller.
 		choose_acceleration(ego_vehicle, possible_accelerations);
 
-	return ret;
+	if (reference_acceleration != acceleration
+		|| reference_controller.get_state()
+		!= with_traffic_lights_controller.get_state())
+	{
+		std::clog << "Mode culling changed the output. t="
+			<< ego_vehicle.get_time()
+			<< ", id=" << ego_vehicle.get_id()
+			<< ", accel. with all modes=" << reference_acceleration
+			<< " (" << LongitudinalControllerWithTrafficLights::
+				mode_to_string(reference_controller.get_state())
+			<< "), accel. with culling=" << acceleration
+			<< " (" << LongitudinalControllerWithTrafficLights::
+				mode_to_string(with_traffic_lights_controller.get_state())
+			<< ")" << std::endl;
+	}
 }
\ No newline at end of file
@@ -10,12 +10,12 @@
 #include <unordered_map>
 #include <vector>
 
+#include "ControlDecimation.h"
 #include "LongitudinalControllerWithTrafficLights.h"
 #include "Vehicle.h"
 
 class EgoVehicle;
 class NearbyVehicle;
-class TrafficLightACCVehicle;
 
 class ControlManager {
 public:
@@ -35,16 +35,44 @@ public:
 	}
 
 	color_t get_longitudinal_controller_color() const;
+	LongitudinalControllerWithTrafficLights::State 
+		get_longitudinal_controller_state() const {
+		return with_traffic_lights_controller.get_state();
+	};
+	const LongitudinalControllerWithTrafficLights::Parameters&
+		get_longitudinal_controller_parameters() const {
+		return with_traffic_lights_controller.get_parameters();
+	};
 	
+	/* The vehicle's perception frame must be up to date. With decimated
+	control, the controller modes are only evaluated when ControlDecimation
+	requires it. Modes that cannot bind (see the relevance bounds in
+	LongitudinalControllerWithTrafficLights) are not evaluated. */
 	double get_traffic_light_acc_acceleration(
-		const TrafficLightACCVehicle& ego_vehicle,
-		const std::unordered_map<int, TrafficLight>& traffic_lights);
+		const EgoVehicle& ego_vehicle);
+
+	/* Debugging: also evaluates all modes and logs any difference caused
+	by skipping modes. Shared by all vehicles. */
+	static void set_verify_mode_culling(bool verify) {
+		verify_mode_culling = verify;
+	};
+	/* Evaluates the controller every step even with decimated control */
+	void set_full_rate_control() { decimation.set_full_rate(); };
 
 	double use_vissim_desired_acceleration(const EgoVehicle& ego_vehicle);
 
 private:
+	static bool verify_mode_culling;
+
+	/* Evaluates the modes that can bind and chooses the acceleration */
+	double evaluate_relevant_modes(const EgoVehicle& ego_vehicle);
+	void check_mode_culling(const EgoVehicle& ego_vehicle,
+		LongitudinalControllerWithTrafficLights reference_controller,
+		double acceleration) const;
+
 	LongitudinalControllerWithTrafficLights
 		with_traffic_lights_controller;
+	ControlDecimation decimation;
 
 	/* Indicates which controller is active. Used for debugging and
 	visualization. */
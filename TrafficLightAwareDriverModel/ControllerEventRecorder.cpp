@@ -0,0 +1,72 @@
+#include <iostream>
+
+#include "AllocationCounter.h"
+#include "ControllerEventRecorder.h"
+
+ControllerEventRecorder::~ControllerEventRecorder()
+{
+	flush();
+	if (event_file != nullptr) fclose(event_file);
+}
+
+void ControllerEventRecorder::start()
+{
+	if (is_recording()) return;
+
+	AllocationCounter::Scope scope{
+		AllocationCounter::Subsystem::logging };
+	fopen_s(&event_file, event_file_name, "wb");
+	if (event_file == nullptr)
+	{
+		std::clog << "Unable to open the controller events file."
+			<< std::endl;
+		return;
+	}
+	FileHeader header;
+	fwrite(&header, sizeof(header), 1, event_file);
+	buffer.reserve(buffer_size);
+}
+
+void ControllerEventRecorder::record_events(const EgoVehicle& ego_vehicle)
+{
+	if (!is_recording() || ego_vehicle.get_events().empty()) return;
+
+	AllocationCounter::Scope scope{
+		AllocationCounter::Subsystem::logging };
+
+	/* The snapshot is the same for all events of this time step */
+	const PerceptionFrame& frame = ego_vehicle.get_perception_frame();
+	EventRecord record;
+	record.vehicle_id = static_cast<int32_t>(ego_vehicle.get_id());
+	record.controller_mode = static_cast<uint8_t>(
+		ego_vehicle.get_controller_mode());
+	record.leader_id = static_cast<int32_t>(frame.leader_id);
+	record.next_traffic_light_id = frame.traffic_light_id;
+	record.velocity = static_cast<float>(frame.velocity);
+	record.acceleration = static_cast<float>(
+		ego_vehicle.get_acceleration());
+	record.desired_acceleration = static_cast<float>(
+		ego_vehicle.get_desired_acceleration());
+	record.gap = static_cast<float>(frame.gap);
+	record.leader_relative_velocity = static_cast<float>(
+		frame.relative_velocity);
+	record.distance_to_next_traffic_light = static_cast<float>(
+		ego_vehicle.get_distance_to_next_traffic_light());
+
+	for (const EgoVehicle::Event& event : ego_vehicle.get_events())
+	{
+		record.time = event.time;
+		record.type = static_cast<uint8_t>(event.type);
+		record.previous_value = static_cast<int32_t>(event.previous_value);
+		record.new_value = static_cast<int32_t>(event.new_value);
+		buffer.push_back(record);
+	}
+	if (buffer.size() >= buffer_size) flush();
+}
+
+void ControllerEventRecorder::flush()
+{
+	if (event_file == nullptr || buffer.empty()) return;
+	fwrite(buffer.data(), sizeof(EventRecord), buffer.size(), event_file);
+	buffer.clear();
+}
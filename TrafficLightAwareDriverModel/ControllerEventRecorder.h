@@ -0,0 +1,68 @@
+/*==========================================================================*/
+/*  ControllerEventRecorder.h												*/
+/*  Compact binary recording of discrete vehicle events						*/
+/*                                                                          */
+/*  Version of 2022-06	                              Fernando V. Monteiro  */
+/*==========================================================================*/
+
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+#include "EgoVehicle.h"
+
+/* Writes one fixed size binary record per vehicle event (controller mode
+transition, leader change, cut-in or traffic light crossing) together with
+a snapshot of the vehicle state at the end of the time step in which the
+event happened. Nothing is written while the vehicle's state does not
+change.
+
+File layout: a FileHeader followed by EventRecord entries, all little
+endian and without padding. */
+class ControllerEventRecorder
+{
+public:
+#pragma pack(push, 1)
+	struct EventRecord {
+		double time; // [s]
+		int32_t vehicle_id;
+		uint8_t type; // EgoVehicle::Event::Type
+		uint8_t controller_mode; // mode after the event
+		int32_t previous_value;
+		int32_t new_value;
+		int32_t leader_id;
+		int32_t next_traffic_light_id;
+		float velocity; // [m/s]
+		float acceleration; // [m/s^2]
+		float desired_acceleration; // [m/s^2]
+		float gap; // [m]
+		float leader_relative_velocity; // [m/s]
+		float distance_to_next_traffic_light; // [m]
+	};
+	struct FileHeader {
+		char magic[4]{ 'T', 'L', 'E', 'V' };
+		uint16_t version{ 1 };
+		uint16_t record_size{ sizeof(EventRecord) };
+	};
+#pragma pack(pop)
+
+	ControllerEventRecorder() = default;
+	~ControllerEventRecorder();
+
+	/* Opens the event file. Events are only recorded after this call. */
+	void start();
+	bool is_recording() const { return event_file != nullptr; };
+	/* Records all events of the vehicle (see EgoVehicle::get_events) */
+	void record_events(const EgoVehicle& ego_vehicle);
+	/* Writes buffered records to the file */
+	void flush();
+
+private:
+	static const size_t buffer_size{ 4096 }; // records
+
+	std::vector<EventRecord> buffer;
+	FILE* event_file{ nullptr };
+	const char* event_file_name{ "controller_events.bin" };
+};
@@ -6,31 +6,230 @@
 /* Based on example from Version of 2017-09-15 by Lukas Kautzsch            */
 /*==========================================================================*/
 
+#include <algorithm>
+#include <cmath>
+#include <ctime>
 #include <iostream>
+#include <string>
 #include <unordered_map>
 #include <unordered_set>
+#include <vector>
 
+#include "AllocationCounter.h"
+#include "ApproachQueueIndex.h"
 #include "Constants.h"
+#include "ControlDecimation.h"
+#include "ControlManager.h"
+#include "ControllerEventRecorder.h"
 #include "DriverModel.h"
 #include "EgoVehicle.h"
 #include "EgoVehicleFactory.h"
+#include "EmissionsEstimator.h"
+#include "InputDispatchBenchmark.h"
+#include "LaneVehicleIndex.h"
+#include "PlatoonManager.h"
+#include "RegressionChecks.h"
+#include "RunStatistics.h"
+#include "ScalingBenchmark.h"
+#include "ShadowControllerEvaluator.h"
+#include "SignalGraph.h"
+#include "SignalProgramFileReader.h"
 #include "SimulationLogger.h"
+#include "SpatialHash.h"
+#include "SpatialHashBenchmark.h"
+#include "StepInputRecorder.h"
+#include "StepInputReplayer.h"
+#include "SubsystemMemoryReport.h"
 #include "TrafficLight.h"
 #include "TrafficLightFileReader.h"
+#include "TrafficLightKpiCollector.h"
+#include "V2VBoard.h"
+#include "VehicleInput.h"
 
 /*==========================================================================*/
 
 const std::unordered_set<long> LOGGED_VEHICLES_IDS{ 0 };
 const bool CLUELESS_DEBUGGING{ false };
+/* Writes vehicle events (controller mode transitions, leader changes,
+cut-ins and traffic light crossings) to a binary file */
+const bool RECORD_CONTROLLER_EVENTS{ false };
+/* Writes everything VISSIM sends to the DLL to a binary file that can be
+replayed offline with DriverModelReplayStepInputs */
+const bool RECORD_STEP_INPUTS{ false };
+/* Interval [s of simulation] between snapshots of the memory used by each
+subsystem (memory_by_subsystem.csv). Zero disables the per subsystem
+accounting, which has some cost on every allocation. */
+const double MEMORY_SNAPSHOT_INTERVAL{ 0.0 };
+/* Alternative controller parameters evaluated in the background on the
+same observations as the controllers of traffic light ACC and CACC
+vehicles. Leave empty to disable.
+Example: { {1.0, 3.0, 2.0, 1.0, 4.0}, {1.5, 3.0, 2.0, 1.0, 4.0} } */
+const std::vector<LongitudinalControllerWithTrafficLights::Parameters>
+    SHADOW_CONTROLLER_VARIANTS{};
+/* Decimated control: vehicles reuse their last nominal acceleration for up
+to max_reused_steps steps unless an event requires a new evaluation (see
+ControlDecimation.h). Zero max_reused_steps evaluates the controller every
+step. The run summary reports the evaluations saved and the traffic light
+KPIs, to be compared with a run without decimation.
+{max_reused_steps, gap_change [m], relative_velocity_change [m/s],
+traffic_light_distance [m]} */
+const ControlDecimation::Parameters CONTROL_DECIMATION{ 0, 1.0, 0.5, 100.0 };
+/* Controller modes that cannot bind are not evaluated. For debugging, this
+also evaluates all modes and logs any difference in the results. */
+const bool VERIFY_MODE_CULLING{ false };
+/* Connected vehicles publish their commanded acceleration on an in-process
+board, and connected followers evaluated after their leader use the
+leader's command of the same step instead of the acceleration reported by
+VISSIM, which is one step old */
+const bool USE_V2V_BOARD{ false };
+/* Keeps the vehicles of each lane sorted by position (see LaneVehicleIndex.h)
+for queries about several vehicles ahead. Ego vehicles use it to stop
+behind queues that reach red traffic lights. */
+const bool BUILD_LANE_VEHICLE_INDEX{ false };
+/* Asks VISSIM for all the vehicles in sight instead of two per lane
+upstream and downstream */
+const bool WANTS_ALL_NEARBY_VEHICLES{ false };
+/* Keeps the footprints of all vehicles in a grid (see SpatialHash.h) for
+queries about vehicles on crossing links */
+const bool BUILD_SPATIAL_HASH{ false };
+const double SPATIAL_HASH_CELL_SIZE{ 10.0 }; // [m]
+/* Keeps the vehicles approaching each traffic light sorted by distance and
+the queue at each stop line (see ApproachQueueIndex.h) */
+const bool BUILD_APPROACH_QUEUE_INDEX{ false };
+/* Platoon cars form platoons with the platoon cars ahead of them (see
+PlatoonManager.h). Otherwise they drive as traffic light CACC vehicles.
+Off by default so that runs match the replayer, which forms no platoons. */
+const bool FORM_PLATOONS{ false };
+/* Keeps a binary image of each parsed traffic light file next to it
+(see TrafficLightFileReader.h), which later sessions load without parsing */
+const bool USE_SIGNAL_TABLE_IMAGES{ false };
+/* Concurrent VISSIM instances on the same machine share each parsed traffic
+light file through shared memory instead of parsing and keeping their own
+copy (see TrafficLightFileReader.h) */
+const bool SHARE_SIGNAL_TABLES{ false };
 
 SimulationLogger simulation_logger;
+VehicleInput vehicle_input;
+RunStatistics run_statistics;
 std::unordered_map<long, std::unique_ptr<EgoVehicle>> vehicles;
 std::unordered_map<int, TrafficLight> traffic_lights;
+TrafficLightKpiCollector traffic_light_kpis;
+/* VISSIM evaluates vehicles one at a time, so followers read messages
+published earlier in the same step. A follower evaluated before its leader
+gets the leader's message of the previous step, which is no fresher than
+what VISSIM reports. Results of connected vehicles therefore depend on the
+order in which VISSIM calls the vehicles, and the replayer, which only
+reads the previous step, does not reproduce them (see StepInputReplayer.h). */
+V2VBoard v2v_board{ true };
+LaneVehicleIndex lane_vehicle_index;
+SpatialHash spatial_hash{ SPATIAL_HASH_CELL_SIZE };
+ApproachQueueIndex approach_queue_index;
+/* Signal heads along the vehicle routes, if the traffic light file has a
+network file (see SignalGraph.h) */
+SignalGraph signal_graph;
+PlatoonManager platoon_manager;
+EmissionsEstimator emissions_estimator;
+ControllerEventRecorder controller_event_recorder;
+StepInputRecorder step_input_recorder;
+SubsystemMemoryReport subsystem_memory_report;
+ShadowControllerEvaluator shadow_controller_evaluator{
+    SHADOW_CONTROLLER_VARIANTS };
 double simulation_time_step{ -1.0 };
 double current_time{ 0.0 };
 long current_vehicle_type{ 0 };
 long current_vehicle_id{ 0 };
 double current_desired_velocity{ 0 };
+/* The results files keep the rows of all runs, identified by the start
+time of the session and the number of the run in the session */
+std::time_t session_start_time{ 0 };
+long run_number{ 1 };
+/* Parameter files read in this session, reloaded at the start of each run */
+std::vector<std::string> parameter_files;
+
+/*==========================================================================*/
+
+/* Appends the JSON summary of the current run to the persistent log */
+void write_run_summary()
+{
+    if (!run_statistics.has_started()) return;
+    std::string run_summary = run_statistics.to_json_line(
+        traffic_light_kpis.get_run_totals());
+    simulation_logger.write_to_persistent_log(run_summary);
+}
+
+void set_run_id()
+{
+    std::string run_id = std::to_string(
+        static_cast<long long>(session_start_time))
+        + "_" + std::to_string(run_number);
+    run_statistics.set_run_id(run_id);
+    traffic_light_kpis.set_run_id(run_id);
+    emissions_estimator.set_run_id(run_id);
+    shadow_controller_evaluator.set_run_id(run_id);
+}
+
+/* Parameter files are either traffic light CSV files, VISSIM signal
+controller files (.sig) or signal plan files (see SignalProgramFileReader.h) */
+bool read_traffic_light_file(const std::string& file_name,
+    std::unordered_map<int, TrafficLight>& traffic_lights_in_file)
+{
+    if (SignalProgramFileReader::is_signal_program_file(file_name))
+    {
+        if (SignalProgramFileReader::is_signal_plan_file(file_name))
+        {
+            return SignalProgramFileReader::from_plan_to_objects(file_name,
+                traffic_lights_in_file);
+        }
+        return SignalProgramFileReader::from_file_to_objects(file_name, 0,
+            -1.0, traffic_lights_in_file);
+    }
+    return TrafficLightFileReader::from_file_to_objects(file_name,
+        traffic_lights_in_file);
+}
+
+/* VISSIM keeps the DLL loaded between the runs of a session (e.g., in
+multi-run simulations), so the end of a run is only noticed when the next
+one starts: the simulation time goes back, or DRIVER_COMMAND_INIT arrives
+while there are still vehicles. This writes the results of the finished run
+and brings the DLL back to its state before the run. Containers are cleared
+instead of destroyed so that the next run reuses their memory, and the
+vehicle objects go back to the VehicleMemoryPool. */
+void finish_simulation_run()
+{
+    subsystem_memory_report.write_snapshot(current_time);
+    subsystem_memory_report.start_new_run();
+    write_run_summary();
+    AllocationCounter::reset_subsystem_peaks();
+    run_statistics = RunStatistics();
+    traffic_light_kpis.reset_run_totals();
+    emissions_estimator.write_results();
+    traffic_light_kpis.write_remaining_bins();
+    shadow_controller_evaluator.write_statistics();
+    shadow_controller_evaluator.reset_statistics();
+    controller_event_recorder.flush();
+    step_input_recorder.flush();
+    run_number++;
+    set_run_id();
+
+    vehicle_input.set_ego_vehicle(nullptr);
+    vehicles.clear();
+    v2v_board.clear();
+    lane_vehicle_index.clear();
+    spatial_hash.clear();
+    approach_queue_index.clear();
+    platoon_manager.clear();
+    current_vehicle_id = 0;
+    /* Discards the signal states of the finished run and any signal head
+    that is not in the parameter files */
+    AllocationCounter::Scope scope{
+        AllocationCounter::Subsystem::signal_tables };
+    traffic_lights.clear();
+    for (const std::string& parameter_file : parameter_files)
+    {
+        read_traffic_light_file(parameter_file, traffic_lights);
+    }
+    traffic_light_kpis.register_traffic_lights(traffic_lights);
+}
 
 /*==========================================================================*/
 
@@ -45,12 +244,28 @@ BOOL APIENTRY DllMain (HANDLE  hModule,
   switch (ul_reason_for_call) {
       case DLL_PROCESS_ATTACH:
           simulation_logger.create_log_file();
+          session_start_time = std::time(nullptr);
+          set_run_id();
+          ControlDecimation::set_parameters(CONTROL_DECIMATION);
+          ControlManager::set_verify_mode_culling(VERIFY_MODE_CULLING);
+          TrafficLightFileReader::set_uses_binary_images(
+              USE_SIGNAL_TABLE_IMAGES);
+          TrafficLightFileReader::set_uses_shared_memory(
+              SHARE_SIGNAL_TABLES);
+          if (RECORD_CONTROLLER_EVENTS) controller_event_recorder.start();
+          if (RECORD_STEP_INPUTS) step_input_recorder.start();
+          if (MEMORY_SNAPSHOT_INTERVAL > 0)
+          {
+              subsystem_memory_report.start(MEMORY_SNAPSHOT_INTERVAL);
+          }
           break;
       case DLL_THREAD_ATTACH:
           break;
       case DLL_THREAD_DETACH:
           break;
       case DLL_PROCESS_DETACH:
+          subsystem_memory_report.write_snapshot(current_time);
+          write_run_summary();
           break;
   }
   return TRUE;
@@ -73,6 +288,12 @@ DRIVERMODEL_API  int  DriverModelSetValue (long   type,
     /* Note that we can check the order in which each case is accessed at the 
     API documentation. */
 
+    if (step_input_recorder.is_recording())
+    {
+        step_input_recorder.record_set_value(type, index1, index2,
+            long_value, double_value);
+    }
+
     switch (type) {
     case DRIVER_DATA_PATH                   :
         std::clog << "DLL path: "
@@ -85,18 +306,27 @@ DRIVERMODEL_API  int  DriverModelSetValue (long   type,
             std::clog << "Parameter file path: "
                 << string_value << std::endl;
             /* Only the traffic light ACC has a parameter file */
-            TrafficLightFileReader::from_file_to_objects(
-                std::string(string_value), traffic_lights);
+            AllocationCounter::Scope scope{
+                AllocationCounter::Subsystem::signal_tables };
+            read_traffic_light_file(std::string(string_value),
+                traffic_lights);
+            if (std::find(parameter_files.begin(), parameter_files.end(),
+                string_value) == parameter_files.end())
+            {
+                parameter_files.push_back(std::string(string_value));
+            }
             for (const std::pair<int, TrafficLight>& pair : traffic_lights)
             {
                 std::clog << pair.second << "\n";
             }
+            traffic_light_kpis.register_traffic_lights(traffic_lights);
+            signal_graph.load(SignalGraph::network_file_name(
+                std::string(string_value)));
         }
         return 1;
     case DRIVER_DATA_TIMESTEP               :
-        if (simulation_time_step < 0) {
-            simulation_time_step = double_value;
-        }
+        /* Runs of the same session may use different time steps */
+        simulation_time_step = double_value;
         return 1;
     case DRIVER_DATA_TIME                   :
         /*if (double_value > DEBUGGING_START_TIME)
@@ -108,6 +338,31 @@ DRIVERMODEL_API  int  DriverModelSetValue (long   type,
             std::clog << "t=" << current_time 
                 << ", " << vehicles.size() << " vehicles." << std::endl;
         }
+        if (run_statistics.has_started() && double_value < current_time)
+        {
+            /* A new simulation run started */
+            finish_simulation_run();
+        }
+        if (double_value != current_time || !run_statistics.has_started())
+        {
+            run_statistics.start_step(double_value, vehicles.size());
+            subsystem_memory_report.update(double_value);
+            v2v_board.start_step(double_value);
+            if (BUILD_LANE_VEHICLE_INDEX)
+            {
+                lane_vehicle_index.start_step(double_value);
+            }
+            if (BUILD_SPATIAL_HASH) spatial_hash.start_step(double_value);
+            if (BUILD_APPROACH_QUEUE_INDEX)
+            {
+                approach_queue_index.start_step(double_value, traffic_lights);
+            }
+        }
+        if (double_value != current_time)
+        {
+            /* All vehicles have been evaluated in the previous step */
+            emissions_estimator.process_samples(simulation_time_step);
+        }
         current_time = double_value;
         return 1;
     case DRIVER_DATA_USE_UDA                :
@@ -121,69 +376,32 @@ DRIVERMODEL_API  int  DriverModelSetValue (long   type,
         }*/
         return 0;
     case DRIVER_DATA_VEH_ID                 :
+    {
         if (CLUELESS_DEBUGGING) {
             std::clog << "t=" << current_time
                 << ", getting data for veh. " << long_value << std::endl;
         }
 
         current_vehicle_id = long_value;
-        if (vehicles.find(current_vehicle_id) != vehicles.end()) 
+        /* The following inputs and outputs refer to this vehicle */
+        auto vehicle_it = vehicles.find(current_vehicle_id);
+        EgoVehicle* ego_vehicle = vehicle_it != vehicles.end() ?
+            vehicle_it->second.get() : nullptr;
+        vehicle_input.set_ego_vehicle(ego_vehicle);
+        if (ego_vehicle != nullptr)
         {
-            vehicles[current_vehicle_id]->clear_nearby_vehicles();
+            ego_vehicle->clear_nearby_vehicles();
         }
         return 1;
-    case DRIVER_DATA_VEH_LANE               :
-        vehicles[current_vehicle_id]->set_lane(long_value);
-        return 1;
-    case DRIVER_DATA_VEH_ODOMETER           :
-    case DRIVER_DATA_VEH_LANE_ANGLE         :
-        return 1;
-    case DRIVER_DATA_VEH_LATERAL_POSITION   :
-        vehicles[current_vehicle_id]->set_lateral_position(double_value);
-        return 1;
-    case DRIVER_DATA_VEH_VELOCITY           :
-        vehicles[current_vehicle_id]->set_velocity(double_value);
-        return 1;
-    case DRIVER_DATA_VEH_ACCELERATION       :
-        vehicles[current_vehicle_id]->set_acceleration(double_value);
-        return 1;
-    case DRIVER_DATA_VEH_LENGTH             :
-        vehicles[current_vehicle_id]->set_length(double_value);
-        return 1;
-    case DRIVER_DATA_VEH_WIDTH              :
-        vehicles[current_vehicle_id]->set_width(double_value);
-        return 1;
-    case DRIVER_DATA_VEH_WEIGHT             :
-    case DRIVER_DATA_VEH_MAX_ACCELERATION   :
-        return 1;
-    case DRIVER_DATA_VEH_TURNING_INDICATOR  :
-        vehicles[current_vehicle_id]->set_turning_indicator(long_value);
-        return 1;
-    case DRIVER_DATA_VEH_CATEGORY           :
-        vehicles[current_vehicle_id]->set_category(long_value);
-        return 1;
-    case DRIVER_DATA_VEH_PREFERRED_REL_LANE :
-        vehicles[current_vehicle_id]->set_preferred_relative_lane(
-            long_value);
-        return 1;
-    case DRIVER_DATA_VEH_USE_PREFERRED_LANE :
-        vehicles[current_vehicle_id]->set_vissim_use_preferred_lane(
-            long_value);
-        return 1;
+    }
     case DRIVER_DATA_VEH_DESIRED_VELOCITY   :
         current_desired_velocity = double_value;
-        if (vehicles.find(current_vehicle_id) != vehicles.end())
+        if (vehicle_input.get_ego_vehicle() != nullptr)
         {
-            vehicles[current_vehicle_id]->set_desired_velocity(double_value);
+            vehicle_input.get_ego_vehicle()->set_desired_velocity(
+                double_value);
         }
         return 1;
-    case DRIVER_DATA_VEH_X_COORDINATE       :
-    case DRIVER_DATA_VEH_Y_COORDINATE       :
-    case DRIVER_DATA_VEH_Z_COORDINATE       :
-    case DRIVER_DATA_VEH_REAR_X_COORDINATE  :
-    case DRIVER_DATA_VEH_REAR_Y_COORDINATE  :
-    case DRIVER_DATA_VEH_REAR_Z_COORDINATE  :
-        return 1;
     case DRIVER_DATA_VEH_TYPE               :
         /* We only use this information when a new vehicle is created */
         current_vehicle_type = long_value;
@@ -191,130 +409,47 @@ DRIVERMODEL_API  int  DriverModelSetValue (long   type,
             vehicles[current_vehicle_id]->set_type(long_value);
         }*/
         return 1;
-    case DRIVER_DATA_VEH_COLOR              :
-        // We define the vehicle color instead
-        //vehicles[current_vehicle_id]->set_color(long_value);
-        return 1;
     case DRIVER_DATA_VEH_CURRENT_LINK       :
-        vehicles[current_vehicle_id]->set_link(long_value);
-        return 0; /* (To avoid getting sent lots of DRIVER_DATA_VEH_NEXT_LINKS
-                messages) */
-                /* Must return 1 if these messages are to be sent from
-                VISSIM! */
-    case DRIVER_DATA_VEH_NEXT_LINKS         :
-        return 0;
-    case DRIVER_DATA_VEH_ACTIVE_LANE_CHANGE :
-        vehicles[current_vehicle_id]->set_active_lane_change_direction(
-            long_value);
-        return 1;
-    case DRIVER_DATA_VEH_REL_TARGET_LANE    :
-        return 1;
-    case DRIVER_DATA_VEH_INTAC_STATE        :
-        return 1;
-    case DRIVER_DATA_VEH_INTAC_TARGET_TYPE  :
-        return 1;
-    case DRIVER_DATA_VEH_INTAC_TARGET_ID    :
-        return 1;
-    case DRIVER_DATA_VEH_INTAC_HEADWAY      :
-        return 1;
-    case DRIVER_DATA_VEH_UDA                :
-        return 1;
-    case DRIVER_DATA_NVEH_ID                :
-        if (long_value > 0) 
+        vehicle_input.set_value(type, index1, index2, long_value,
+            double_value);
+        /* VISSIM only sends the routes (DRIVER_DATA_VEH_NEXT_LINKS) if
+        this returns 1 */
+        return signal_graph.empty() ? 0 : 1;
+    case DRIVER_DATA_SIGNAL_DISTANCE        :
+        vehicle_input.set_value(type, index1, index2, long_value,
+            double_value);
+        if (vehicle_input.get_ego_vehicle() != nullptr)
         {
-            vehicles[current_vehicle_id]->emplace_nearby_vehicle(
-                long_value, index1, index2);
+            for (const TrafficLightEvent& event :
+                vehicle_input.get_ego_vehicle()->get_traffic_light_events())
+            {
+                traffic_light_kpis.add_event(event, traffic_lights);
+            }
         }
         return 1;
-    case DRIVER_DATA_NVEH_LANE_ANGLE        :
-        return 1;
-    case DRIVER_DATA_NVEH_LATERAL_POSITION  :
-        vehicles[current_vehicle_id]->peek_nearby_vehicles()
-            ->set_lateral_position(double_value);
-        return 1;
-    case DRIVER_DATA_NVEH_DISTANCE          :
-        vehicles[current_vehicle_id]->peek_nearby_vehicles()
-            ->set_distance(double_value);
-        return 1;
-    case DRIVER_DATA_NVEH_REL_VELOCITY      :
-        vehicles[current_vehicle_id]->peek_nearby_vehicles()
-            ->set_relative_velocity(double_value);
-        return 1;
-    case DRIVER_DATA_NVEH_ACCELERATION      :
-        vehicles[current_vehicle_id]->peek_nearby_vehicles()
-            ->set_acceleration(double_value);
-        return 1;
-    case DRIVER_DATA_NVEH_LENGTH            :
-        vehicles[current_vehicle_id]->peek_nearby_vehicles()
-            ->set_length(double_value);
-        return 1;
-    case DRIVER_DATA_NVEH_WIDTH             :
-        vehicles[current_vehicle_id]->peek_nearby_vehicles()
-            ->set_width(double_value);
-        return 1;
-    case DRIVER_DATA_NVEH_WEIGHT            :
-    case DRIVER_DATA_NVEH_TURNING_INDICATOR :
-        return 1;
-    case DRIVER_DATA_NVEH_CATEGORY          :
-        vehicles[current_vehicle_id]->peek_nearby_vehicles()
-            ->set_category(long_value);
-        return 1;
-    case DRIVER_DATA_NVEH_LANE_CHANGE       :
-        vehicles[current_vehicle_id]->peek_nearby_vehicles()
-            ->set_lane_change_direction(long_value);
-        return 1;
-    case DRIVER_DATA_NVEH_TYPE              :
-        vehicles[current_vehicle_id]->set_nearby_vehicle_type(long_value);
-        return 1;
-    case DRIVER_DATA_NVEH_UDA               :
-        return 1;
-    case DRIVER_DATA_NO_OF_LANES            :
-    case DRIVER_DATA_LANE_WIDTH             :
-        return 1;
-    case DRIVER_DATA_LANE_END_DISTANCE      :
-        vehicles[current_vehicle_id]->set_lane_end_distance(
-            double_value, index1);
-        return 1;
-    case DRIVER_DATA_RADIUS                 :
-    case DRIVER_DATA_MIN_RADIUS             :
-    case DRIVER_DATA_DIST_TO_MIN_RADIUS     :
-    case DRIVER_DATA_SLOPE                  :
-    case DRIVER_DATA_SLOPE_AHEAD            :
-        return 1;
-    case DRIVER_DATA_SIGNAL_DISTANCE        :
-        vehicles[current_vehicle_id]->read_traffic_light(
-            index1, double_value);
-        return 1;
     case DRIVER_DATA_SIGNAL_STATE           :
+    {
         /* This is called once for each signal head at the start of 
         every simulation step. And then once again for each vehicle. */
+        AllocationCounter::Scope scope{
+            AllocationCounter::Subsystem::signal_tables };
         traffic_lights[index1].set_current_state(long_value);
         return 1;
+    }
     case DRIVER_DATA_SIGNAL_STATE_START     :
+    {
         /* Called once for each vehicle close to the signal head, so
         we may set the same value several times. */
+        AllocationCounter::Scope scope{
+            AllocationCounter::Subsystem::signal_tables };
         traffic_lights[index1].set_current_state_start_time(double_value);
         return 1;
-    case DRIVER_DATA_SPEED_LIMIT_DISTANCE   :
-    case DRIVER_DATA_SPEED_LIMIT_VALUE      :
-        return 1;
-    /* IMPORTANT: Following are behavior data suggested for the current time
-    step by Vissim's internal model */
-    case DRIVER_DATA_DESIRED_ACCELERATION   :
-        vehicles[current_vehicle_id]->set_vissim_acceleration(
-            double_value);
-        return 1;
-    case DRIVER_DATA_DESIRED_LANE_ANGLE     :
-        vehicles[current_vehicle_id]->set_desired_lane_angle(double_value);
-        return 1;
-    case DRIVER_DATA_ACTIVE_LANE_CHANGE     :
-        return 1;
-    case DRIVER_DATA_REL_TARGET_LANE        :
-        /* Apparently this is VISSIM's suggestion of target lane */
-        vehicles[current_vehicle_id]->set_relative_target_lane(long_value);
-        return 1;
+    }
     default :
-        return 0;
+        /* Vehicle and nearby vehicle data, and the data types that are
+        ignored (see VehicleInput) */
+        return vehicle_input.set_value(type, index1, index2, long_value,
+            double_value);
     }
 }
 
@@ -336,21 +471,20 @@ DRIVERMODEL_API  int  DriverModelGetValue (long   type,
     /* Note that we can check the order in which each case is accessed at the
     API documentation. */
 
-    //EgoVehicle& ego_vehicle = vehicles[current_vehicle_id];
+    EgoVehicle* ego_vehicle = vehicle_input.get_ego_vehicle();
 
     switch (type) {
     case DRIVER_DATA_STATUS :
         *long_value = 0;
         return 1;
     case DRIVER_DATA_VEH_TURNING_INDICATOR :
-        *long_value = vehicles[current_vehicle_id]->get_turning_indicator();
+        *long_value = ego_vehicle->get_turning_indicator();
         return 1;
     case DRIVER_DATA_VEH_DESIRED_VELOCITY   :
-        *double_value = vehicles[current_vehicle_id]->get_desired_velocity();
+        *double_value = ego_vehicle->get_desired_velocity();
         return 1;
     case DRIVER_DATA_VEH_COLOR :
-        *long_value = vehicles[current_vehicle_id]->
-            get_color_by_controller_state();
+        *long_value = ego_vehicle->get_color_by_controller_state();
         return 1;
     case DRIVER_DATA_VEH_UDA :
         //switch (UDA(index1))
@@ -365,44 +499,53 @@ DRIVERMODEL_API  int  DriverModelGetValue (long   type,
     case DRIVER_DATA_DESIRED_ACCELERATION :
         if (CLUELESS_DEBUGGING) {
             std::clog << "deciding acceleration for veh. "
-                << vehicles[current_vehicle_id]->get_id() << std::endl;
+                << ego_vehicle->get_id() << std::endl;
         }
         *double_value = 
-            vehicles[current_vehicle_id]->get_desired_acceleration(
-            traffic_lights);
+            ego_vehicle->get_desired_acceleration(traffic_lights);
+        /* Platoon cars do not always drive with the controller, so only
+        traffic light ACC and CACC vehicles are shadowed */
+        if (shadow_controller_evaluator.has_variants()
+            && (ego_vehicle->get_type() == VehicleType::traffic_light_acc_car
+                || ego_vehicle->get_type()
+                == VehicleType::traffic_light_cacc_car))
+        {
+            shadow_controller_evaluator.evaluate(*ego_vehicle);
+        }
         if (CLUELESS_DEBUGGING) {
             std::clog << "decided acceleration for veh. "
-                << vehicles[current_vehicle_id]->get_id() << std::endl;
+                << ego_vehicle->get_id() << std::endl;
         }
         return 1;
     case DRIVER_DATA_DESIRED_LANE_ANGLE :
-        *double_value = 
-            vehicles[current_vehicle_id]->get_desired_lane_angle();
+        *double_value = ego_vehicle->get_desired_lane_angle();
         return 1;
     case DRIVER_DATA_ACTIVE_LANE_CHANGE :
         if (CLUELESS_DEBUGGING) {
             std::clog << "deciding lane change for veh. "
-                << vehicles[current_vehicle_id]->get_id() << std::endl;
+                << ego_vehicle->get_id() << std::endl;
         }
-        *long_value = 
-            vehicles[current_vehicle_id]->decide_lane_change_direction();
+        *long_value = ego_vehicle->decide_lane_change_direction();
         if (CLUELESS_DEBUGGING) {
             std::clog << "decided lane change " << *long_value
                 << " for veh. " 
-                << vehicles[current_vehicle_id]->get_id() << std::endl;
+                << ego_vehicle->get_id() << std::endl;
         }
 
-        if (vehicles[current_vehicle_id]->is_verbose()) 
+        if (ego_vehicle->is_verbose()) 
         {
-            std::clog << *vehicles[current_vehicle_id] << std::endl;
+            std::clog << *ego_vehicle << std::endl;
         }
+
+        /* This is the last call for the vehicle in this time step */
+        controller_event_recorder.record_events(*ego_vehicle);
+        ego_vehicle->clear_events();
         
         return 1;
     case DRIVER_DATA_REL_TARGET_LANE :
         /* This is used by Vissim only if *long_value was set to 0 in the 
         call of DriverModelGetValue (DRIVER_DATA_SIMPLE_LANECHANGE) */
-        /**long_value = 
-            vehicles[current_vehicle_id]->get_relative_target_lane();*/
+        /**long_value = ego_vehicle->get_relative_target_lane();*/
         return 1;
     case DRIVER_DATA_SIMPLE_LANECHANGE :
         *long_value = 1;
@@ -412,9 +555,9 @@ DRIVERMODEL_API  int  DriverModelGetValue (long   type,
                         applied */
         return 1;
     case DRIVER_DATA_WANTS_ALL_NVEHS:
-        *long_value = 0; /* must be set to 1 if data for more than 2 nearby 
-                        vehicles per lane and upstream/downstream is to be 
-                        passed from Vissim */
+        /* must be set to 1 if data for more than 2 nearby vehicles per
+        lane and upstream/downstream is to be passed from Vissim */
+        *long_value = WANTS_ALL_NEARBY_VEHICLES ? 1 : 0;
         return 1;
     case DRIVER_DATA_ALLOW_MULTITHREADING:
         *long_value = 0; /* must be set to 1 to allow a simulation run to be
@@ -433,11 +576,26 @@ DRIVERMODEL_API  int  DriverModelExecuteCommand (long number)
     /* Executes the command <number> if that is available in the driver */
     /* module. Return value is 1 on success, otherwise 0.               */
 
+    if (step_input_recorder.is_recording())
+    {
+        step_input_recorder.record_command(number);
+    }
+
     switch (number) {
     case DRIVER_COMMAND_INIT :
+        /* Sent at the start of every run, after the time is set. If the
+        run starts at the time where the previous one stopped, the
+        previous vehicles are still here. */
+        if (!vehicles.empty())
+        {
+            finish_simulation_run();
+            run_statistics.start_step(current_time, 0);
+        }
         return 1;
     case DRIVER_COMMAND_CREATE_DRIVER :
     {
+        AllocationCounter::Scope scope{
+            AllocationCounter::Subsystem::vehicle_objects };
         bool verbose = false;
         if (LOGGED_VEHICLES_IDS.find(current_vehicle_id)
             != LOGGED_VEHICLES_IDS.end()) verbose = true;
@@ -446,7 +604,26 @@ DRIVERMODEL_API  int  DriverModelExecuteCommand (long number)
                 current_vehicle_type, current_desired_velocity, 
                 simulation_time_step, current_time, verbose)
             );
+        EgoVehicle* ego_vehicle = vehicles[current_vehicle_id].get();
+        if (USE_V2V_BOARD && ego_vehicle != nullptr)
+        {
+            ego_vehicle->connect_to_v2v_board(&v2v_board);
+        }
+        if (!signal_graph.empty() && ego_vehicle != nullptr)
+        {
+            ego_vehicle->connect_to_signal_graph(&signal_graph);
+        }
+        if (FORM_PLATOONS && ego_vehicle != nullptr)
+        {
+            ego_vehicle->connect_to_platoon_manager(&platoon_manager);
+        }
+        if (BUILD_LANE_VEHICLE_INDEX && ego_vehicle != nullptr)
+        {
+            ego_vehicle->connect_to_lane_vehicle_index(&lane_vehicle_index);
+        }
+        run_statistics.add_created_vehicle();
         current_vehicle_id = 0;
+        vehicle_input.set_ego_vehicle(nullptr);
         return 1;
     }
     case DRIVER_COMMAND_KILL_DRIVER :
@@ -454,7 +631,22 @@ DRIVERMODEL_API  int  DriverModelExecuteCommand (long number)
         {
             std::clog << "Erasing veh. " << current_vehicle_id << std::endl;
         }
+        vehicle_input.set_ego_vehicle(nullptr);
         vehicles.erase(current_vehicle_id);
+        run_statistics.add_destroyed_vehicle();
+        emissions_estimator.remove_vehicle(current_vehicle_id);
+        if (BUILD_LANE_VEHICLE_INDEX)
+        {
+            lane_vehicle_index.remove(current_vehicle_id);
+        }
+        if (BUILD_APPROACH_QUEUE_INDEX)
+        {
+            approach_queue_index.remove(current_vehicle_id);
+        }
+        if (FORM_PLATOONS)
+        {
+            platoon_manager.remove_vehicle(current_vehicle_id);
+        }
         return 1;
     case DRIVER_COMMAND_MOVE_DRIVER :
     {
@@ -463,13 +655,66 @@ DRIVERMODEL_API  int  DriverModelExecuteCommand (long number)
         if (CLUELESS_DEBUGGING) {
             std::clog << "Updating states" << std::endl;
         }
-        vehicles[current_vehicle_id]->update_state();
+        EgoVehicle* ego_vehicle = vehicle_input.get_ego_vehicle();
+        ego_vehicle->update_state();
         
         if (CLUELESS_DEBUGGING)
         {
             std::clog << "Analyzing nearby vehicles" << std::endl;
         }
-        vehicles[current_vehicle_id]->analyze_nearby_vehicles();
+        ego_vehicle->analyze_nearby_vehicles();
+
+        emissions_estimator.add_sample(current_vehicle_id,
+            ego_vehicle->get_link(),
+            ego_vehicle->get_category(),
+            ego_vehicle->get_velocity(),
+            ego_vehicle->get_acceleration());
+        if (BUILD_LANE_VEHICLE_INDEX)
+        {
+            double position = ego_vehicle->get_position_on_link();
+            lane_vehicle_index.update(ego_vehicle->get_link(),
+                ego_vehicle->get_lane(),
+                LaneVehicleIndex::Entry{ current_vehicle_id,
+                    position,
+                    ego_vehicle->get_velocity(),
+                    ego_vehicle->get_acceleration(),
+                    ego_vehicle->get_length(),
+                    ego_vehicle->get_is_connected() });
+            /* Vehicles not driven by this DLL are only known as nearby
+            vehicles */
+            for (const auto& nearby_vehicle :
+                ego_vehicle->get_nearby_vehicles())
+            {
+                if (vehicles.find(nearby_vehicle->get_id())
+                    != vehicles.end()) continue;
+                lane_vehicle_index.update_observed(ego_vehicle->get_link(),
+                    ego_vehicle->get_lane()
+                    + nearby_vehicle->get_relative_lane().to_int(),
+                    LaneVehicleIndex::Entry{ nearby_vehicle->get_id(),
+                        position + nearby_vehicle->get_distance(),
+                        nearby_vehicle->compute_velocity(
+                            ego_vehicle->get_velocity()),
+                        nearby_vehicle->get_acceleration(),
+                        nearby_vehicle->get_length(),
+                        nearby_vehicle->is_connected() });
+            }
+        }
+        if (BUILD_SPATIAL_HASH)
+        {
+            spatial_hash.add(SpatialHash::Entry{ current_vehicle_id,
+                ego_vehicle->get_link(),
+                ego_vehicle->get_front_x(), ego_vehicle->get_front_y(),
+                ego_vehicle->get_rear_x(), ego_vehicle->get_rear_y(),
+                ego_vehicle->get_width() });
+        }
+        if (BUILD_APPROACH_QUEUE_INDEX)
+        {
+            approach_queue_index.update(ego_vehicle->get_signal_ahead_id(),
+                ApproachQueueIndex::Entry{ current_vehicle_id,
+                    ego_vehicle->get_signal_ahead_distance(),
+                    ego_vehicle->get_velocity(),
+                    ego_vehicle->get_length() });
+        }
         return 1;
     }
     default :
@@ -477,6 +722,122 @@ DRIVERMODEL_API  int  DriverModelExecuteCommand (long number)
     }
 }
 
+/*==========================================================================*/
+
+DRIVERMODEL_API  int  DriverModelReplayStepInputs (char *input_file,
+                                                   char *parameter_file,
+                                                   char *output_file,
+                                                   long n_threads)
+{
+    std::unordered_map<int, TrafficLight> replay_traffic_lights;
+    std::string network_file;
+    if (parameter_file != NULL && parameter_file[0] != '\0')
+    {
+        read_traffic_light_file(std::string(parameter_file),
+            replay_traffic_lights);
+        network_file = SignalGraph::network_file_name(
+            std::string(parameter_file));
+    }
+    StepInputReplayer replayer{ replay_traffic_lights, network_file,
+        static_cast<size_t>(std::max(n_threads, 0L)), USE_V2V_BOARD };
+    long n_steps = replayer.replay(input_file, output_file);
+    if (n_steps < 0) return 0;
+    std::clog << "Replayed " << n_steps << " time steps of "
+        << input_file << std::endl;
+    return 1;
+}
+
+/*--------------------------------------------------------------------------*/
+
+DRIVERMODEL_API  int  DriverModelCompareControlDecimation (char *input_file,
+                                                   char *parameter_file,
+                                                   char *output_file,
+                                                   long max_reused_steps,
+                                                   long n_threads)
+{
+    if (max_reused_steps <= 0)
+    {
+        std::clog << "Decimated control needs max_reused_steps > 0"
+            << std::endl;
+        return 0;
+    }
+    std::unordered_map<int, TrafficLight> replay_traffic_lights;
+    std::string network_file;
+    if (parameter_file != NULL && parameter_file[0] != '\0')
+    {
+        read_traffic_light_file(std::string(parameter_file),
+            replay_traffic_lights);
+        network_file = SignalGraph::network_file_name(
+            std::string(parameter_file));
+    }
+    /* The event thresholds are the ones of CONTROL_DECIMATION */
+    ControlDecimation::Parameters previous_parameters =
+        ControlDecimation::get_parameters();
+    ControlDecimation::Parameters parameters = CONTROL_DECIMATION;
+    parameters.max_reused_steps = max_reused_steps;
+    ControlDecimation::set_parameters(parameters);
+    StepInputReplayer replayer{ replay_traffic_lights, network_file,
+        static_cast<size_t>(std::max(n_threads, 0L)), USE_V2V_BOARD, true };
+    long n_steps = replayer.replay(input_file, output_file);
+    ControlDecimation::set_parameters(previous_parameters);
+    if (n_steps < 0) return 0;
+
+    const StepInputReplayer::DecimationComparison& comparison =
+        replayer.get_decimation_comparison();
+    long n_samples = std::max(comparison.n_samples, 1L);
+    std::clog << "Decimated (k = " << max_reused_steps
+        << ") vs full rate control over " << comparison.n_samples
+        << " vehicle steps of " << input_file << ":\n"
+        << "  different accelerations: "
+        << 100.0 * comparison.n_different / n_samples << "%"
+        << " (decimated larger in "
+        << 100.0 * comparison.n_larger / n_samples << "%)\n"
+        << "  mean |difference|: "
+        << comparison.sum_absolute_difference / n_samples << " m/s^2\n"
+        << "  rms difference: "
+        << std::sqrt(comparison.sum_squared_difference / n_samples)
+        << " m/s^2\n"
+        << "  max |difference|: " << comparison.max_absolute_difference
+        << " m/s^2" << std::endl;
+    return 1;
+}
+
+/*--------------------------------------------------------------------------*/
+
+DRIVERMODEL_API  int  DriverModelRunScalingBenchmark (char *traffic_light_file,
+                                                      char *results_file)
+{
+    ScalingBenchmark benchmark{ std::string(traffic_light_file) };
+    return benchmark.run_all(results_file) ? 1 : 0;
+}
+
+/*--------------------------------------------------------------------------*/
+
+DRIVERMODEL_API  int  DriverModelRunSpatialHashBenchmark (char *results_file)
+{
+    SpatialHashBenchmark benchmark;
+    return benchmark.run_all(results_file) ? 1 : 0;
+}
+
+/*--------------------------------------------------------------------------*/
+
+DRIVERMODEL_API  int  DriverModelRunInputDispatchBenchmark (char *results_file)
+{
+    InputDispatchBenchmark benchmark;
+    return benchmark.run_all(results_file) ? 1 : 0;
+}
+
+/*--------------------------------------------------------------------------*/
+
+DRIVERMODEL_API  int  DriverModelRunRegressionChecks (char *results_file)
+{
+    /* The replayer does not model the lane vehicle index, platoons or
+    V2V messages of the current step */
+    RegressionChecks regression_checks{
+        !BUILD_LANE_VEHICLE_INDEX && !FORM_PLATOONS && !USE_V2V_BOARD };
+    return regression_checks.run_all(results_file) ? 1 : 0;
+}
+
 /*==========================================================================*/
 /*  End of DriverModel.cpp                                                  */
 /*==========================================================================*/
@@ -486,6 +486,69 @@ DRIVERMODEL_API  int  DriverModelExecuteCommand (long number);
 /* Executes the command <number> if that is available in the driver */
 /* module. Return value is 1 on success, otherwise 0.               */
 
+/*--------------------------------------------------------------------------*/
+/* Functions that were not in the original DLL example */
+
+DRIVERMODEL_API  int  DriverModelReplayStepInputs (char *input_file,
+                                                   char *parameter_file,
+                                                   char *output_file,
+                                                   long n_threads);
+
+/* Replays a file of recorded DLL inputs (see StepInputRecorder) offline, */
+/* evaluating the vehicles of each time step on <n_threads> threads     */
+/* (0 = one per core). <parameter_file> is the traffic light file used  */
+/* in the recorded run. The desired accelerations and lane change       */
+/* decisions are written to <output_file>.                              */
+/* Return value is 1 on success, otherwise 0.                           */
+
+DRIVERMODEL_API  int  DriverModelCompareControlDecimation (char *input_file,
+                                                   char *parameter_file,
+                                                   char *output_file,
+                                                   long max_reused_steps,
+                                                   long n_threads);
+
+/* Replays a file of recorded DLL inputs as                              */
+/* DriverModelReplayStepInputs does, with decimated control (up to       */
+/* <max_reused_steps> reused steps, other thresholds from                */
+/* CONTROL_DECIMATION) and, on the same inputs, at full rate.            */
+/* <output_file> has both desired accelerations, and the differences     */
+/* are summarized in the log. Return value is 1 on success, otherwise 0. */
+
+DRIVERMODEL_API  int  DriverModelRunScalingBenchmark (char *traffic_light_file,
+                                                      char *results_file);
+
+/* Feeds synthetic VISSIM call sequences to this DLL and writes steps per */
+/* second, time per vehicle step and memory usage to <results_file> as  */
+/* the number of vehicles, nearby vehicles, vehicle turnover and traffic */
+/* lights grow. The layout in <traffic_light_file> is extrapolated to   */
+/* the required number of traffic lights. Must not be called while the  */
+/* DLL is used by VISSIM. Return value is 1 on success, otherwise 0.    */
+
+DRIVERMODEL_API  int  DriverModelRunSpatialHashBenchmark (char *results_file);
+
+/* Rebuilds the spatial hash of up to 50000 vehicles on a street grid   */
+/* every step, searches conflicts between vehicles on crossing streets  */
+/* and makes one radius query per vehicle, and writes the time of each  */
+/* to <results_file>. Return value is 1 on success, otherwise 0.        */
+
+DRIVERMODEL_API  int  DriverModelRunInputDispatchBenchmark (char *results_file);
+
+/* Applies the vehicle inputs of fleets of several sizes and numbers of  */
+/* nearby vehicles through the dispatch table (see VehicleInput) and     */
+/* through a switch that looks the vehicle up for every input, as the    */
+/* DLL did before the table, and writes the time per vehicle and per     */
+/* input of both to <results_file>. Return value is 1 on success,        */
+/* otherwise 0.                                                          */
+
+DRIVERMODEL_API  int  DriverModelRunRegressionChecks (char *results_file);
+
+/* Checks, without VISSIM, that replaying a recorded synthetic run       */
+/* (see DriverModelReplayStepInputs) gives the decisions the DLL returned */
+/* live, and that the traffic light, network and signal controller file  */
+/* readers accept valid files and reject malformed ones. Writes one line */
+/* per check to <results_file>. Must not be called while the DLL is used */
+/* by VISSIM. Return value is 1 if all checks pass, otherwise 0.         */
+
 /*==========================================================================*/
 
 #endif /* __DRIVERMODEL_H */
@@ -5,6 +5,7 @@
 #include <string>
 #include <sstream>
 
+#include "AllocationCounter.h"
 #include "ControlManager.h"
 #include "EgoVehicle.h"
 
@@ -124,7 +125,47 @@ void EgoVehicle::set_lane(long lane)
 }
 void EgoVehicle::set_link(long link) 
 {
+	/* The odometer is sent before the link */
+	if (this->link.empty() || this->link.back() != link)
+	{
+		odometer_at_link_entry = odometer;
+	}
 	this->link.push_back(link);
+	if (signal_graph != nullptr)
+	{
+		route_links.clear();
+		route_links.push_back(link);
+	}
+}
+void EgoVehicle::add_next_link(long next_link)
+{
+	if (signal_graph != nullptr) route_links.push_back(next_link);
+}
+void EgoVehicle::read_traffic_light(int traffic_light_id, double distance)
+{
+	traffic_light_events.clear();
+	if (traffic_light_id != signal_ahead_id)
+	{
+		if (signal_ahead_id != 0)
+		{
+			add_traffic_light_crossing_event();
+			add_event(Event::Type::traffic_light_crossing,
+				signal_ahead_id, traffic_light_id);
+			time_crossed_last_signal = get_time();
+			has_crossed_any_traffic_light = true;
+		}
+		if (traffic_light_id != 0)
+		{
+			start_traffic_light_approach(traffic_light_id, distance);
+		}
+	}
+	else
+	{
+		update_traffic_light_approach();
+	}
+	signal_ahead_id = traffic_light_id;
+	signal_ahead_distance = distance;
+	set_traffic_light_information(traffic_light_id, distance);
 }
 void EgoVehicle::set_lateral_position(double lateral_position) 
 {
@@ -175,18 +216,35 @@ void EgoVehicle::set_lane_end_distance(double lane_end_distance,
 
 void EgoVehicle::clear_nearby_vehicles() 
 {
+	for (std::shared_ptr<NearbyVehicle>& nearby_vehicle : nearby_vehicles)
+	{
+		/* The leader of the previous step is still referenced */
+		if (nearby_vehicle.use_count() == 1)
+		{
+			spare_nearby_vehicles.push_back(std::move(nearby_vehicle));
+		}
+	}
 	nearby_vehicles.clear();
 }
 
-void EgoVehicle::emplace_nearby_vehicle(long id, long relative_lane,
-	long relative_position) 
+NearbyVehicle* EgoVehicle::emplace_nearby_vehicle(long id,
+	long relative_lane, long relative_position) 
 {
 	/*if (verbose && get_time() > 68) std::clog << "Emplacing nv id=" << id
 		<< std::endl;*/
-	std::shared_ptr<NearbyVehicle> nearby_vehicle = 
-		std::shared_ptr<NearbyVehicle>(new NearbyVehicle(id, relative_lane,
-		relative_position));
-	nearby_vehicles.push_back(std::move(nearby_vehicle));
+	if (spare_nearby_vehicles.empty())
+	{
+		nearby_vehicles.push_back(std::shared_ptr<NearbyVehicle>(
+			new NearbyVehicle(id, relative_lane, relative_position)));
+	}
+	else
+	{
+		nearby_vehicles.push_back(std::move(spare_nearby_vehicles.back()));
+		spare_nearby_vehicles.pop_back();
+		*nearby_vehicles.back() = NearbyVehicle(id, relative_lane,
+			relative_position);
+	}
+	return nearby_vehicles.back().get();
 }
 
 std::shared_ptr<NearbyVehicle> EgoVehicle::peek_nearby_vehicles() const 
@@ -280,13 +338,230 @@ void EgoVehicle::find_relevant_nearby_vehicles()
 
 void EgoVehicle::find_leader()
 {
+	AllocationCounter::Scope scope{
+		AllocationCounter::Subsystem::histories };
+
 	std::shared_ptr<NearbyVehicle> old_leader = std::move(leader);
 	
 	for (auto& nearby_vehicle : nearby_vehicles)
 	{
 		if (check_if_is_leader(*nearby_vehicle)) leader = nearby_vehicle;
 	}
+	long old_leader_id = old_leader != nullptr ? old_leader->get_id() : 0;
 	leader_id.push_back(has_leader() ? leader->get_id() : 0);
+
+	if (get_leader_id() != old_leader_id)
+	{
+		Event::Type type = has_leader() && leader->is_cutting_in() ?
+			Event::Type::cut_in : Event::Type::leader_change;
+		add_event(type, old_leader_id, get_leader_id());
+	}
+}
+
+void EgoVehicle::update_perception_frame(
+	const std::unordered_map<int, TrafficLight>& traffic_lights)
+{
+	/* Members not set below keep the defaults (no leader, no light) */
+	PerceptionFrame frame;
+	frame.time = get_time();
+	frame.velocity = get_velocity();
+	frame.desired_velocity = get_desired_velocity();
+
+	frame.has_leader = has_leader();
+	if (frame.has_leader)
+	{
+		frame.is_leader_connected = is_connected && leader->is_connected();
+		frame.is_leader_cutting_in = leader->is_cutting_in();
+		frame.leader_id = leader->get_id();
+		frame.gap = compute_gap(*leader);
+		frame.relative_velocity = leader->get_relative_velocity();
+		frame.leader_velocity = leader->compute_velocity(frame.velocity);
+		frame.leader_acceleration = leader->get_acceleration();
+		const V2VBoard::Message* message = frame.is_leader_connected
+			&& v2v_board != nullptr ?
+			v2v_board->read(frame.leader_id) : nullptr;
+		if (message != nullptr)
+		{
+			/* The leader's command of this step if it was evaluated
+			before this vehicle and the board allows reading the current
+			step. Otherwise it is as old as the acceleration reported by
+			VISSIM. */
+			frame.leader_acceleration = message->acceleration;
+			frame.has_leader_v2v_message = true;
+		}
+		if (lane_vehicle_index != nullptr)
+		{
+			find_queue_ahead(frame);
+		}
+	}
+
+	frame.traffic_light_id = get_next_traffic_light_id();
+	auto traffic_light_it = traffic_lights.find(frame.traffic_light_id);
+	if (frame.traffic_light_id != 0
+		&& traffic_light_it != traffic_lights.end())
+	{
+		const TrafficLight& next_traffic_light = traffic_light_it->second;
+		frame.has_traffic_light = true;
+		frame.distance_to_traffic_light =
+			get_distance_to_next_traffic_light();
+		frame.traffic_light_state = next_traffic_light.get_current_state();
+		frame.time_of_next_red = next_traffic_light.get_time_of_next_red();
+		if (signal_graph != nullptr)
+		{
+			signal_graph->locate(route_links, route_cursor);
+			SignalGraph::SignalAhead following =
+				signal_graph->find_following_signal(route_cursor,
+					frame.traffic_light_id);
+			if (following.traffic_light_id != 0)
+			{
+				frame.distance_between_traffic_lights = following.distance;
+			}
+		}
+		else
+		{
+			auto next_next_it = traffic_lights.find(
+				frame.traffic_light_id + 1);
+			if (next_next_it != traffic_lights.end())
+			{
+				frame.distance_between_traffic_lights =
+					next_next_it->second.get_position()
+					- next_traffic_light.get_position();
+			}
+		}
+	}
+	perception_frame = frame;
+}
+
+void EgoVehicle::connect_to_v2v_board(V2VBoard* board)
+{
+	if (!is_connected) return;
+	v2v_board = board;
+	if (v2v_board != nullptr) v2v_board->add_vehicle(get_id());
+}
+
+void EgoVehicle::connect_to_platoon_manager(PlatoonManager* manager)
+{
+	if (get_type() != VehicleType::platoon_car) return;
+	platoon_manager = manager;
+}
+
+void EgoVehicle::connect_to_signal_graph(SignalGraph* graph)
+{
+	signal_graph = graph;
+	route_cursor = SignalGraph::RouteCursor();
+}
+
+void EgoVehicle::connect_to_lane_vehicle_index(const LaneVehicleIndex* index)
+{
+	lane_vehicle_index = index;
+}
+
+void EgoVehicle::find_queue_ahead(PerceptionFrame& frame) const
+{
+	const LaneVehicleIndex::Entry* leader_entry =
+		lane_vehicle_index->find(frame.leader_id);
+	if (leader_entry == nullptr
+		|| leader_entry->velocity >= LaneVehicleIndex::queued_velocity)
+	{
+		return;
+	}
+	/* The queue starts at the leader and goes on with the vehicles queued
+	ahead of it on the same lane */
+	LaneVehicleIndex::QueueAhead queue =
+		lane_vehicle_index->get_queue_ahead(frame.leader_id);
+	const LaneVehicleIndex::Entry* queue_front = queue.n_vehicles > 0 ?
+		lane_vehicle_index->get_vehicle_ahead(frame.leader_id,
+			queue.n_vehicles)
+		: leader_entry;
+	frame.is_leader_queued = true;
+	frame.distance_to_queue_front = frame.gap + leader_entry->length
+		+ queue_front->position - leader_entry->position;
+}
+
+void EgoVehicle::start_traffic_light_approach(
+	int traffic_light_id, double distance)
+{
+	approach_start_time = get_time();
+	approach_start_distance = distance;
+	number_of_stops_in_approach = 0;
+	has_arrived_at_traffic_light = false;
+	is_stopped = get_velocity() < STOPPED_VELOCITY;
+	/* Vehicles entering the approach stopped are already in the queue */
+	if (is_stopped) add_traffic_light_arrival_event(traffic_light_id);
+}
+
+void EgoVehicle::update_traffic_light_approach()
+{
+	/* A stop is counted when the vehicle goes from moving to stopped */
+	bool was_stopped = is_stopped;
+	is_stopped = get_velocity() < STOPPED_VELOCITY;
+	if (is_stopped && !was_stopped)
+	{
+		number_of_stops_in_approach++;
+		/* The first stop is when the vehicle joins the queue */
+		if (!has_arrived_at_traffic_light)
+		{
+			add_traffic_light_arrival_event(signal_ahead_id);
+		}
+	}
+}
+
+void EgoVehicle::add_traffic_light_arrival_event(int traffic_light_id)
+{
+	has_arrived_at_traffic_light = true;
+	TrafficLightEvent arrival;
+	arrival.type = TrafficLightEvent::Type::arrival;
+	arrival.vehicle_id = get_id();
+	arrival.traffic_light_id = traffic_light_id;
+	arrival.time = get_time();
+	traffic_light_events.push_back(arrival);
+}
+
+void EgoVehicle::add_traffic_light_crossing_event()
+{
+	/* Vehicles that never stopped arrive when they reach the stop line */
+	if (!has_arrived_at_traffic_light)
+	{
+		add_traffic_light_arrival_event(signal_ahead_id);
+	}
+
+	double time = get_time();
+	double free_flow_time = get_desired_velocity() > 0 ?
+		approach_start_distance / get_desired_velocity() : 0.0;
+
+	TrafficLightEvent crossing;
+	crossing.type = TrafficLightEvent::Type::crossing;
+	crossing.vehicle_id = get_id();
+	crossing.traffic_light_id = signal_ahead_id;
+	crossing.time = time;
+	crossing.control_delay = std::max(
+		time - approach_start_time - free_flow_time, 0.0);
+	crossing.number_of_stops = number_of_stops_in_approach;
+	if (has_crossed_any_traffic_light)
+	{
+		crossing.travel_time_from_last_traffic_light =
+			time - time_crossed_last_signal;
+	}
+	traffic_light_events.push_back(crossing);
+}
+
+void EgoVehicle::set_perceived_traffic_light(bool has_traffic_light,
+	double time_of_next_red)
+{
+	perception_frame.has_traffic_light = has_traffic_light;
+	perception_frame.time_of_next_red = time_of_next_red;
+}
+
+void EgoVehicle::publish_to_v2v_board(double commanded_acceleration)
+{
+	if (v2v_board == nullptr) return;
+	V2VBoard::Message message;
+	message.velocity = get_velocity();
+	message.acceleration = commanded_acceleration;
+	message.horizon_velocity = std::max(message.velocity
+		+ commanded_acceleration * V2VBoard::intent_horizon, 0.0);
+	message.controller_mode = get_controller_mode();
+	v2v_board->publish(get_id(), message);
 }
 
 bool EgoVehicle::check_if_is_leader(const NearbyVehicle& nearby_vehicle) const
@@ -304,10 +579,24 @@ bool EgoVehicle::check_if_is_leader(const NearbyVehicle& nearby_vehicle) const
 	return false;
 }
 
+void EgoVehicle::add_event(Event::Type type, long previous_value,
+	long new_value)
+{
+	Event event;
+	event.type = type;
+	event.time = get_time();
+	event.previous_value = previous_value;
+	event.new_value = new_value;
+	events.push_back(event);
+}
+
 /* State-machine related methods ------------------------------------------ */
 
 void EgoVehicle::update_state() 
 {
+	AllocationCounter::Scope scope{
+		AllocationCounter::Subsystem::histories };
+
 	set_desired_lane_change_direction();
 
 	State old_state = get_state();
@@ -367,6 +656,60 @@ long EgoVehicle::decide_lane_change_direction()
 	return 0;
 }
 
+LaneChangeGapAcceptance::Candidate EgoVehicle::get_lane_change_candidate()
+	const
+{
+	const LongitudinalControllerWithTrafficLights::Parameters&
+		controller_parameters =
+		controller.get_longitudinal_controller_parameters();
+	LaneChangeGapAcceptance::Candidate candidate;
+	candidate.velocity = get_velocity();
+	candidate.time_headway = controller_parameters.time_headway;
+	candidate.standstill_distance =
+		controller_parameters.standstill_distance;
+	for (const std::shared_ptr<NearbyVehicle>& nearby_vehicle :
+		nearby_vehicles)
+	{
+		if (nearby_vehicle->get_relative_lane()
+			!= desired_lane_change_direction) continue;
+		double gap = compute_gap(*nearby_vehicle);
+		if (nearby_vehicle->is_ahead())
+		{
+			if (gap >= candidate.leader_gap) continue;
+			candidate.leader_gap = gap;
+			candidate.leader_velocity =
+				nearby_vehicle->compute_velocity(candidate.velocity);
+		}
+		else
+		{
+			if (gap >= candidate.follower_gap) continue;
+			candidate.follower_gap = gap;
+			candidate.follower_velocity =
+				nearby_vehicle->compute_velocity(candidate.velocity);
+		}
+	}
+
+	const PerceptionFrame& frame = perception_frame;
+	if (frame.has_traffic_light)
+	{
+		candidate.distance_to_traffic_light =
+			frame.distance_to_traffic_light;
+		if (frame.traffic_light_state == TrafficLight::State::green)
+		{
+			candidate.green_time_left = frame.time_of_next_red - frame.time;
+		}
+	}
+	return candidate;
+}
+
+bool EgoVehicle::can_start_lane_change() const
+{
+	/* Vehicles share the braking and dilemma zone parameters, as in the
+	batched evaluation of the replayer */
+	static const LaneChangeGapAcceptance gap_acceptance;
+	return gap_acceptance.accepts(get_lane_change_candidate());
+}
+
 /* Private methods -------------------------------------------------------- */
 
 void EgoVehicle::set_desired_lane_change_direction() 
@@ -471,6 +814,15 @@ std::string EgoVehicle::write_members(
 		members.erase(std::next(members.begin(), idx));
 	}
 
+	/* Compressed histories can only be read sequentially */
+	CompressedTimeSeries::Reader velocity_reader = velocity.get_reader();
+	CompressedTimeSeries::Reader acceleration_reader =
+		acceleration.get_reader();
+	CompressedTimeSeries::Reader desired_acceleration_reader =
+		desired_acceleration.get_reader();
+	CompressedTimeSeries::Reader vissim_acceleration_reader =
+		vissim_acceleration.get_reader();
+
 	// Write variables over time
 	for (int i = 0; i < n_samples; i++) 
 	{
@@ -506,16 +858,16 @@ std::string EgoVehicle::write_members(
 				oss << preferred_relative_lane[i].to_string();
 				break;
 			case Member::velocity:
-				oss << velocity[i];
+				oss << velocity_reader.next();
 				break;
 			case Member::acceleration:
-				oss << acceleration[i];
+				oss << acceleration_reader.next();
 				break;
 			case Member::desired_acceleration:
-				oss << desired_acceleration[i];
+				oss << desired_acceleration_reader.next();
 				break;
 			case Member::vissim_acceleration:
-				oss << vissim_acceleration[i];
+				oss << vissim_acceleration_reader.next();
 				break;
 			case Member::leader_id:
 				oss << leader_id[i];
@@ -635,6 +987,9 @@ EgoVehicle::state_to_string_map =
 
 std::ostream& operator<< (std::ostream& out, const EgoVehicle& vehicle)
 {
+	AllocationCounter::Scope scope{
+		AllocationCounter::Subsystem::logging };
+
 	out << "t=" << vehicle.get_time()
 		<< ", id=" << vehicle.get_id()
 		<< ", type=" << static_cast<int>(vehicle.get_type())
@@ -10,10 +10,18 @@
 #include <memory>
 #include <vector>
 
+#include "CompressedTimeSeries.h"
 #include "ControlManager.h"
+#include "LaneChangeGapAcceptance.h"
+#include "LaneVehicleIndex.h"
 #include "NearbyVehicle.h"
+#include "PerceptionFrame.h"
+#include "PlatoonManager.h"
+#include "SignalGraph.h"
 #include "TrafficLight.h"
+#include "V2VBoard.h"
 #include "Vehicle.h"
+#include "VehicleMemoryPool.h"
 
 
 class EgoVehicle : public Vehicle {
@@ -24,10 +32,33 @@ public:
 		intention_to_change_lanes,
 	};
 
+	/* Discrete changes in the vehicle's decisions or surroundings */
+	struct Event {
+		enum class Type {
+			mode_transition,
+			leader_change,
+			cut_in,
+			traffic_light_crossing,
+		};
+		Type type{ Type::mode_transition };
+		double time{ 0.0 };
+		/* Controller modes, leader ids or traffic light ids */
+		long previous_value{ 0 };
+		long new_value{ 0 };
+	};
+
 	/* Constructor and Destructor ----------------------------------------- */
 	EgoVehicle() = default;
 	virtual ~EgoVehicle();
 
+	/* Vehicle objects are recycled (see VehicleMemoryPool) */
+	static void* operator new(size_t size) {
+		return VehicleMemoryPool::allocate(size);
+	};
+	static void operator delete(void* pointer, size_t size) {
+		VehicleMemoryPool::deallocate(pointer, size);
+	};
+
 	/* Getters and setters ------------------------------------------------ */
 
 	double get_sampling_interval() const { return simulation_time_step; };
@@ -46,6 +77,25 @@ public:
 		return vissim_use_preferred_lane; 
 	};
 	bool get_is_connected() const { return is_connected; };
+	/* Distance traveled in the network [m] */
+	double get_odometer() const { return odometer; };
+	/* Distance traveled since entering the current link. VISSIM sends no
+	link coordinate, so the point of entry is only known to within one
+	step [m] */
+	double get_position_on_link() const {
+		return odometer - odometer_at_link_entry;
+	};
+	/* World coordinates of the middle of the front and rear ends [m] */
+	double get_front_x() const { return front_x; };
+	double get_front_y() const { return front_y; };
+	double get_rear_x() const { return rear_x; };
+	double get_rear_y() const { return rear_y; };
+	/* Next signal head as last sent by VISSIM, for all vehicle types. Zero
+	id if none. */
+	int get_signal_ahead_id() const { return signal_ahead_id; };
+	double get_signal_ahead_distance() const {
+		return signal_ahead_distance;
+	};
 
 	void set_desired_velocity(double desired_velocity) {
 		this->desired_velocity = desired_velocity;
@@ -59,6 +109,11 @@ public:
 	void set_vissim_use_preferred_lane(long value) {
 		this->vissim_use_preferred_lane = value;
 	};
+	void set_odometer(double odometer) { this->odometer = odometer; };
+	void set_front_x(double front_x) { this->front_x = front_x; };
+	void set_front_y(double front_y) { this->front_y = front_y; };
+	void set_rear_x(double rear_x) { this->rear_x = rear_x; };
+	void set_rear_y(double rear_y) { this->rear_y = rear_y; };
 
 	/* Getters of most recent values -------------------------------------- */
 	
@@ -75,6 +130,20 @@ public:
 	double get_lane_end_distance() const;
 	long get_leader_id() const;
 	State get_state() const;
+	LongitudinalControllerWithTrafficLights::State get_controller_mode() const
+	{
+		return controller.get_longitudinal_controller_state();
+	};
+	/* Quantities derived from the inputs of the current time step. Valid
+	after get_desired_acceleration is called. */
+	const PerceptionFrame& get_perception_frame() const {
+		return perception_frame;
+	};
+	virtual int get_next_traffic_light_id() const { return 0; };
+	/* Negative if there is no known traffic light ahead */
+	virtual double get_distance_to_next_traffic_light() const { 
+		return -1.0; 
+	};
 
 	/* Other getters and setters ------------------------------------------ */
 
@@ -91,18 +160,47 @@ public:
 	void set_relative_target_lane(long target_relative_lane);
 	void set_lane_end_distance(double lane_end_distance,
 		long lane_number);
-	void read_traffic_light(int traffic_light_id, double distance)
+	/* Following links of the vehicle's route, sent after the current link
+	(see set_link). Only kept when connected to a signal graph. */
+	void add_next_link(long next_link);
+	/* Also tracks the approach to the signal ahead, for all vehicle
+	types, to report arrivals and crossings (see TrafficLightEvent) */
+	void read_traffic_light(int traffic_light_id, double distance);
+	/* Arrivals at and crossings of traffic lights detected during the
+	last call to read_traffic_light */
+	const std::vector<TrafficLightEvent>& get_traffic_light_events() const
 	{
-		set_traffic_light_information(traffic_light_id, distance);
-	}
+		return traffic_light_events;
+	};
+
+	/* Connected vehicles read their leader's messages from the board and,
+	if they publish (see TrafficLightCACCVehicle), write their own.
+	Non-connected vehicles ignore the board. */
+	void connect_to_v2v_board(V2VBoard* board);
+	/* Platoon cars report to the manager every step to form and leave
+	platoons (see PlatoonVehicle). Other vehicle types ignore it. */
+	void connect_to_platoon_manager(PlatoonManager* manager);
+	/* With a signal graph, the traffic light after the next one is found
+	along the vehicle's route. Otherwise traffic lights are assumed to be
+	on a single corridor, ordered by id. */
+	void connect_to_signal_graph(SignalGraph* graph);
+	/* With the lane vehicle index, the vehicle knows whether its leader is
+	part of a queue, and how far the queue reaches (see PerceptionFrame) */
+	void connect_to_lane_vehicle_index(const LaneVehicleIndex* index);
+	/* Evaluates the controller every step even with decimated control
+	(see ControlDecimation) */
+	void set_full_rate_control() { controller.set_full_rate_control(); };
 
 	/* Dealing with nearby vehicles --------------------------------------- */
 
-	/* Clears the vector of pointers */
+	/* Clears the vector of pointers. Objects no longer referenced are kept
+	for reuse by the following steps. */
 	void clear_nearby_vehicles();
 	/* Creates an instance of nearby vehicle and populates it with 
-	the given data. */
-	void emplace_nearby_vehicle(long id, long relative_lane,
+	the given data. Returns the new nearby vehicle, which is valid until
+	the nearby vehicles are cleared. Reuses objects of previous steps, so
+	receiving many nearby vehicles per step does not allocate. */
+	NearbyVehicle* emplace_nearby_vehicle(long id, long relative_lane,
 		long relative_position);
 	/* Returns the most recently added nearby vehicle */
 	std::shared_ptr<NearbyVehicle> peek_nearby_vehicles() const;
@@ -118,6 +216,8 @@ public:
 	/* Returns a nullptr if there is no leader */
 	std::shared_ptr<NearbyVehicle> get_leader() const;
 	std::shared_ptr<NearbyVehicle> get_nearby_vehicle_by_id(long nv_id) const;
+	const std::vector<std::shared_ptr<NearbyVehicle>>&
+		get_nearby_vehicles() const { return nearby_vehicles; };
 	/* Computes the bumper-to-bumper distance between vehicles.
 	Returns MAX_DISTANCE if nearby_vehicle is empty. */
 	double compute_gap(const NearbyVehicle& nearby_vehicle) const;
@@ -142,13 +242,22 @@ public:
 	double get_desired_acceleration(
 		const std::unordered_map<int, TrafficLight>& traffic_lights)
 	{
-		return compute_desired_acceleration(traffic_lights);
+		update_perception_frame(traffic_lights);
+		desired_acceleration.push_back(
+			compute_desired_acceleration());
+		return desired_acceleration.back();
 	};
 
 	long decide_lane_change_direction();
+	/* Gaps on the lane of the desired lane change and proximity to the
+	next traffic light. Valid after get_desired_acceleration is called. */
+	LaneChangeGapAcceptance::Candidate get_lane_change_candidate() const;
 
 	/* Methods for logging --------------------------------------------------- */
 	bool is_verbose() const { return verbose; };
+	/* Events that happened since the last call to clear_events */
+	const std::vector<Event>& get_events() const { return events; };
+	void clear_events() { events.clear(); };
 
 	/* Print function */
 	friend std::ostream& operator<< (std::ostream& out, 
@@ -165,22 +274,51 @@ protected:
 
 	void find_leader();
 	std::vector<std::shared_ptr<NearbyVehicle>> nearby_vehicles;
+	/* Objects of previous steps waiting to be reused */
+	std::vector<std::shared_ptr<NearbyVehicle>> spare_nearby_vehicles;
+
+	std::vector<TrafficLightEvent> traffic_light_events;
+
+	void add_event(Event::Type type, long previous_value, long new_value);
+	std::vector<Event> events;
 
 	bool verbose = false; /* used in several parts of the code to print out 
 						  vehicle information during tests. */
 
+	/* Publishes the commanded acceleration and intent, if connected to
+	a board */
+	void publish_to_v2v_board(double commanded_acceleration);
+	/* Safe gaps on the target lane and not in a dilemma zone (see
+	LaneChangeGapAcceptance) */
+	bool can_start_lane_change() const;
+	/* Replaces what the vehicle perceives of the next traffic light, for
+	vehicles that decide their approach as a group (see PlatoonVehicle) */
+	void set_perceived_traffic_light(bool has_traffic_light,
+		double time_of_next_red);
+
+	PlatoonManager* platoon_manager{ nullptr };
+
 private:
 	/* Computes the longitudinal controller input */
-	virtual double compute_desired_acceleration(
-		const std::unordered_map<int, TrafficLight>& traffic_lights) = 0;
-	virtual bool can_start_lane_change() = 0;
+	virtual double compute_desired_acceleration() = 0;
 	virtual void set_traffic_light_information(int traffic_light_id,
 		double distance) {};
 	
 	/* Finds the current leader */
 	virtual void find_relevant_nearby_vehicles();
+	void update_perception_frame(
+		const std::unordered_map<int, TrafficLight>& traffic_lights);
+	void find_queue_ahead(PerceptionFrame& frame) const;
 	void set_desired_lane_change_direction();
 
+	/* Approach to the signal ahead (used for KPIs) */
+	void start_traffic_light_approach(int traffic_light_id,
+		double distance);
+	void update_traffic_light_approach();
+	void add_traffic_light_arrival_event(int traffic_light_id);
+	/* Also adds the arrival if the vehicle did not stop in the approach */
+	void add_traffic_light_crossing_event();
+
 	bool check_if_is_leader(const NearbyVehicle& nearby_vehicle) const;
 
 	/* Estimated parameters used for safe gap computations (no direct 
@@ -190,6 +328,14 @@ private:
 
 	std::shared_ptr<NearbyVehicle> leader{ nullptr };
 	std::vector<long> leader_id;
+	PerceptionFrame perception_frame;
+	V2VBoard* v2v_board{ nullptr };
+	SignalGraph* signal_graph{ nullptr };
+	const LaneVehicleIndex* lane_vehicle_index{ nullptr };
+	/* Current link followed by the next links of the route, as received
+	in the current step */
+	std::vector<long> route_links;
+	SignalGraph::RouteCursor route_cursor;
 
 	/* Data obtained from VISSIM or generated by internal computations ---- */
 	double creation_time{ 0.0 };
@@ -206,11 +352,13 @@ private:
 	/* distance of the front end from the middle of the lane [m]
 	(positive = left of the middle, negative = right) */
 	std::vector<double> lateral_position;
-	std::vector<double> velocity;
-	std::vector<double> acceleration;
-	std::vector<double> desired_acceleration;
+	/* The histories below are the bulk of the memory used by the DLL, so
+	they are stored compressed (error bounded by HISTORY_RESOLUTION / 2) */
+	CompressedTimeSeries velocity{ HISTORY_RESOLUTION };
+	CompressedTimeSeries acceleration{ HISTORY_RESOLUTION };
+	CompressedTimeSeries desired_acceleration{ HISTORY_RESOLUTION };
 	/* VISSIM suggested acceleration */
-	std::vector<double> vissim_acceleration;
+	CompressedTimeSeries vissim_acceleration{ HISTORY_RESOLUTION };
 	/* +1 = to the left, 0 = none, -1 = to the right */
 	std::vector<RelativeLane> active_lane_change_direction;
 	/* Determines if we use our lane change decision model or VISSIM's */
@@ -223,6 +371,22 @@ private:
 	double desired_lane_angle{ 0.0 };
 	RelativeLane relative_target_lane{ RelativeLane::same };
 	long turning_indicator{ 0 };
+	double odometer{ 0.0 }; // [m]
+	double odometer_at_link_entry{ 0.0 }; // [m]
+	double front_x{ 0.0 }; // [m]
+	double front_y{ 0.0 }; // [m]
+	double rear_x{ 0.0 }; // [m]
+	double rear_y{ 0.0 }; // [m]
+	int signal_ahead_id{ 0 };
+	double signal_ahead_distance{ 0.0 }; // [m]
+	bool has_crossed_any_traffic_light{ false };
+	double time_crossed_last_signal{ 0.0 }; // [s]
+	double approach_start_time{ 0.0 }; // [s]
+	double approach_start_distance{ 0.0 }; // [m]
+	int number_of_stops_in_approach{ 0 };
+	bool is_stopped{ false };
+	/* Whether the arrival event of the current approach was added */
+	bool has_arrived_at_traffic_light{ false };
 	
 	/* For printing and debugging purporses ------------------------------- */
 	static const std::unordered_map<State, std::string> state_to_string_map;
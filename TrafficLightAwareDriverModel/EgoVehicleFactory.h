@@ -8,6 +8,7 @@
 
 #include <memory>
 
+#include "PlatoonVehicle.h"
 #include "TrafficLightACCVehicle.h"
 
 class EgoVehicleFactory
@@ -28,6 +29,10 @@ public:
 			return std::make_unique<TrafficLightCACCVehicle>(id,
 				desired_velocity,
 				simulation_time_step, creation_time, verbose);
+		case VehicleType::platoon_car:
+			return std::make_unique<PlatoonVehicle>(id,
+				desired_velocity,
+				simulation_time_step, creation_time, verbose);
 		default:
 			std::clog << "Trying to create unknown vehicle type\n" 
 				<< "\ttime=" << creation_time
@@ -0,0 +1,230 @@
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+#include "EmissionsEstimator.h"
+#include "SimulationLogger.h"
+
+/* Ahn, Rakha, Trani and Van Aerde, "Estimating vehicle fuel consumption
+and emissions based on instantaneous speed and acceleration levels",
+Journal of Transportation Engineering, 2002. Composite light duty vehicle.
+Rows: powers of speed. Columns: powers of acceleration. */
+const EmissionsEstimator::VtMicroCoefficients
+EmissionsEstimator::coefficients[n_vehicle_classes] = {
+	/* light duty (gasoline) */
+	{
+		{
+			{ -7.73452, 0.22946, -0.00561, 9.77e-05 },
+			{ 0.02799, 0.0068, -0.00077221, 8.38e-06 },
+			{ -0.0002228, -4.402e-05, 7.90e-07, 8.17e-07 },
+			{ 1.09e-06, 4.80e-08, 3.27e-08, -7.79e-09 },
+		},
+		{
+			{ -7.73452, -0.01799, -0.00427, 0.00018829 },
+			{ 0.02804, 0.00772, 0.00083744, -3.387e-05 },
+			{ -0.00021988, -5.219e-05, -7.44e-06, 2.77e-07 },
+			{ 1.08e-06, 2.47e-07, 4.87e-08, 3.79e-10 },
+		},
+		2.31
+	},
+};
+
+/* Range of the data used to calibrate the model */
+const double MAX_MODEL_VELOCITY{ 120.0 }; // [km/h]
+const double MIN_MODEL_ACCELERATION{ -5.0 * 3.6 }; // [km/h/s]
+const double MAX_MODEL_ACCELERATION{ 3.7 * 3.6 }; // [km/h/s]
+
+EmissionsEstimator::~EmissionsEstimator()
+{
+	write_results();
+}
+
+void EmissionsEstimator::add_sample(long vehicle_id, long link,
+	VehicleCategory category, double velocity, double acceleration)
+{
+	VehicleClass vehicle_class;
+	if (!category_to_class(category, vehicle_class)) return;
+	SampleBatch& batch = batches[vehicle_class];
+	batch.vehicle_id.push_back(vehicle_id);
+	batch.link.push_back(link);
+	batch.velocity.push_back(
+		std::min(std::max(velocity * 3.6, 0.0), MAX_MODEL_VELOCITY));
+	batch.acceleration.push_back(
+		std::min(std::max(acceleration * 3.6, MIN_MODEL_ACCELERATION),
+			MAX_MODEL_ACCELERATION));
+	batch.positive_weight.push_back(
+		batch.acceleration.back() >= 0 ? 1.0 : 0.0);
+
+	Totals& vehicle_totals = totals_per_vehicle[vehicle_id];
+	vehicle_totals.category = category;
+}
+
+void EmissionsEstimator::process_samples(double time_step)
+{
+	last_time_step = time_step;
+	for (int c = 0; c < n_vehicle_classes; c++)
+	{
+		SampleBatch& batch = batches[c];
+		size_t n_samples = batch.velocity.size();
+		if (n_samples == 0) continue;
+
+		batch.fuel_rate.resize(n_samples);
+		compute_fuel_rates(coefficients[c], batch.velocity.data(),
+			batch.acceleration.data(), batch.positive_weight.data(),
+			batch.fuel_rate.data(), n_samples);
+		accumulate(VehicleClass(c), time_step);
+		batch.clear();
+	}
+
+	for (long vehicle_id : removed_vehicles)
+	{
+		auto it = totals_per_vehicle.find(vehicle_id);
+		if (it != totals_per_vehicle.end())
+		{
+			write_vehicle_totals(vehicle_id, it->second);
+			totals_per_vehicle.erase(it);
+		}
+	}
+	removed_vehicles.clear();
+}
+
+void EmissionsEstimator::remove_vehicle(long vehicle_id)
+{
+	removed_vehicles.insert(vehicle_id);
+}
+
+void EmissionsEstimator::write_results()
+{
+	process_samples(last_time_step);
+	for (const auto& pair : totals_per_vehicle)
+	{
+		write_vehicle_totals(pair.first, pair.second);
+	}
+	totals_per_vehicle.clear();
+	if (vehicle_file.is_open()) vehicle_file.close();
+
+	if (totals_per_link.empty()) return;
+	std::ofstream link_file;
+	if (!SimulationLogger::open_results_file(link_file, link_file_name,
+		"link, vehicle distance [m], fuel [L], CO2 [kg]"))
+	{
+		std::clog << "Unable to open the link emissions file." << std::endl;
+		return;
+	}
+	for (const auto& pair : totals_per_link)
+	{
+		link_file << run_id
+			<< ", " << pair.first
+			<< ", " << pair.second.distance
+			<< ", " << pair.second.fuel
+			<< ", " << pair.second.co2
+			<< "\n";
+	}
+	totals_per_link.clear();
+}
+
+bool EmissionsEstimator::category_to_class(VehicleCategory category,
+	VehicleClass& vehicle_class)
+{
+	switch (category)
+	{
+	case VehicleCategory::truck:
+	case VehicleCategory::bus:
+		return false;
+	default:
+		vehicle_class = light_duty;
+		return true;
+	}
+}
+
+void EmissionsEstimator::compute_fuel_rates(
+	const VtMicroCoefficients& coefficients, const double* velocity,
+	const double* acceleration, const double* positive_weight,
+	double* fuel_rate, size_t n_samples)
+{
+	const double(&p)[4][4] = coefficients.positive;
+	const double(&n)[4][4] = coefficients.negative;
+	/* No branches, comparisons or data dependent coefficients inside the
+	loop: both polynomials are evaluated (Horner's method) and one is
+	selected by a weight that is either 0 or 1. Selecting with a comparison
+	would keep compilers from vectorizing the loop without fast math, since
+	comparisons may raise floating point exceptions. The loop holds ln(F)
+	in fuel_rate. */
+	for (size_t k = 0; k < n_samples; k++)
+	{
+		double v = velocity[k];
+		double a = acceleration[k];
+		double pos_poly = 0.0;
+		double neg_poly = 0.0;
+		for (int i = 3; i >= 0; i--)
+		{
+			pos_poly = pos_poly * v
+				+ (p[i][0] + a * (p[i][1] + a * (p[i][2] + a * p[i][3])));
+			neg_poly = neg_poly * v
+				+ (n[i][0] + a * (n[i][1] + a * (n[i][2] + a * n[i][3])));
+		}
+		fuel_rate[k] = positive_weight[k] * pos_poly
+			+ (1.0 - positive_weight[k]) * neg_poly;
+	}
+	for (size_t k = 0; k < n_samples; k++)
+	{
+		fuel_rate[k] = std::exp(fuel_rate[k]);
+	}
+}
+
+void EmissionsEstimator::accumulate(VehicleClass vehicle_class,
+	double time_step)
+{
+	const SampleBatch& batch = batches[vehicle_class];
+	double co2_per_liter = coefficients[vehicle_class].co2_per_liter;
+	for (size_t k = 0; k < batch.fuel_rate.size(); k++)
+	{
+		double fuel = batch.fuel_rate[k] * time_step;
+		double distance = batch.velocity[k] / 3.6 * time_step;
+
+		Totals& vehicle_totals = totals_per_vehicle[batch.vehicle_id[k]];
+		vehicle_totals.distance += distance;
+		vehicle_totals.fuel += fuel;
+		vehicle_totals.co2 += fuel * co2_per_liter;
+
+		Totals& link_totals = totals_per_link[batch.link[k]];
+		link_totals.distance += distance;
+		link_totals.fuel += fuel;
+		link_totals.co2 += fuel * co2_per_liter;
+	}
+}
+
+void EmissionsEstimator::write_vehicle_totals(long vehicle_id,
+	const Totals& totals)
+{
+	if (!vehicle_file.is_open())
+	{
+		if (!SimulationLogger::open_results_file(vehicle_file,
+			vehicle_file_name, "vehicle id, category, distance [m], "
+			"fuel [L], CO2 [kg]"))
+		{
+			std::clog << "Unable to open the vehicle emissions file."
+				<< std::endl;
+			return;
+		}
+	}
+	vehicle_file << run_id
+		<< ", " << vehicle_id
+		<< ", " << static_cast<int>(totals.category)
+		<< ", " << totals.distance
+		<< ", " << totals.fuel
+		<< ", " << totals.co2
+		<< "\n";
+}
+
+void EmissionsEstimator::SampleBatch::clear()
+{
+	/* clear keeps the capacity, so there are no allocations after the
+	first few steps */
+	vehicle_id.clear();
+	link.clear();
+	velocity.clear();
+	acceleration.clear();
+	positive_weight.clear();
+	fuel_rate.clear();
+}
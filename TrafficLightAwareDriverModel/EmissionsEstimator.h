@@ -0,0 +1,102 @@
+/*==========================================================================*/
+/*  EmissionsEstimator.h													*/
+/*  Fuel consumption and CO2 estimation using a VT-Micro type model			*/
+/*                                                                          */
+/*  Version of 2022-06	                              Fernando V. Monteiro  */
+/*==========================================================================*/
+
+#pragma once
+
+#include <fstream>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "Constants.h"
+
+/* Estimates fuel consumption and CO2 emissions of the light duty vehicles
+in the simulation. Samples (velocity and acceleration) are collected during
+a simulation step and processed together once the simulation time
+advances. The polynomial of the fuel rate runs over contiguous arrays of
+samples without branches or comparisons, so the compiler can vectorize it,
+and the exponential is taken in a separate loop, which is only vectorized
+if the compiler has a vector math library.
+
+VT-Micro model: ln(F) = sum_{i,j=0..3} K_ij * v^i * a^j, where v is in
+km/h, a in km/h/s and F in L/s. There is one coefficient matrix for
+positive and one for negative accelerations [Ahn et al., 2002].
+The coefficients are the ones of the composite light duty vehicle. Trucks
+and buses are not estimated, since no heavy duty calibration is available
+here, and they are not in the results files. */
+class EmissionsEstimator
+{
+public:
+	EmissionsEstimator() = default;
+	~EmissionsEstimator();
+
+	/* Stores the sample to be processed in the next batch */
+	void add_sample(long vehicle_id, long link, VehicleCategory category,
+		double velocity, double acceleration);
+	/* Computes fuel rates of all stored samples and accumulates the
+	totals per vehicle and per link. */
+	void process_samples(double time_step);
+	/* The vehicle's totals are written to file after the next batch is
+	processed. */
+	void remove_vehicle(long vehicle_id);
+	/* Processes any remaining samples and writes all totals to file */
+	void write_results();
+	/* Written in every row, since the files keep the results of all runs */
+	void set_run_id(const std::string& run_id) { this->run_id = run_id; };
+
+private:
+	struct VtMicroCoefficients {
+		double positive[4][4];
+		double negative[4][4];
+		double co2_per_liter; // [kg/L]
+	};
+	struct SampleBatch {
+		std::vector<long> vehicle_id;
+		std::vector<long> link;
+		std::vector<double> velocity; // [km/h]
+		std::vector<double> acceleration; // [km/h/s]
+		/* 1 if the acceleration is not negative, 0 otherwise */
+		std::vector<double> positive_weight;
+		std::vector<double> fuel_rate; // [L/s]
+		void clear();
+	};
+	struct Totals {
+		VehicleCategory category{ VehicleCategory::undefined };
+		double distance{ 0.0 }; // [m]
+		double fuel{ 0.0 }; // [L]
+		double co2{ 0.0 }; // [kg]
+	};
+
+	enum VehicleClass {
+		light_duty,
+		n_vehicle_classes
+	};
+
+	/* Returns false for the categories the model does not cover */
+	static bool category_to_class(VehicleCategory category,
+		VehicleClass& vehicle_class);
+	static void compute_fuel_rates(const VtMicroCoefficients& coefficients,
+		const double* velocity, const double* acceleration,
+		const double* positive_weight, double* fuel_rate,
+		size_t n_samples);
+	void accumulate(VehicleClass vehicle_class, double time_step);
+	void write_vehicle_totals(long vehicle_id, const Totals& totals);
+
+	SampleBatch batches[n_vehicle_classes];
+	std::unordered_map<long, Totals> totals_per_vehicle;
+	std::unordered_map<long, Totals> totals_per_link;
+	std::unordered_set<long> removed_vehicles;
+	double last_time_step{ 0.1 }; // [s]
+
+	std::string run_id;
+	std::ofstream vehicle_file;
+	const char* vehicle_file_name{ "emissions_per_vehicle.csv" };
+	const char* link_file_name{ "emissions_per_link.csv" };
+
+	static const VtMicroCoefficients coefficients[n_vehicle_classes];
+};
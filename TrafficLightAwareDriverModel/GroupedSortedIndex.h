@@ -0,0 +1,185 @@
+/*==========================================================================*/
+/*  GroupedSortedIndex.h													*/
+/*  Vehicles grouped by key and sorted within each group, updated			*/
+/*  incrementally every step												*/
+/*                                                                          */
+/*  Version of 2022-06	                              Fernando V. Monteiro  */
+/*==========================================================================*/
+
+#pragma once
+
+#include <algorithm>
+#include <unordered_map>
+#include <vector>
+
+/* Common part of the per-step vehicle indices (LaneVehicleIndex,
+ApproachQueueIndex). Each vehicle is in at most one group, and the entries
+of a group are kept sorted by IsBefore. Entry must have a member long id;
+id zero is reserved.
+
+Vehicles record their entries with update while VISSIM sends their data.
+The updates take effect in apply_updates, called once per step, so that
+between calls the groups are a consistent snapshot. Entries are updated in
+place, and only vehicles that changed groups are moved. Groups are nearly
+sorted from one step to the next, so they are sorted by insertion, in time
+proportional to their size. Not thread safe. */
+template <typename GroupKey, typename Entry, typename IsBefore>
+class GroupedSortedIndex
+{
+public:
+	struct Location {
+		GroupKey group_key{};
+		size_t index{ 0 };
+	};
+
+	/* Records the entry of the vehicle in the current step */
+	void update(GroupKey group_key, const Entry& entry)
+	{
+		updates.push_back(Update{ group_key, entry });
+	};
+	/* The vehicle left its group */
+	void remove(long id) { removed_ids.push_back(id); };
+	/* Applies the updates and removals recorded since the last call.
+	Calls on_group_changed(group_key, entries) for each group that changed,
+	once it is sorted. */
+	template <typename Function>
+	void apply_updates(Function on_group_changed);
+	/* Discards all vehicles, keeping the memory of the groups */
+	void clear();
+
+	/* Returns nullptr if the vehicle is not in any group */
+	const Location* find_location(long id) const
+	{
+		typename std::unordered_map<long, Location>::const_iterator
+			location = locations.find(id);
+		return location == locations.end() ? nullptr : &location->second;
+	};
+	/* Returns nullptr if the group was never used */
+	const std::vector<Entry>* find_group(GroupKey group_key) const
+	{
+		typename std::unordered_map<GroupKey, Group>::const_iterator
+			group = groups.find(group_key);
+		return group == groups.end() ? nullptr : &group->second.entries;
+	};
+	size_t size() const { return locations.size(); };
+
+private:
+	struct Group {
+		std::vector<Entry> entries;
+		bool has_updates{ false };
+	};
+	struct Update {
+		GroupKey group_key{};
+		Entry entry;
+	};
+
+	/* Marks the entry for removal (id zero) instead of erasing it, so that
+	the other locations stay valid until the group is rebuilt */
+	void remove_entry(const Location& location)
+	{
+		Group& group = groups[location.group_key];
+		group.entries[location.index].id = 0;
+		mark_as_updated(location.group_key, group);
+	};
+	void mark_as_updated(GroupKey group_key, Group& group)
+	{
+		if (group.has_updates) return;
+		group.has_updates = true;
+		updated_groups.push_back(group_key);
+	};
+	void rebuild_group(GroupKey group_key, Group& group);
+
+	std::unordered_map<GroupKey, Group> groups;
+	std::unordered_map<long, Location> locations;
+	/* Pending until the next call to apply_updates */
+	std::vector<Update> updates;
+	std::vector<long> removed_ids;
+	std::vector<GroupKey> updated_groups;
+};
+
+template <typename GroupKey, typename Entry, typename IsBefore>
+template <typename Function>
+void GroupedSortedIndex<GroupKey, Entry, IsBefore>::apply_updates(
+	Function on_group_changed)
+{
+	for (const Update& update : updates)
+	{
+		typename std::unordered_map<long, Location>::iterator location =
+			locations.find(update.entry.id);
+		if (location != locations.end()
+			&& location->second.group_key == update.group_key)
+		{
+			Group& group = groups[update.group_key];
+			group.entries[location->second.index] = update.entry;
+			mark_as_updated(update.group_key, group);
+			continue;
+		}
+		if (location != locations.end()) remove_entry(location->second);
+		Group& group = groups[update.group_key];
+		group.entries.push_back(update.entry);
+		locations[update.entry.id] = Location{ update.group_key,
+			group.entries.size() - 1 };
+		mark_as_updated(update.group_key, group);
+	}
+	for (long id : removed_ids)
+	{
+		typename std::unordered_map<long, Location>::iterator location =
+			locations.find(id);
+		if (location == locations.end()) continue;
+		remove_entry(location->second);
+		locations.erase(location);
+	}
+	for (GroupKey group_key : updated_groups)
+	{
+		Group& group = groups[group_key];
+		rebuild_group(group_key, group);
+		on_group_changed(group_key, group.entries);
+	}
+
+	updates.clear();
+	removed_ids.clear();
+	updated_groups.clear();
+}
+
+template <typename GroupKey, typename Entry, typename IsBefore>
+void GroupedSortedIndex<GroupKey, Entry, IsBefore>::clear()
+{
+	for (std::pair<const GroupKey, Group>& pair : groups)
+	{
+		pair.second.entries.clear();
+		pair.second.has_updates = false;
+	}
+	locations.clear();
+	updates.clear();
+	removed_ids.clear();
+	updated_groups.clear();
+}
+
+template <typename GroupKey, typename Entry, typename IsBefore>
+void GroupedSortedIndex<GroupKey, Entry, IsBefore>::rebuild_group(
+	GroupKey group_key, Group& group)
+{
+	std::vector<Entry>& entries = group.entries;
+	entries.erase(std::remove_if(entries.begin(), entries.end(),
+		[](const Entry& entry) { return entry.id == 0; }), entries.end());
+
+	IsBefore is_before;
+	for (size_t i = 1; i < entries.size(); i++)
+	{
+		if (!is_before(entries[i], entries[i - 1])) continue;
+		Entry entry = entries[i];
+		size_t j = i;
+		while (j > 0 && is_before(entry, entries[j - 1]))
+		{
+			entries[j] = entries[j - 1];
+			j--;
+		}
+		entries[j] = entry;
+	}
+
+	for (size_t i = 0; i < entries.size(); i++)
+	{
+		locations[entries[i].id] = Location{ group_key, i };
+	}
+	group.has_updates = false;
+}
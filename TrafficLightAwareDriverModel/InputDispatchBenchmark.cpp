@@ -0,0 +1,327 @@
+#include <chrono>
+#include <fstream>
+#include <iostream>
+
+#include "DriverModel.h"
+#include "EgoVehicleFactory.h"
+#include "InputDispatchBenchmark.h"
+#include "VehicleInput.h"
+
+bool InputDispatchBenchmark::run_all(const std::string& results_file_name)
+{
+	std::ofstream results_file(results_file_name);
+	if (!results_file.is_open())
+	{
+		std::clog << "Unable to open the benchmark results file "
+			<< results_file_name << std::endl;
+		return false;
+	}
+	results_file << "vehicles, nearby vehicles, steps, inputs per vehicle, "
+		<< "ns per vehicle (table), ns per vehicle (lookup per input), "
+		<< "ns per input (table), ns per input (lookup per input), "
+		<< "gain [%]"
+		<< std::endl;
+
+	for (long n_vehicles : { 300, 3000 })
+	{
+		for (int n_nearby_vehicles : { 0, 4, 12 })
+		{
+			Result result = run(n_vehicles, n_nearby_vehicles);
+			double gain = result.ns_per_vehicle_lookup > 0 ?
+				100.0 * (1.0 - result.ns_per_vehicle_table
+					/ result.ns_per_vehicle_lookup) : 0.0;
+			results_file << result.n_vehicles
+				<< ", " << result.n_nearby_vehicles
+				<< ", " << result.n_steps
+				<< ", " << result.inputs_per_vehicle
+				<< ", " << result.ns_per_vehicle_table
+				<< ", " << result.ns_per_vehicle_lookup
+				<< ", " << result.ns_per_input_table
+				<< ", " << result.ns_per_input_lookup
+				<< ", " << gain << std::endl;
+			std::clog << "Input dispatch benchmark: "
+				<< result.n_vehicles << " veh., "
+				<< result.n_nearby_vehicles << " nearby veh. -> "
+				<< result.ns_per_vehicle_table << " ns/veh. (table), "
+				<< result.ns_per_vehicle_lookup
+				<< " ns/veh. (lookup per input)" << std::endl;
+		}
+	}
+	return true;
+}
+
+InputDispatchBenchmark::Result InputDispatchBenchmark::run(long n_vehicles,
+	int n_nearby_vehicles)
+{
+	Fleet fleet;
+	for (long id = 1; id <= n_vehicles; id++)
+	{
+		fleet[id] = EgoVehicleFactory::create_ego_vehicle(id,
+			static_cast<int>(VehicleType::traffic_light_acc_car), 15.0,
+			time_step, 0.0, false);
+	}
+	std::vector<Input> inputs = create_step_inputs(n_vehicles,
+		n_nearby_vehicles);
+
+	std::chrono::steady_clock::duration table_time{ 0 };
+	std::chrono::steady_clock::duration lookup_time{ 0 };
+	for (long i = 0; i < n_warm_up_steps + n_measured_steps; i++)
+	{
+		bool is_table_first = i % 2 == 0;
+		std::chrono::steady_clock::time_point start =
+			std::chrono::steady_clock::now();
+		if (is_table_first) apply_with_table(fleet, inputs);
+		else apply_with_lookup(fleet, inputs);
+		std::chrono::steady_clock::time_point middle =
+			std::chrono::steady_clock::now();
+		if (is_table_first) apply_with_lookup(fleet, inputs);
+		else apply_with_table(fleet, inputs);
+		std::chrono::steady_clock::time_point end =
+			std::chrono::steady_clock::now();
+		if (i >= n_warm_up_steps)
+		{
+			table_time += is_table_first ? middle - start : end - middle;
+			lookup_time += is_table_first ? end - middle : middle - start;
+		}
+	}
+
+	double n_vehicle_steps = double(n_vehicles) * n_measured_steps;
+	double n_inputs = double(inputs.size()) * n_measured_steps;
+	double table_ns = static_cast<double>(std::chrono::duration_cast<
+		std::chrono::nanoseconds>(table_time).count());
+	double lookup_ns = static_cast<double>(std::chrono::duration_cast<
+		std::chrono::nanoseconds>(lookup_time).count());
+	Result result;
+	result.n_vehicles = n_vehicles;
+	result.n_nearby_vehicles = n_nearby_vehicles;
+	result.n_steps = n_measured_steps;
+	result.inputs_per_vehicle = double(inputs.size()) / n_vehicles;
+	result.ns_per_vehicle_table = table_ns / n_vehicle_steps;
+	result.ns_per_vehicle_lookup = lookup_ns / n_vehicle_steps;
+	result.ns_per_input_table = table_ns / n_inputs;
+	result.ns_per_input_lookup = lookup_ns / n_inputs;
+	return result;
+}
+
+std::vector<InputDispatchBenchmark::Input>
+InputDispatchBenchmark::create_step_inputs(long n_vehicles,
+	int n_nearby_vehicles)
+{
+	std::vector<Input> inputs;
+	for (long id = 1; id <= n_vehicles; id++)
+	{
+		double velocity = 10.0 + (id % 10);
+		inputs.push_back({ DRIVER_DATA_VEH_ID, 0, 0, id, 0.0 });
+		inputs.push_back({ DRIVER_DATA_VEH_LANE, 0, 0, 1, 0.0 });
+		inputs.push_back({ DRIVER_DATA_VEH_ODOMETER, 0, 0, 0, 100.0 * id });
+		inputs.push_back({ DRIVER_DATA_VEH_LANE_ANGLE, 0, 0, 0, 0.0 });
+		inputs.push_back({ DRIVER_DATA_VEH_LATERAL_POSITION, 0, 0, 0, 0.0 });
+		inputs.push_back({ DRIVER_DATA_VEH_VELOCITY, 0, 0, 0, velocity });
+		inputs.push_back({ DRIVER_DATA_VEH_ACCELERATION, 0, 0, 0, 0.0 });
+		inputs.push_back({ DRIVER_DATA_VEH_LENGTH, 0, 0, 0, 4.5 });
+		inputs.push_back({ DRIVER_DATA_VEH_WIDTH, 0, 0, 0, 1.8 });
+		inputs.push_back({ DRIVER_DATA_VEH_WEIGHT, 0, 0, 0, 1500.0 });
+		inputs.push_back({ DRIVER_DATA_VEH_MAX_ACCELERATION, 0, 0, 0, 3.5 });
+		inputs.push_back({ DRIVER_DATA_VEH_TURNING_INDICATOR, 0, 0, 0, 0.0 });
+		inputs.push_back({ DRIVER_DATA_VEH_CATEGORY, 0, 0, 1, 0.0 });
+		inputs.push_back({ DRIVER_DATA_VEH_PREFERRED_REL_LANE, 0, 0, 0, 0.0 });
+		inputs.push_back({ DRIVER_DATA_VEH_USE_PREFERRED_LANE, 0, 0, 0, 0.0 });
+		inputs.push_back({ DRIVER_DATA_VEH_X_COORDINATE, 0, 0, 0, 10.0 * id });
+		inputs.push_back({ DRIVER_DATA_VEH_Y_COORDINATE, 0, 0, 0, 0.0 });
+		inputs.push_back({ DRIVER_DATA_VEH_CURRENT_LINK, 0, 0, 1, 0.0 });
+		inputs.push_back({ DRIVER_DATA_VEH_ACTIVE_LANE_CHANGE, 0, 0, 0, 0.0 });
+		for (int k = 0; k < n_nearby_vehicles; k++)
+		{
+			long relative_lane = k % 3 - 1;
+			long relative_position = k % 2 == 0 ? 1 + k / 2 : -1 - k / 2;
+			inputs.push_back({ DRIVER_DATA_NVEH_ID, relative_lane,
+				relative_position, n_vehicles + id * 100 + k, 0.0 });
+			inputs.push_back({ DRIVER_DATA_NVEH_LATERAL_POSITION,
+				relative_lane, relative_position, 0, 0.0 });
+			inputs.push_back({ DRIVER_DATA_NVEH_DISTANCE, relative_lane,
+				relative_position, 0, 20.0 * relative_position });
+			inputs.push_back({ DRIVER_DATA_NVEH_REL_VELOCITY, relative_lane,
+				relative_position, 0, 0.5 });
+			inputs.push_back({ DRIVER_DATA_NVEH_ACCELERATION, relative_lane,
+				relative_position, 0, 0.0 });
+			inputs.push_back({ DRIVER_DATA_NVEH_LENGTH, relative_lane,
+				relative_position, 0, 4.5 });
+			inputs.push_back({ DRIVER_DATA_NVEH_WIDTH, relative_lane,
+				relative_position, 0, 1.8 });
+			inputs.push_back({ DRIVER_DATA_NVEH_CATEGORY, relative_lane,
+				relative_position, 1, 0.0 });
+			inputs.push_back({ DRIVER_DATA_NVEH_LANE_CHANGE, relative_lane,
+				relative_position, 0, 0.0 });
+			inputs.push_back({ DRIVER_DATA_NVEH_TYPE, relative_lane,
+				relative_position,
+				static_cast<long>(VehicleType::human_driven_car), 0.0 });
+		}
+		inputs.push_back({ DRIVER_DATA_LANE_END_DISTANCE, 1, 0, 0, -1.0 });
+		inputs.push_back({ DRIVER_DATA_SIGNAL_DISTANCE, 0, 0, 0, 0.0 });
+		inputs.push_back({ DRIVER_DATA_DESIRED_ACCELERATION, 0, 0, 0, 0.5 });
+		inputs.push_back({ DRIVER_DATA_DESIRED_LANE_ANGLE, 0, 0, 0, 0.0 });
+		inputs.push_back({ DRIVER_DATA_REL_TARGET_LANE, 0, 0, 0, 0.0 });
+	}
+	return inputs;
+}
+
+void InputDispatchBenchmark::apply_with_table(Fleet& fleet,
+	const std::vector<Input>& inputs)
+{
+	VehicleInput vehicle_input;
+	for (const Input& input : inputs)
+	{
+		if (input.type == DRIVER_DATA_VEH_ID)
+		{
+			/* As in DriverModelSetValue */
+			auto vehicle_it = fleet.find(input.long_value);
+			EgoVehicle* ego_vehicle = vehicle_it != fleet.end() ?
+				vehicle_it->second.get() : nullptr;
+			vehicle_input.set_ego_vehicle(ego_vehicle);
+			if (ego_vehicle != nullptr) ego_vehicle->clear_nearby_vehicles();
+			continue;
+		}
+		vehicle_input.set_value(input.type, input.index1, input.index2,
+			input.long_value, input.double_value);
+	}
+}
+
+void InputDispatchBenchmark::apply_with_lookup(Fleet& fleet,
+	const std::vector<Input>& inputs)
+{
+	long vehicle_id = 0;
+	for (const Input& input : inputs)
+	{
+		if (input.type == DRIVER_DATA_VEH_ID)
+		{
+			vehicle_id = input.long_value;
+			if (fleet.find(vehicle_id) != fleet.end())
+			{
+				fleet[vehicle_id]->clear_nearby_vehicles();
+			}
+			continue;
+		}
+		set_value_with_lookup(fleet, vehicle_id, input);
+	}
+}
+
+int InputDispatchBenchmark::set_value_with_lookup(Fleet& fleet,
+	long vehicle_id, const Input& input)
+{
+	/* DriverModelSetValue answered these without looking the vehicle up */
+	switch (input.type)
+	{
+	case DRIVER_DATA_VEH_LANE_ANGLE:
+	case DRIVER_DATA_VEH_WEIGHT:
+	case DRIVER_DATA_VEH_MAX_ACCELERATION:
+		return 1;
+	default:
+		break;
+	}
+
+	EgoVehicle& ego_vehicle = *fleet[vehicle_id];
+	long long_value = input.long_value;
+	double double_value = input.double_value;
+	switch (input.type)
+	{
+	case DRIVER_DATA_VEH_LANE:
+		ego_vehicle.set_lane(long_value);
+		return 1;
+	case DRIVER_DATA_VEH_ODOMETER:
+		ego_vehicle.set_odometer(double_value);
+		return 1;
+	case DRIVER_DATA_VEH_LATERAL_POSITION:
+		ego_vehicle.set_lateral_position(double_value);
+		return 1;
+	case DRIVER_DATA_VEH_X_COORDINATE:
+		ego_vehicle.set_front_x(double_value);
+		return 1;
+	case DRIVER_DATA_VEH_Y_COORDINATE:
+		ego_vehicle.set_front_y(double_value);
+		return 1;
+	case DRIVER_DATA_VEH_VELOCITY:
+		ego_vehicle.set_velocity(double_value);
+		return 1;
+	case DRIVER_DATA_VEH_ACCELERATION:
+		ego_vehicle.set_acceleration(double_value);
+		return 1;
+	case DRIVER_DATA_VEH_LENGTH:
+		ego_vehicle.set_length(double_value);
+		return 1;
+	case DRIVER_DATA_VEH_WIDTH:
+		ego_vehicle.set_width(double_value);
+		return 1;
+	case DRIVER_DATA_VEH_TURNING_INDICATOR:
+		ego_vehicle.set_turning_indicator(long_value);
+		return 1;
+	case DRIVER_DATA_VEH_CATEGORY:
+		ego_vehicle.set_category(long_value);
+		return 1;
+	case DRIVER_DATA_VEH_PREFERRED_REL_LANE:
+		ego_vehicle.set_preferred_relative_lane(long_value);
+		return 1;
+	case DRIVER_DATA_VEH_USE_PREFERRED_LANE:
+		ego_vehicle.set_vissim_use_preferred_lane(long_value);
+		return 1;
+	case DRIVER_DATA_VEH_CURRENT_LINK:
+		ego_vehicle.set_link(long_value);
+		return 0;
+	case DRIVER_DATA_VEH_ACTIVE_LANE_CHANGE:
+		ego_vehicle.set_active_lane_change_direction(long_value);
+		return 1;
+	case DRIVER_DATA_NVEH_ID:
+		if (long_value > 0)
+		{
+			ego_vehicle.emplace_nearby_vehicle(long_value, input.index1,
+				input.index2);
+		}
+		return 1;
+	case DRIVER_DATA_NVEH_LATERAL_POSITION:
+		ego_vehicle.peek_nearby_vehicles()->set_lateral_position(
+			double_value);
+		return 1;
+	case DRIVER_DATA_NVEH_DISTANCE:
+		ego_vehicle.peek_nearby_vehicles()->set_distance(double_value);
+		return 1;
+	case DRIVER_DATA_NVEH_REL_VELOCITY:
+		ego_vehicle.peek_nearby_vehicles()->set_relative_velocity(
+			double_value);
+		return 1;
+	case DRIVER_DATA_NVEH_ACCELERATION:
+		ego_vehicle.peek_nearby_vehicles()->set_acceleration(double_value);
+		return 1;
+	case DRIVER_DATA_NVEH_LENGTH:
+		ego_vehicle.peek_nearby_vehicles()->set_length(double_value);
+		return 1;
+	case DRIVER_DATA_NVEH_WIDTH:
+		ego_vehicle.peek_nearby_vehicles()->set_width(double_value);
+		return 1;
+	case DRIVER_DATA_NVEH_CATEGORY:
+		ego_vehicle.peek_nearby_vehicles()->set_category(long_value);
+		return 1;
+	case DRIVER_DATA_NVEH_LANE_CHANGE:
+		ego_vehicle.peek_nearby_vehicles()->set_lane_change_direction(
+			long_value);
+		return 1;
+	case DRIVER_DATA_NVEH_TYPE:
+		ego_vehicle.set_nearby_vehicle_type(long_value);
+		return 1;
+	case DRIVER_DATA_LANE_END_DISTANCE:
+		ego_vehicle.set_lane_end_distance(double_value, input.index1);
+		return 1;
+	case DRIVER_DATA_SIGNAL_DISTANCE:
+		ego_vehicle.read_traffic_light(input.index1, double_value);
+		return 1;
+	case DRIVER_DATA_DESIRED_ACCELERATION:
+		ego_vehicle.set_vissim_acceleration(double_value);
+		return 1;
+	case DRIVER_DATA_DESIRED_LANE_ANGLE:
+		ego_vehicle.set_desired_lane_angle(double_value);
+		return 1;
+	case DRIVER_DATA_REL_TARGET_LANE:
+		ego_vehicle.set_relative_target_lane(long_value);
+		return 1;
+	default:
+		return 0;
+	}
+}
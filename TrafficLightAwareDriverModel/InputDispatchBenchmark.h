@@ -0,0 +1,76 @@
+/*==========================================================================*/
+/*  InputDispatchBenchmark.h												*/
+/*  Measures the time to apply the vehicle inputs sent by VISSIM			*/
+/*                                                                          */
+/*  Version of 2022-06	                              Fernando V. Monteiro  */
+/*==========================================================================*/
+
+#pragma once
+
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "EgoVehicle.h"
+
+/* Applies the same sequence of vehicle and nearby vehicle inputs, in the
+order VISSIM sends them, in two ways:
+1. Through VehicleInput, as the DLL does: the ego vehicle is looked up once
+per vehicle and the nearby vehicle set once per nearby vehicle, and each
+input goes through the dispatch table.
+2. As the DLL did before the dispatch table: every input looks the ego
+vehicle up by id and goes through a switch, and nearby vehicle inputs go to
+the last nearby vehicle through EgoVehicle::peek_nearby_vehicles.
+Both ways call the same setters, including the ones added after the table
+(odometer and coordinates), and only the inputs are timed, not
+DriverModelSetValue's own switch over the DLL level data, so the difference
+is the one of the two dispatch paths.
+Both ways run on the same fleet, and each round alternates which one runs
+first so that both see the same machine load. */
+class InputDispatchBenchmark
+{
+public:
+	struct Result {
+		long n_vehicles{ 0 };
+		int n_nearby_vehicles{ 0 };
+		long n_steps{ 0 };
+		double inputs_per_vehicle{ 0.0 };
+		double ns_per_vehicle_table{ 0.0 };
+		double ns_per_vehicle_lookup{ 0.0 };
+		double ns_per_input_table{ 0.0 };
+		double ns_per_input_lookup{ 0.0 };
+	};
+
+	/* Runs all fleet sizes and numbers of nearby vehicles and writes one
+	line per run to the results file. Returns false if the results file
+	cannot be opened. */
+	bool run_all(const std::string& results_file_name);
+	Result run(long n_vehicles, int n_nearby_vehicles);
+
+private:
+	struct Input {
+		long type{ 0 };
+		long index1{ 0 };
+		long index2{ 0 };
+		long long_value{ 0 };
+		double double_value{ 0.0 };
+	};
+	using Fleet = std::unordered_map<long, std::unique_ptr<EgoVehicle>>;
+
+	const double time_step{ 0.1 }; // [s]
+	const long n_warm_up_steps{ 20 };
+	const long n_measured_steps{ 200 };
+
+	/* Inputs of one time step, starting with DRIVER_DATA_VEH_ID for each
+	vehicle */
+	static std::vector<Input> create_step_inputs(long n_vehicles,
+		int n_nearby_vehicles);
+	static void apply_with_table(Fleet& fleet,
+		const std::vector<Input>& inputs);
+	static void apply_with_lookup(Fleet& fleet,
+		const std::vector<Input>& inputs);
+	/* The dispatch of VehicleInput before the table */
+	static int set_value_with_lookup(Fleet& fleet, long vehicle_id,
+		const Input& input);
+};
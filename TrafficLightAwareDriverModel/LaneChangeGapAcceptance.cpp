@@ -0,0 +1,63 @@
+#include "LaneChangeGapAcceptance.h"
+
+LaneChangeGapAcceptance::LaneChangeGapAcceptance(
+	const Parameters& parameters) : parameters{ parameters } {}
+
+bool LaneChangeGapAcceptance::accepts(const Candidate& candidate) const
+{
+	return check(parameters, candidate.velocity, candidate.time_headway,
+		candidate.standstill_distance, candidate.leader_gap,
+		candidate.leader_velocity, candidate.follower_gap,
+		candidate.follower_velocity, candidate.distance_to_traffic_light,
+		candidate.green_time_left);
+}
+
+size_t LaneChangeGapAcceptance::add_candidate(const Candidate& candidate)
+{
+	velocity.push_back(candidate.velocity);
+	time_headway.push_back(candidate.time_headway);
+	standstill_distance.push_back(candidate.standstill_distance);
+	leader_gap.push_back(candidate.leader_gap);
+	leader_velocity.push_back(candidate.leader_velocity);
+	follower_gap.push_back(candidate.follower_gap);
+	follower_velocity.push_back(candidate.follower_velocity);
+	distance_to_traffic_light.push_back(
+		candidate.distance_to_traffic_light);
+	green_time_left.push_back(candidate.green_time_left);
+	return velocity.size() - 1;
+}
+
+void LaneChangeGapAcceptance::evaluate()
+{
+	size_t n = velocity.size();
+	accepted.resize(n);
+	const double* v = velocity.data();
+	const double* h = time_headway.data();
+	const double* d0 = standstill_distance.data();
+	const double* lg = leader_gap.data();
+	const double* lv = leader_velocity.data();
+	const double* fg = follower_gap.data();
+	const double* fv = follower_velocity.data();
+	const double* d = distance_to_traffic_light.data();
+	const double* g = green_time_left.data();
+	unsigned char* result = accepted.data();
+	for (size_t i = 0; i < n; i++)
+	{
+		result[i] = check(parameters, v[i], h[i], d0[i], lg[i], lv[i],
+			fg[i], fv[i], d[i], g[i]);
+	}
+}
+
+void LaneChangeGapAcceptance::clear()
+{
+	velocity.clear();
+	time_headway.clear();
+	standstill_distance.clear();
+	leader_gap.clear();
+	leader_velocity.clear();
+	follower_gap.clear();
+	follower_velocity.clear();
+	distance_to_traffic_light.clear();
+	green_time_left.clear();
+	accepted.clear();
+}
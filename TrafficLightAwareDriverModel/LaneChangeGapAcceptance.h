@@ -0,0 +1,119 @@
+/*==========================================================================*/
+/*  LaneChangeGapAcceptance.h												*/
+/*  Safe gap acceptance for lane changes, evaluated in batches				*/
+/*                                                                          */
+/*  Version of 2022-06	                              Fernando V. Monteiro  */
+/*==========================================================================*/
+
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+#include "Constants.h"
+
+/* A lane change may start when both gaps on the target lane are safe and
+the vehicle is not in the dilemma zone of its next traffic light.
+
+The safe gaps have the same form as the one of the vehicle following mode
+of LongitudinalControllerWithTrafficLights:
+	h * v_f + d_0 + (v_f^2 - v_l^2) / (2 * b),
+where f is the follower and l the leader of each pair: the ego vehicle
+behind the target lane leader, and the target lane follower behind the ego
+vehicle. A missing vehicle is MAX_DISTANCE away. The time headway h and
+standstill distance d_0 are the ones of the ego vehicle's controller, so
+they come with each candidate.
+
+The dilemma zone is where a driver reaching a yellow light can neither
+stop comfortably nor cross before red: between dilemma_zone_start_time and
+dilemma_zone_end_time from the stop line at the current velocity. It only
+matters if the light may not be green when the vehicle arrives.
+
+Candidates are stored as one array per quantity, and evaluate checks all
+of them in a single loop without branches, which the compiler vectorizes.
+accepts checks one candidate with the same code, so both give the same
+decision. */
+class LaneChangeGapAcceptance
+{
+public:
+	struct Parameters {
+		double comfortable_braking{ COMFORTABLE_BRAKE }; // [m/s^2]
+		double dilemma_zone_start_time{ 2.5 }; // [s]
+		double dilemma_zone_end_time{ 5.5 }; // [s]
+	};
+	/* What a vehicle that intends to change lanes perceives of the target
+	lane and of its next traffic light */
+	struct Candidate {
+		double velocity{ 0.0 }; // [m/s]
+		/* Of the vehicle's longitudinal controller */
+		double time_headway{ 0.0 }; // [s]
+		double standstill_distance{ 0.0 }; // [m]
+		double leader_gap{ MAX_DISTANCE }; // bumper to bumper [m]
+		double leader_velocity{ 0.0 }; // [m/s]
+		double follower_gap{ MAX_DISTANCE }; // bumper to bumper [m]
+		double follower_velocity{ 0.0 }; // [m/s]
+		/* Negative if there is no traffic light ahead [m] */
+		double distance_to_traffic_light{ -1.0 };
+		/* Time the light stays green. Zero if it is not green. [s] */
+		double green_time_left{ 0.0 };
+	};
+
+	LaneChangeGapAcceptance() = default;
+	explicit LaneChangeGapAcceptance(const Parameters& parameters);
+
+	const Parameters& get_parameters() const { return parameters; };
+	bool accepts(const Candidate& candidate) const;
+
+	/* Batch evaluation. Returns the index of the candidate. */
+	size_t add_candidate(const Candidate& candidate);
+	/* Decides all candidates added since the last call to clear */
+	void evaluate();
+	bool is_accepted(size_t index) const { return accepted[index] != 0; };
+	size_t size() const { return velocity.size(); };
+	/* Keeps the memory for the next batch */
+	void clear();
+
+private:
+	/* The one check used by both accepts and evaluate */
+	static bool check(const Parameters& parameters, double velocity,
+		double time_headway, double standstill_distance, double leader_gap,
+		double leader_velocity, double follower_gap,
+		double follower_velocity, double distance_to_traffic_light,
+		double green_time_left)
+	{
+		/* Loop invariant in evaluate */
+		double inverse_two_b = 0.5 / parameters.comfortable_braking;
+		double safe_leader_gap = time_headway * velocity
+			+ standstill_distance
+			+ (velocity * velocity - leader_velocity * leader_velocity)
+			* inverse_two_b;
+		double safe_follower_gap = time_headway * follower_velocity
+			+ standstill_distance
+			+ (follower_velocity * follower_velocity - velocity * velocity)
+			* inverse_two_b;
+		/* Times to the stop line are compared as distances, so that there
+		are neither divisions nor selections, and bitwise operators keep the
+		check free of branches. Stopped vehicles are never in the zone. */
+		bool is_in_dilemma_zone = (distance_to_traffic_light >= 0.0)
+			& (distance_to_traffic_light
+				>= parameters.dilemma_zone_start_time * velocity)
+			& (distance_to_traffic_light
+				<= parameters.dilemma_zone_end_time * velocity)
+			& (green_time_left * velocity < distance_to_traffic_light);
+		return (leader_gap >= safe_leader_gap)
+			& (follower_gap >= safe_follower_gap)
+			& !is_in_dilemma_zone;
+	};
+
+	Parameters parameters;
+	std::vector<double> velocity;
+	std::vector<double> time_headway;
+	std::vector<double> standstill_distance;
+	std::vector<double> leader_gap;
+	std::vector<double> leader_velocity;
+	std::vector<double> follower_gap;
+	std::vector<double> follower_velocity;
+	std::vector<double> distance_to_traffic_light;
+	std::vector<double> green_time_left;
+	std::vector<unsigned char> accepted;
+};
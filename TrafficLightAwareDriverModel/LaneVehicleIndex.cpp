@@ -0,0 +1,135 @@
+#include <algorithm>
+
+#include "LaneVehicleIndex.h"
+
+void LaneVehicleIndex::update(long link, long lane, const Entry& entry)
+{
+	index.update(make_lane_key(link, lane), entry);
+}
+
+void LaneVehicleIndex::update_observed(long link, long lane,
+	const Entry& entry)
+{
+	observed_ids.insert(entry.id);
+	index.update(make_lane_key(link, lane), entry);
+}
+
+void LaneVehicleIndex::remove(long id)
+{
+	index.remove(id);
+}
+
+void LaneVehicleIndex::start_step(double time)
+{
+	if (time == current_time) return;
+	current_time = time;
+	for (long id : previously_observed_ids)
+	{
+		if (observed_ids.find(id) == observed_ids.end()) index.remove(id);
+	}
+	previously_observed_ids.swap(observed_ids);
+	observed_ids.clear();
+	index.apply_updates(
+		[this](LaneKey lane_key, const std::vector<Entry>& entries) {
+			compute_queues(lane_key, entries);
+		});
+}
+
+void LaneVehicleIndex::clear()
+{
+	/* Keeps the memory of the lanes for the next run */
+	index.clear();
+	observed_ids.clear();
+	previously_observed_ids.clear();
+	for (std::pair<const LaneKey, std::vector<QueueAhead>>& pair : queues)
+	{
+		pair.second.clear();
+	}
+	current_time = -1.0;
+}
+
+const LaneVehicleIndex::Entry* LaneVehicleIndex::find(long id) const
+{
+	const Index::Location* location = index.find_location(id);
+	if (location == nullptr) return nullptr;
+	return &(*index.find_group(location->group_key))[location->index];
+}
+
+const LaneVehicleIndex::Entry* LaneVehicleIndex::get_vehicle_ahead(
+	long id, size_t k) const
+{
+	const Index::Location* location = index.find_location(id);
+	if (location == nullptr) return nullptr;
+	const std::vector<Entry>& entries =
+		*index.find_group(location->group_key);
+	if (location->index + k >= entries.size()) return nullptr;
+	return &entries[location->index + k];
+}
+
+const LaneVehicleIndex::Entry* LaneVehicleIndex::get_vehicle_behind(
+	long id, size_t k) const
+{
+	const Index::Location* location = index.find_location(id);
+	if (location == nullptr || k > location->index) return nullptr;
+	return &(*index.find_group(location->group_key))[location->index - k];
+}
+
+LaneVehicleIndex::QueueAhead LaneVehicleIndex::get_queue_ahead(
+	long id) const
+{
+	const Index::Location* location = index.find_location(id);
+	if (location == nullptr) return QueueAhead();
+	return queues.at(location->group_key)[location->index];
+}
+
+size_t LaneVehicleIndex::count_vehicles(long link, long lane, double from,
+	double to) const
+{
+	const std::vector<Entry>* entries =
+		index.find_group(make_lane_key(link, lane));
+	if (entries == nullptr || to < from) return 0;
+	std::vector<Entry>::const_iterator first = std::lower_bound(
+		entries->begin(), entries->end(), from,
+		[](const Entry& entry, double position) {
+			return entry.position < position; });
+	std::vector<Entry>::const_iterator last = std::upper_bound(
+		first, entries->end(), to,
+		[](double position, const Entry& entry) {
+			return position < entry.position; });
+	return static_cast<size_t>(last - first);
+}
+
+LaneVehicleIndex::LaneKey LaneVehicleIndex::make_lane_key(long link,
+	long lane)
+{
+	return (static_cast<LaneKey>(link) << 32)
+		+ static_cast<unsigned int>(lane);
+}
+
+void LaneVehicleIndex::compute_queues(LaneKey lane_key,
+	const std::vector<Entry>& entries)
+{
+	/* From the front of the lane backwards, each queue extends the queue
+	of the vehicle ahead */
+	std::vector<QueueAhead>& lane_queues = queues[lane_key];
+	lane_queues.assign(entries.size(), QueueAhead());
+	for (size_t i = entries.size(); i-- > 1;)
+	{
+		const Entry& leader = entries[i];
+		double leader_rear = leader.position - leader.length;
+		if (leader.velocity >= queued_velocity
+			|| leader_rear - entries[i - 1].position > max_queue_gap)
+		{
+			continue;
+		}
+		const QueueAhead& leader_queue = lane_queues[i];
+		QueueAhead& queue = lane_queues[i - 1];
+		queue.n_vehicles = leader_queue.n_vehicles + 1;
+		queue.length = leader.length;
+		if (leader_queue.n_vehicles > 0)
+		{
+			queue.length += entries[i + 1].position - entries[i + 1].length
+				- leader.position + leader_queue.length;
+		}
+	}
+}
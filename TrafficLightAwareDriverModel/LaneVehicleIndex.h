@@ -0,0 +1,105 @@
+/*==========================================================================*/
+/*  LaneVehicleIndex.h														*/
+/*  Vehicles of each lane sorted by position, for look-ahead queries		*/
+/*                                                                          */
+/*  Version of 2022-06	                              Fernando V. Monteiro  */
+/*==========================================================================*/
+
+#pragma once
+
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "GroupedSortedIndex.h"
+
+/* One array per link and lane with the ego vehicles on it, sorted by
+position, so that queries about several vehicles ahead (the leader's
+leader, the queue ahead) do not depend on the nearby vehicles VISSIM sends
+to each vehicle:
+- find, get_vehicle_ahead, get_vehicle_behind and get_queue_ahead: O(1);
+- count_vehicles: O(log n) on the number of vehicles on the lane.
+
+The position is measured from the start of the link (see
+EgoVehicle::get_position_on_link). Vehicles not driven by this DLL are only
+known as nearby vehicles of ego vehicles: they are placed relative to the
+ego vehicle that sees them, on its link, and stay in the index while some
+ego vehicle sees them.
+
+Vehicles update their entries while VISSIM sends their data. The updates
+become visible at the next call to start_step, so during a step queries see
+all vehicles as they were in the previous step, whatever the order in which
+VISSIM evaluates them. The arrays are maintained incrementally (see
+GroupedSortedIndex). Not thread safe. */
+class LaneVehicleIndex
+{
+public:
+	struct Entry {
+		long id{ 0 };
+		double position{ 0.0 }; // front end [m]
+		double velocity{ 0.0 }; // [m/s]
+		double acceleration{ 0.0 }; // [m/s^2]
+		double length{ 0.0 }; // [m]
+		bool is_connected{ false };
+	};
+	/* Vehicles queued right ahead of a vehicle */
+	struct QueueAhead {
+		long n_vehicles{ 0 };
+		/* From the rear of the first queued vehicle to the front of the
+		last one [m] */
+		double length{ 0.0 };
+	};
+
+	/* Vehicles slower than this are queued ... */
+	static constexpr double queued_velocity{ 5.0 / 3.6 }; // [m/s]
+	/* ... if the gap to the queued vehicle behind them is at most this */
+	static constexpr double max_queue_gap{ 10.0 }; // [m]
+
+	/* Records the state of the vehicle in the current step */
+	void update(long link, long lane, const Entry& entry);
+	/* Same for vehicles not driven by this DLL, seen by an ego vehicle.
+	They are removed at the first step in which no vehicle sees them. */
+	void update_observed(long link, long lane, const Entry& entry);
+	/* The vehicle left the simulation */
+	void remove(long id);
+	/* Must be called when the simulation time changes. Makes the updates
+	of the previous step visible to queries. */
+	void start_step(double time);
+	/* Discards all vehicles (new simulation run) */
+	void clear();
+
+	/* Returns nullptr if the vehicle is not in the index */
+	const Entry* find(long id) const;
+	/* k-th vehicle ahead on the same lane (k = 1 is the leader), or
+	nullptr if there is none */
+	const Entry* get_vehicle_ahead(long id, size_t k) const;
+	/* k-th vehicle behind on the same lane, or nullptr if there is none */
+	const Entry* get_vehicle_behind(long id, size_t k) const;
+	QueueAhead get_queue_ahead(long id) const;
+	/* Vehicles on the lane whose front is in [from, to] */
+	size_t count_vehicles(long link, long lane, double from,
+		double to) const;
+	size_t size() const { return index.size(); };
+
+private:
+	using LaneKey = long long;
+	struct IsBehind {
+		bool operator()(const Entry& a, const Entry& b) const {
+			return a.position < b.position;
+		};
+	};
+	using Index = GroupedSortedIndex<LaneKey, Entry, IsBehind>;
+
+	static LaneKey make_lane_key(long link, long lane);
+	void compute_queues(LaneKey lane_key, const std::vector<Entry>& entries);
+
+	Index index;
+	/* queues[lane_key][i] is the queue ahead of the i-th vehicle of the
+	lane */
+	std::unordered_map<LaneKey, std::vector<QueueAhead>> queues;
+	/* Vehicles not driven by this DLL seen in the current and in the
+	previous step */
+	std::unordered_set<long> observed_ids;
+	std::unordered_set<long> previously_observed_ids;
+	double current_time{ -1.0 };
+};
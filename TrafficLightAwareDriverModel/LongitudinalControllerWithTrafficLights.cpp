@@ -1,15 +1,22 @@
 #include <iostream>
 
 #include "EgoVehicle.h"
+#include "LaneVehicleIndex.h"
 #include "LongitudinalControllerWithTrafficLights.h"
-#include "TrafficLightACCVehicle.h"
 
 LongitudinalControllerWithTrafficLights::
 LongitudinalControllerWithTrafficLights(const EgoVehicle& ego_vehicle,
 	bool verbose): 
+	LongitudinalControllerWithTrafficLights(ego_vehicle, Parameters(),
+		verbose) {}
+
+LongitudinalControllerWithTrafficLights::
+LongitudinalControllerWithTrafficLights(const EgoVehicle& ego_vehicle,
+	const Parameters& parameters, bool verbose):
 	verbose {verbose}, 
 	max_accel {ego_vehicle.get_comfortable_acceleration()},
-	comfortable_braking {ego_vehicle.get_comfortable_brake()}
+	comfortable_braking {ego_vehicle.get_comfortable_brake()},
+	parameters {parameters}
 {
 	if (verbose)
 	{
@@ -21,31 +28,24 @@ bool LongitudinalControllerWithTrafficLights
 ::compute_vehicle_following_input(const EgoVehicle& ego_vehicle,
 	std::unordered_map<State, double>& possible_accelerations)
 {
-	if (!ego_vehicle.has_leader()) return false;
+	const PerceptionFrame& frame = ego_vehicle.get_perception_frame();
+	if (!frame.has_leader) return false;
 	
-	std::shared_ptr<NearbyVehicle> leader = ego_vehicle.get_leader();
-	double gap = ego_vehicle.compute_gap(leader);
-	double ego_vel = ego_vehicle.get_velocity();
-	double rel_vel = leader->get_relative_velocity();
-	double leader_vel = leader->compute_velocity(ego_vel);
-	double safe_gap = time_headway * ego_vel + standstill_distance
-		+ (std::pow(ego_vel, 2) - std::pow(leader_vel, 2)) / 2 / comfortable_braking;
-	gap_error = gap - safe_gap;
-
-	if (ego_vehicle.get_is_connected() && leader->is_connected())
+	gap_error = compute_gap_error(frame);
+
+	if (frame.is_leader_connected)
 	{
-		double leader_accel = leader->get_acceleration();
-		double connected_extra_term = leader_accel / comfortable_braking
-			* leader_vel;
 		possible_accelerations[State::vehicle_following] =
-			(-rel_vel + veh_foll_gain * gap_error + connected_extra_term)
-			* comfortable_braking / (comfortable_braking + ego_vel);
+			connected_vehicle_following_formula(frame, gap_error,
+				compute_connected_extra_term(frame, comfortable_braking),
+				parameters.veh_foll_gain, comfortable_braking);
 	}
 	else
 	{
 		possible_accelerations[State::vehicle_following] =
-			(-rel_vel + veh_foll_gain * gap_error)
-			/ (time_headway + ego_vel / comfortable_braking);
+			vehicle_following_formula(frame, gap_error,
+				parameters.time_headway, parameters.veh_foll_gain,
+				comfortable_braking);
 	}
 	return true;
 }
@@ -54,35 +54,81 @@ bool LongitudinalControllerWithTrafficLights
 ::compute_velocity_control_input(const EgoVehicle& ego_vehicle,
 	std::unordered_map<State, double>& possible_accelerations)
 {
-	double desired_vel = ego_vehicle.get_desired_velocity();
-
-	double ego_vel = ego_vehicle.get_velocity();
-	double vel_error = desired_vel - ego_vel;
-	possible_accelerations[State::velocity_control] = 
-		vel_control_gain * (vel_error);
+	const PerceptionFrame& frame = ego_vehicle.get_perception_frame();
+	possible_accelerations[State::velocity_control] =
+		velocity_control_formula(frame, parameters.vel_control_gain);
 	return true;
 }
 
 bool LongitudinalControllerWithTrafficLights
-::compute_traffic_light_input(const TrafficLightACCVehicle& ego_vehicle,
-	const std::unordered_map<int, TrafficLight>& traffic_lights,
+::compute_traffic_light_input(const EgoVehicle& ego_vehicle,
 	std::unordered_map<State, double>& possible_accelerations)
 {
-	if (!ego_vehicle.has_next_traffic_light()) return false;
+	const PerceptionFrame& frame = ego_vehicle.get_perception_frame();
+	if (!frame.has_traffic_light) return false;
 
-	double ego_vel = ego_vehicle.get_velocity();
-	compute_traffic_light_input_parameters(ego_vehicle, traffic_lights);
+	double ego_vel = frame.velocity;
+	compute_traffic_light_input_parameters(frame);
 
-	if (verbose) std::clog << "beta=" << beta
+	if (verbose) std::clog << "beta=" << parameters.beta
 		<< ", dht=" << dht << ", Vf=" << ego_vel << ", h3=" << h3
 		<< std::endl;
 
-	possible_accelerations[State::traffic_light] = 
-		comfortable_braking / (beta * comfortable_braking + ego_vel)
-		* (dht - ego_vel + h3);
+	possible_accelerations[State::traffic_light] = traffic_light_formula(
+		ego_vel, h3, dht, parameters.beta, comfortable_braking);
 	return true;
 }
 
+bool LongitudinalControllerWithTrafficLights::can_vehicle_following_bind(
+	const PerceptionFrame& frame, double upper_bound) const
+{
+	if (!frame.has_leader) return false;
+	if (parameters.veh_foll_gain <= 0) return true;
+
+	/* The input grows with the gap error e:
+	a = (-rel_vel + K e) / (h + v / b), or
+	a = (-rel_vel + K e + a_l v_l / b) b / (b + v) if connected.
+	We find the gap error at which a = upper_bound. */
+	double ego_vel = frame.velocity;
+	double rel_vel = frame.relative_velocity;
+	double gap_error_bound;
+	if (frame.is_leader_connected)
+	{
+		double connected_extra_term = compute_connected_extra_term(frame,
+			comfortable_braking);
+		gap_error_bound = (upper_bound * (comfortable_braking + ego_vel)
+			/ comfortable_braking + rel_vel - connected_extra_term)
+			/ parameters.veh_foll_gain;
+	}
+	else
+	{
+		gap_error_bound = (upper_bound * (parameters.time_headway
+			+ ego_vel / comfortable_braking) + rel_vel)
+			/ parameters.veh_foll_gain;
+	}
+	return compute_gap_error(frame) <= gap_error_bound + relevance_margin;
+}
+
+bool LongitudinalControllerWithTrafficLights::can_traffic_light_bind(
+	const PerceptionFrame& frame, double upper_bound)
+{
+	if (!frame.has_traffic_light) return false;
+
+	/* The input is a = b / (beta b + v) (dht - v + ht + hx), where
+	hx = d - beta v - d0 - v^2 / 2b grows with the distance d to the traffic
+	light. We find the distance at which a = upper_bound. */
+	double ego_vel = frame.velocity;
+	double ht = transient_safe_set_formula(frame, parameters.beta,
+		comfortable_braking, dht);
+	double hx_bound = upper_bound * (parameters.beta * comfortable_braking
+		+ ego_vel) / comfortable_braking - dht + ego_vel - ht;
+	double relevance_distance = hx_bound + parameters.beta * ego_vel
+		+ parameters.standstill_distance
+		+ compute_braking_distance(ego_vel, comfortable_braking);
+	return compute_stop_distance(frame)
+		<= relevance_distance + relevance_margin;
+}
+
 color_t LongitudinalControllerWithTrafficLights::get_state_color() const
 {
 	if (state_to_color.find(active_mode) == state_to_color.end())
@@ -97,6 +143,15 @@ double LongitudinalControllerWithTrafficLights::get_nominal_input(
 	return true;
 }
 
+double LongitudinalControllerWithTrafficLights::compute_gap_error(
+	const PerceptionFrame& frame) const
+{
+	return gap_error_formula(frame.gap, frame.velocity,
+		compute_braking_distance_difference(frame.velocity,
+			frame.leader_velocity, comfortable_braking),
+		parameters.time_headway, parameters.standstill_distance);
+}
+
 double LongitudinalControllerWithTrafficLights::choose_minimum_acceleration(
 	std::unordered_map<State, double>& possible_accelerations)
 {
@@ -124,27 +179,39 @@ double LongitudinalControllerWithTrafficLights::choose_acceleration(
 	const EgoVehicle& ego_vehicle,
 	std::unordered_map<State, double>& possible_accelerations)
 {
-	double min_from_inputs =
+	nominal_acceleration =
 		choose_minimum_acceleration(possible_accelerations);
-	if (!ego_vehicle.has_leader())
+	nominal_mode = active_mode;
+	return apply_safety_override(ego_vehicle);
+}
+
+double LongitudinalControllerWithTrafficLights::reuse_nominal_acceleration(
+	const EgoVehicle& ego_vehicle)
+{
+	active_mode = nominal_mode;
+	return apply_safety_override(ego_vehicle);
+}
+
+double LongitudinalControllerWithTrafficLights::apply_safety_override(
+	const EgoVehicle& ego_vehicle)
+{
+	const PerceptionFrame& frame = ego_vehicle.get_perception_frame();
+	if (!frame.has_leader)
 	{
-		return min_from_inputs;
+		return nominal_acceleration;
 	}
 
-	double gap = ego_vehicle.compute_gap(ego_vehicle.get_leader());
-	double ego_vel = ego_vehicle.get_velocity();
-	double leader_vel = ego_vehicle.get_leader()->compute_velocity(ego_vel);
-	//double gap_error = gap - time_headway * ego_vel - standstill_distance;
-		
-	double margin = 0.1; // 0 for connected
-	if (gap_error >= -margin)
+	/* Computed here because the vehicle following mode may not have been
+	evaluated in this step */
+	gap_error = compute_gap_error(frame);
+	if (!is_too_close(gap_error))
 	{
-		return min_from_inputs;
+		return nominal_acceleration;
 	}
 	else
 	{
 		active_mode = State::too_close;
-		return std::max(min_from_inputs,
+		return std::max(nominal_acceleration,
 			-ego_vehicle.get_max_brake());
 	}
 }
@@ -163,6 +230,8 @@ std::string LongitudinalControllerWithTrafficLights::mode_to_string(
 	case LongitudinalControllerWithTrafficLights::State::max_accel:
 		return "nominal (max accel)";
 		break;
+	case LongitudinalControllerWithTrafficLights::State::too_close:
+		return "too close";
 	default:
 		return "unknown mode";
 		break;
@@ -171,49 +240,33 @@ std::string LongitudinalControllerWithTrafficLights::mode_to_string(
 
 void LongitudinalControllerWithTrafficLights
 ::compute_traffic_light_input_parameters(
-	const TrafficLightACCVehicle& ego_vehicle,
-	const std::unordered_map<int, TrafficLight>& traffic_lights)
+	const PerceptionFrame& frame)
 {
-	int next_traffic_light_id = ego_vehicle.get_next_traffic_light_id();
-	if (next_traffic_light_id == 0) return;
+	if (!frame.has_traffic_light) return;
 
 	if (verbose) std::clog << "computing tf acc params" << std::endl;
 
 	/* hx is like the safe gap/ safe distance to the traffic light */
-	double hx = compute_gap_error_to_next_traffic_light(
-		ego_vehicle.get_distance_to_next_traffic_light(), 
-		ego_vehicle.get_velocity());
+	double hx = traffic_light_gap_error_formula(compute_stop_distance(frame),
+		frame.velocity,
+		compute_braking_distance(frame.velocity, comfortable_braking),
+		parameters.beta, parameters.standstill_distance);
 	
 	/* ht is how the safe set varies over time */
-	double ht = compute_transient_safe_set(ego_vehicle, traffic_lights);
+	double ht = transient_safe_set_formula(frame, parameters.beta,
+		comfortable_braking, dht);
 	h3 = ht + hx;
 }
 
-double LongitudinalControllerWithTrafficLights::
-compute_transient_safe_set(const TrafficLightACCVehicle& ego_vehicle,
-	const std::unordered_map<int, TrafficLight>& traffic_lights)
+double LongitudinalControllerWithTrafficLights::transient_safe_set_formula(
+	const PerceptionFrame& frame, double beta, double comfortable_braking,
+	double& dht)
 {
-	int next_traffic_light_id = ego_vehicle.get_next_traffic_light_id();
-
-	TrafficLight next_traffic_light =
-		traffic_lights.at(next_traffic_light_id);
-	double distance_between_traffic_lights;
-	int next_next_traffic_light_id = next_traffic_light_id + 1;
-	if (traffic_lights.find(next_next_traffic_light_id) !=
-		traffic_lights.end())
-	{
-		distance_between_traffic_lights =
-			traffic_lights.at(next_next_traffic_light_id).get_position()
-			- next_traffic_light.get_position();
-	}
-	else
-	{
-		//Any large value
-		distance_between_traffic_lights = 1000;
-	}
+	double distance_between_traffic_lights =
+		frame.distance_between_traffic_lights;
 
 	double ht;
-	if (next_traffic_light.get_current_state() == TrafficLight::State::red)
+	if (frame.traffic_light_state == TrafficLight::State::red)
 	{
 		ht = 0;
 		dht = 0;
@@ -221,8 +274,8 @@ compute_transient_safe_set(const TrafficLightACCVehicle& ego_vehicle,
 	else
 	{
 		double lambda0 = beta * comfortable_braking;
-		double time = ego_vehicle.get_time();
-		double next_red_time = next_traffic_light.get_time_of_next_red();
+		double time = frame.time;
+		double next_red_time = frame.time_of_next_red;
 		ht = -lambda0 * (time - next_red_time);
 		dht = -lambda0;
 		if (ht > distance_between_traffic_lights)
@@ -234,15 +287,18 @@ compute_transient_safe_set(const TrafficLightACCVehicle& ego_vehicle,
 	return ht;
 }
 
-double LongitudinalControllerWithTrafficLights::
-compute_gap_error_to_next_traffic_light(double distance_to_traffic_light,
-	double ego_vel)
+double LongitudinalControllerWithTrafficLights::compute_stop_distance(
+	const PerceptionFrame& frame)
 {
-	/* hx is like the safe gap/ safe distance to the traffic light */
-	double hx = distance_to_traffic_light - beta * ego_vel
-		- standstill_distance
-		- std::pow(ego_vel, 2) / 2 / comfortable_braking;
-	return hx;
+	/* Vehicles at most max_queue_gap apart belong to the same queue */
+	if (frame.traffic_light_state == TrafficLight::State::red
+		&& frame.is_leader_queued
+		&& frame.distance_to_traffic_light - frame.distance_to_queue_front
+			<= LaneVehicleIndex::max_queue_gap)
+	{
+		return frame.gap;
+	}
+	return frame.distance_to_traffic_light;
 }
 
 const std::unordered_map<
@@ -8,15 +8,17 @@
 
 #pragma once
 
+#include <cmath>
 #include <unordered_map>
 
 #include "Constants.h"
-#include "TrafficLight.h"
+#include "PerceptionFrame.h"
 
 /* Forward declaration */
 class EgoVehicle;
-class TrafficLightACCVehicle;
 
+/* All modes read the ego vehicle's PerceptionFrame, which is computed once
+per time step before the desired acceleration. */
 class LongitudinalControllerWithTrafficLights
 {
 public:
@@ -28,12 +30,26 @@ public:
 		too_close,
 	};
 
+	struct Parameters {
+		double time_headway{ 1.0 }; // [s]
+		double standstill_distance{ 3.0 };  // [m]
+		double veh_foll_gain{ 2.0 };
+		double vel_control_gain{ 1.0 };
+		double beta{ 4.0 };
+	};
+
 	LongitudinalControllerWithTrafficLights() = default;
 	LongitudinalControllerWithTrafficLights(const EgoVehicle& ego_vehicle,
 		bool verbose);
+	LongitudinalControllerWithTrafficLights(const EgoVehicle& ego_vehicle,
+		const Parameters& parameters, bool verbose);
 
 	State get_state() const { return active_mode; };
+	const Parameters& get_parameters() const { return parameters; };
 	double get_gap_error() const { return gap_error; };
+	/* Safe set value of the traffic light mode, set when its input is
+	computed */
+	double get_h3() const { return h3; };
 
 	color_t get_state_color() const;
 	double get_nominal_input(
@@ -42,45 +58,131 @@ public:
 		std::unordered_map<State, double>& possible_accelerations);
 	bool compute_velocity_control_input(const EgoVehicle& ego_vehicle,
 		std::unordered_map<State, double>& possible_accelerations);
-	bool compute_traffic_light_input(
-		const TrafficLightACCVehicle& ego_vehicle,
-		const std::unordered_map<int, TrafficLight>& traffic_lights,
+	bool compute_traffic_light_input(const EgoVehicle& ego_vehicle,
 		std::unordered_map<State, double>& possible_accelerations);
 
+	/* Relevance bounds. The minimum selection can only choose a mode whose
+	input is smaller than the inputs already computed (upper_bound). Each
+	bound is derived from the mode's formula and returns false only if the
+	mode's input is guaranteed to be larger than upper_bound, in which case
+	the mode does not need to be evaluated. */
+	/* False if the gap is large enough for the leader not to matter */
+	bool can_vehicle_following_bind(const PerceptionFrame& frame,
+		double upper_bound) const;
+	/* False if the traffic light is too far to constrain the vehicle */
+	bool can_traffic_light_bind(const PerceptionFrame& frame,
+		double upper_bound);
+
+	/* Mode formulas. The member functions above evaluate them with the
+	controller's own parameters. ShadowControllerEvaluator evaluates them
+	for many parameter sets on the same frame, so terms that only depend on
+	the frame are arguments that callers compute once. b is the comfortable
+	braking. */
+	/* v^2 / 2b */
+	static double compute_braking_distance(double ego_vel,
+		double comfortable_braking) {
+		return std::pow(ego_vel, 2) / 2 / comfortable_braking;
+	};
+	/* (v^2 - v_L^2) / 2b */
+	static double compute_braking_distance_difference(double ego_vel,
+		double leader_vel, double comfortable_braking) {
+		return (std::pow(ego_vel, 2) - std::pow(leader_vel, 2)) / 2
+			/ comfortable_braking;
+	};
+	/* a_L v_L / b */
+	static double compute_connected_extra_term(const PerceptionFrame& frame,
+		double comfortable_braking) {
+		return frame.leader_acceleration / comfortable_braking
+			* frame.leader_velocity;
+	};
+	static double gap_error_formula(double gap, double ego_vel,
+		double braking_distance_difference, double time_headway,
+		double standstill_distance) {
+		double safe_gap = time_headway * ego_vel + standstill_distance
+			+ braking_distance_difference;
+		return gap - safe_gap;
+	};
+	static double vehicle_following_formula(const PerceptionFrame& frame,
+		double gap_error, double time_headway, double veh_foll_gain,
+		double comfortable_braking) {
+		return (-frame.relative_velocity + veh_foll_gain * gap_error)
+			/ (time_headway + frame.velocity / comfortable_braking);
+	};
+	static double connected_vehicle_following_formula(
+		const PerceptionFrame& frame, double gap_error,
+		double connected_extra_term, double veh_foll_gain,
+		double comfortable_braking) {
+		return (-frame.relative_velocity + veh_foll_gain * gap_error
+			+ connected_extra_term)
+			* comfortable_braking / (comfortable_braking + frame.velocity);
+	};
+	static double velocity_control_formula(const PerceptionFrame& frame,
+		double vel_control_gain) {
+		return vel_control_gain * (frame.desired_velocity - frame.velocity);
+	};
+	/* ht, how the traffic light safe set varies over time. Also sets its
+	time derivative dht. */
+	static double transient_safe_set_formula(const PerceptionFrame& frame,
+		double beta, double comfortable_braking, double& dht);
+	/* hx, like the safe gap to the traffic light */
+	static double traffic_light_gap_error_formula(double stop_distance,
+		double ego_vel, double braking_distance, double beta,
+		double standstill_distance) {
+		return stop_distance - beta * ego_vel - standstill_distance
+			- braking_distance;
+	};
+	/* h3 = ht + hx */
+	static double traffic_light_formula(double ego_vel, double h3,
+		double dht, double beta, double comfortable_braking) {
+		return comfortable_braking / (beta * comfortable_braking + ego_vel)
+			* (dht - ego_vel + h3);
+	};
+	/* Safety override condition */
+	static bool is_too_close(double gap_error) {
+		return gap_error < -too_close_margin;
+	};
+	/* Distance to the stop line, or to the rear of the leader if it is
+	queued at a red light with the queue reaching the stop line */
+	static double compute_stop_distance(const PerceptionFrame& frame);
+
 	double choose_acceleration(const EgoVehicle& ego_vehicle,
 		std::unordered_map<State, double>& possible_accelerations);
+	/* Returns the nominal acceleration chosen at the latest call to
+	choose_acceleration, after the safety override, which uses the current
+	gap. Used by decimated control (see ControlDecimation). */
+	double reuse_nominal_acceleration(const EgoVehicle& ego_vehicle);
 
 	/* Printing ----------------------------------------------------------- */
 	static std::string mode_to_string(
 		State active_mode);
 
 private:
+	/* Absorbs rounding differences between the relevance bounds and the
+	mode formulas */
+	static constexpr double relevance_margin{ 1e-6 }; // [m]
+	static constexpr double too_close_margin{ 0.1 }; // [m] 0 for connected
+
 	State active_mode{ State::max_accel };
 	
 	double max_accel{ 0.0 }; // [m/s2]
 	double comfortable_braking{ 0.0 }; // [m/s2] absolute value
 	double gap_error{ 0.0 };  // [m] "gap error" considering relative velocity
 	double h3{ 0.0 }, dht{ 0.0 }, dhx{ 0.0 };
+	/* Minimum over the modes, before the safety override */
+	double nominal_acceleration{ 0.0 }; // [m/s2]
+	State nominal_mode{ State::max_accel };
 	bool verbose{ false };
 
-	/* Controller parameters ---------------------------------------------- */
-
-	double time_headway{ 1.0 }; // [s]
-	double standstill_distance{ 3.0 };  // [m]
-	double veh_foll_gain{ 2.0 };
-	double vel_control_gain{ 1.0 };
-	double beta{ 4.0 };
-	/* -------------------------------------------------------------------- */
+	Parameters parameters;
 
 	void compute_traffic_light_input_parameters(
-		const TrafficLightACCVehicle& ego_vehicle,
-		const std::unordered_map<int, TrafficLight>& traffic_lights);
-	double compute_gap_error_to_next_traffic_light(
-		double distance_to_traffic_light, double ego_vel);
-	double compute_transient_safe_set(const TrafficLightACCVehicle& ego_vehicle,
-		const std::unordered_map<int, TrafficLight>& traffic_lights);
+		const PerceptionFrame& frame);
+	double compute_gap_error(const PerceptionFrame& frame) const;
 	double choose_minimum_acceleration(
 		std::unordered_map<State, double>& possible_accelerations);
+	/* Brakes harder than the nominal acceleration if too close to the
+	leader */
+	double apply_safety_override(const EgoVehicle& ego_vehicle);
 
 	static const std::unordered_map<State, color_t> state_to_color;
 };
\ No newline at end of file
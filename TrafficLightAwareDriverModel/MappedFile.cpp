@@ -0,0 +1,57 @@
+#include <windows.h>
+
+#include "MappedFile.h"
+
+MappedFile::Attributes MappedFile::get_attributes(
+	const std::string& file_name)
+{
+	Attributes attributes;
+	WIN32_FILE_ATTRIBUTE_DATA data;
+	if (!GetFileAttributesExA(file_name.c_str(), GetFileExInfoStandard,
+		&data))
+	{
+		return attributes;
+	}
+	attributes.exists = true;
+	attributes.size = (static_cast<uint64_t>(data.nFileSizeHigh) << 32)
+		| data.nFileSizeLow;
+	attributes.last_write_time =
+		(static_cast<uint64_t>(data.ftLastWriteTime.dwHighDateTime) << 32)
+		| data.ftLastWriteTime.dwLowDateTime;
+	return attributes;
+}
+
+MappedFile::MappedFile(const std::string& file_name)
+{
+	HANDLE file_handle = CreateFileA(file_name.c_str(), GENERIC_READ,
+		FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL,
+		nullptr);
+	if (file_handle == INVALID_HANDLE_VALUE) return;
+	file = file_handle;
+	DWORD size_high = 0;
+	DWORD size_low = GetFileSize(file_handle, &size_high);
+	uint64_t file_size = (static_cast<uint64_t>(size_high) << 32)
+		| size_low;
+	if (file_size == 0)
+	{
+		/* Empty files cannot be mapped */
+		is_file_open = true;
+		return;
+	}
+
+	mapping = CreateFileMappingA(file_handle, nullptr, PAGE_READONLY, 0, 0,
+		nullptr);
+	if (mapping == nullptr) return;
+	data = static_cast<const char*>(
+		MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+	if (data == nullptr) return;
+	size = static_cast<size_t>(file_size);
+	is_file_open = true;
+}
+
+MappedFile::~MappedFile()
+{
+	if (data != nullptr) UnmapViewOfFile(data);
+	if (mapping != nullptr) CloseHandle(mapping);
+	if (file != nullptr) CloseHandle(file);
+}
@@ -0,0 +1,48 @@
+/*==========================================================================*/
+/*  MappedFile.h															*/
+/*  Read-only view of a file mapped into memory								*/
+/*                                                                          */
+/*  Version of 2022-06	                              Fernando V. Monteiro  */
+/*==========================================================================*/
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+/* Maps a whole file for reading, so that parsers read the file's bytes
+directly instead of copying them through streams. The view is valid while
+the object exists. Empty files open with an empty view. */
+class MappedFile
+{
+public:
+	struct Attributes {
+		bool exists{ false };
+		uint64_t size{ 0 }; // [bytes]
+		/* Windows file time (100 ns intervals since 1601) */
+		uint64_t last_write_time{ 0 };
+	};
+
+	/* Reads the attributes without opening the file */
+	static Attributes get_attributes(const std::string& file_name);
+
+	explicit MappedFile(const std::string& file_name);
+	~MappedFile();
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	bool is_open() const { return is_file_open; };
+	const char* begin() const { return data; };
+	const char* end() const { return data + size; };
+	size_t get_size() const { return size; };
+
+private:
+	/* Windows handles, kept as void* so that this header does not
+	include windows.h */
+	void* file{ nullptr };
+	void* mapping{ nullptr };
+	const char* data{ nullptr };
+	size_t size{ 0 };
+	bool is_file_open{ false };
+};
@@ -31,6 +31,7 @@ void NearbyVehicle::set_type(VehicleType nv_type, VehicleType ego_type)
 		switch (nv_type)
 		{
 		case VehicleType::traffic_light_cacc_car:
+		case VehicleType::platoon_car:
 		case VehicleType::traffic_light_acc_car:
 			this->type = VehicleType::traffic_light_acc_car;
 			break;
@@ -46,7 +47,7 @@ bool NearbyVehicle::is_connected() const
 	/* The nearby vehicle type is only set to connected if the ego vehicle
 	is also connected. So this function returns false when called by a non
 	connected vehicle. */
-	return type == VehicleType::traffic_light_cacc_car;
+	return is_a_connected_type(type);
 }
 
 double NearbyVehicle::compute_velocity(double ego_velocity) const {
@@ -153,6 +154,23 @@ std::string NearbyVehicle::to_string() const {
 	return oss.str();
 }
 
+const std::unordered_map<NearbyVehicle::Member, std::string>
+NearbyVehicle::member_to_string =
+{
+	{Member::id, "id"},
+	{Member::length, "length"},
+	{Member::width, "width"},
+	{Member::category, "category"},
+	{Member::type, "type"},
+	{Member::relative_lane, "relative_lane"},
+	{Member::relative_position, "relative_position"},
+	{Member::lateral_position, "lateral_position"},
+	{Member::distance, "distance"},
+	{Member::relative_velocity, "relative_velocity"},
+	{Member::acceleration, "acceleration"},
+	{Member::lane_change_direction, "lane_change_direction"},
+};
+
 std::ostream& operator<<(std::ostream& out, const NearbyVehicle& vehicle)
 {
 	out << vehicle.to_string();
@@ -102,18 +102,7 @@ private:
 		acceleration,
 		lane_change_direction,
 	};
-	const std::unordered_map<Member, std::string> member_to_string {
-		{Member::id, "id"},
-		{Member::length, "length"},
-		{Member::width, "width"},
-		{Member::category, "category"},
-		{Member::type, "type"},
-		{Member::relative_lane, "relative_lane"},
-		{Member::relative_position, "relative_position"},
-		{Member::lateral_position, "lateral_position"},
-		{Member::distance, "distance"},
-		{Member::relative_velocity, "relative_velocity"},
-		{Member::acceleration, "acceleration"},
-		{Member::lane_change_direction, "lane_change_direction"},
-	};
+	/* Shared by all objects, so that nearby vehicles are cheap to create
+	and can be reassigned (see EgoVehicle::emplace_nearby_vehicle) */
+	static const std::unordered_map<Member, std::string> member_to_string;
 };
@@ -0,0 +1,55 @@
+/*==========================================================================*/
+/*  PerceptionFrame.h														*/
+/*  Quantities derived once per time step from an ego vehicle's inputs		*/
+/*                                                                          */
+/*  Version of 2022-06	                              Fernando V. Monteiro  */
+/*==========================================================================*/
+
+#pragma once
+
+#include "Constants.h"
+#include "TrafficLight.h"
+
+/* What the ego vehicle perceives in the current time step. The frame is
+computed once, after the nearby vehicles are analyzed, and every controller
+mode reads from it instead of recomputing gaps and velocities and looking
+up traffic lights (see EgoVehicle::update_perception_frame). */
+struct PerceptionFrame
+{
+	double time{ 0.0 }; // [s]
+	/* Ego vehicle */
+	double velocity{ 0.0 }; // [m/s]
+	double desired_velocity{ 0.0 }; // [m/s]
+
+	/* Leader */
+	bool has_leader{ false };
+	/* Both the ego vehicle and the leader are connected */
+	bool is_leader_connected{ false };
+	bool is_leader_cutting_in{ false };
+	long leader_id{ 0 };
+	double gap{ MAX_DISTANCE }; // bumper to bumper [m]
+	double leader_velocity{ 0.0 }; // [m/s]
+	/* Ego velocity minus leader velocity [m/s] */
+	double relative_velocity{ 0.0 };
+	/* From the leader's V2V message if available, otherwise as reported by
+	VISSIM in the previous step [m/s^2] */
+	double leader_acceleration{ 0.0 };
+	bool has_leader_v2v_message{ false };
+	/* The leader is stopped or crawling, possibly at the end of a queue.
+	Only known when the vehicle is connected to the lane vehicle index. */
+	bool is_leader_queued{ false };
+	/* From the ego front to the front of the first vehicle of that queue,
+	the one nearest to the traffic light [m] */
+	double distance_to_queue_front{ 0.0 };
+
+	/* Next traffic light */
+	bool has_traffic_light{ false };
+	int traffic_light_id{ 0 };
+	double distance_to_traffic_light{ 0.0 }; // [m]
+	TrafficLight::State traffic_light_state{
+		TrafficLight::State::no_traffic_light };
+	double time_of_next_red{ 0.0 }; // [s]
+	/* Distance from the next traffic light to the one after it. Any large
+	value if there is none. */
+	double distance_between_traffic_lights{ 1000.0 }; // [m]
+};
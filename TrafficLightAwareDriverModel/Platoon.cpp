@@ -0,0 +1,118 @@
+#include <algorithm>
+#include <cmath>
+
+#include "Platoon.h"
+
+Platoon::Platoon(long id, const Member& leader) :
+	id{ id }, members{ leader }, leader_trajectory(trajectory_size) {}
+
+size_t Platoon::find_member(long id) const
+{
+	for (size_t i = 0; i < members.size(); i++)
+	{
+		if (members[i].id == id) return i;
+	}
+	return max_size;
+}
+
+double Platoon::get_length() const
+{
+	double length = members.front().length;
+	for (size_t i = 1; i < members.size(); i++)
+	{
+		length += members[i].gap + members[i].length;
+	}
+	return length;
+}
+
+void Platoon::truncate(size_t index)
+{
+	if (index < members.size()) members.resize(index);
+}
+
+void Platoon::add_leader_acceleration(double time, double acceleration)
+{
+	if (leader_trajectory[newest_sample].time != time)
+	{
+		newest_sample = (newest_sample + 1) % trajectory_size;
+	}
+	leader_trajectory[newest_sample] = TrajectorySample{ time, acceleration };
+}
+
+double Platoon::get_leader_acceleration(double time) const
+{
+	size_t index = newest_sample;
+	double oldest_acceleration = 0.0;
+	for (size_t i = 0; i < trajectory_size; i++)
+	{
+		const TrajectorySample& sample = leader_trajectory[index];
+		if (sample.time < 0.0) break;
+		if (sample.time <= time) return sample.acceleration;
+		oldest_acceleration = sample.acceleration;
+		index = (index + trajectory_size - 1) % trajectory_size;
+	}
+	/* Older than the recorded trajectory: the oldest sample is the best
+	guess */
+	return oldest_acceleration;
+}
+
+const Platoon::CrossingDecision& Platoon::decide_crossing(
+	const PerceptionFrame& frame, double max_acceleration,
+	double comfortable_braking)
+{
+	if (!frame.has_traffic_light)
+	{
+		crossing_decision = CrossingDecision();
+		return crossing_decision;
+	}
+
+	double distance = frame.distance_to_traffic_light;
+	double leader_time = compute_travel_time(distance, frame.velocity,
+		max_acceleration, frame.desired_velocity);
+	/* The last member crosses when the leader has traveled the length of
+	the platoon past the stop line */
+	double last_member_time = compute_travel_time(distance + get_length(),
+		frame.velocity, max_acceleration, frame.desired_velocity);
+	bool can_clear =
+		frame.traffic_light_state == TrafficLight::State::green
+		&& frame.time + last_member_time <= frame.time_of_next_red;
+
+	bool is_same_traffic_light =
+		crossing_decision.traffic_light_id == frame.traffic_light_id;
+	bool can_stop = distance >= std::pow(frame.velocity, 2)
+		/ 2 / comfortable_braking;
+	if (is_same_traffic_light && crossing_decision.can_clear && !can_stop)
+	{
+		/* Past the point where the platoon could stop: keep going */
+		can_clear = true;
+	}
+
+	crossing_decision.traffic_light_id = frame.traffic_light_id;
+	crossing_decision.can_clear = can_clear;
+	crossing_decision.leader_time_of_next_red = frame.time_of_next_red
+		- (last_member_time - leader_time);
+	return crossing_decision;
+}
+
+double Platoon::compute_travel_time(double distance, double velocity,
+	double max_acceleration, double desired_velocity)
+{
+	if (distance <= 0.0) return 0.0;
+	double final_velocity = std::max({ desired_velocity, velocity,
+		STOPPED_VELOCITY });
+	if (max_acceleration <= 0.0 || velocity >= final_velocity)
+	{
+		return distance / final_velocity;
+	}
+	double acceleration_time = (final_velocity - velocity)
+		/ max_acceleration;
+	double acceleration_distance = (std::pow(final_velocity, 2)
+		- std::pow(velocity, 2)) / 2 / max_acceleration;
+	if (distance <= acceleration_distance)
+	{
+		return (-velocity + std::sqrt(std::pow(velocity, 2)
+			+ 2 * max_acceleration * distance)) / max_acceleration;
+	}
+	return acceleration_time
+		+ (distance - acceleration_distance) / final_velocity;
+}
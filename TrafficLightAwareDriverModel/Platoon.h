@@ -0,0 +1,113 @@
+/*==========================================================================*/
+/*  Platoon.h																*/
+/*  State shared by the vehicles of a platoon								*/
+/*                                                                          */
+/*  Version of 2022-06	                              Fernando V. Monteiro  */
+/*==========================================================================*/
+
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+#include "PerceptionFrame.h"
+
+/* Platoon cars driving one behind the other on the same lane, leader
+first. Only the leader runs the traffic light CACC, once per step for the
+whole platoon; the followers track the leader's trajectory with a short
+time headway (see PlatoonVehicle).
+
+The platoon also decides as a whole how to approach the next traffic
+light, so that it is not split by a red light: either all members clear it
+before red, or the leader plans its approach as if the light turned red
+earlier, by the time the rest of the platoon needs to cross. Once the
+platoon decides to clear a traffic light, it keeps the decision unless the
+leader can still stop comfortably.
+
+Members report their data every step, and the platoon uses the latest
+reports, so the length seen by the leader may be one step old. Membership
+is managed by PlatoonManager. */
+class Platoon
+{
+public:
+	struct Member {
+		long id{ 0 };
+		double length{ 0.0 }; // [m]
+		/* Bumper to bumper to the member ahead. Zero for the leader. [m] */
+		double gap{ 0.0 };
+		double velocity{ 0.0 }; // [m/s]
+	};
+	struct CrossingDecision {
+		int traffic_light_id{ 0 };
+		bool can_clear{ false };
+		/* Time of the next red light for the leader, such that the last
+		member crosses before the actual red [s] */
+		double leader_time_of_next_red{ 0.0 };
+	};
+
+	static constexpr size_t max_size{ 8 };
+	/* Follower spacing: standstill_distance + time_headway * v */
+	static constexpr double time_headway{ 0.6 }; // [s]
+	static constexpr double standstill_distance{ 3.0 }; // [m]
+	/* Vehicles join the platoon ahead within join_gap of its last member,
+	and leave it when their gap grows beyond leave_gap */
+	static constexpr double join_gap{ 40.0 }; // [m]
+	static constexpr double leave_gap{ 80.0 }; // [m]
+
+	Platoon(long id, const Member& leader);
+
+	long get_id() const { return id; };
+	long get_leader_id() const { return members.front().id; };
+	long get_last_member_id() const { return members.back().id; };
+	size_t size() const { return members.size(); };
+	const std::vector<Member>& get_members() const { return members; };
+	/* Position of the vehicle in the platoon (0 for the leader), or
+	max_size if it is not a member */
+	size_t find_member(long id) const;
+	/* From the leader's front to the last member's rear [m] */
+	double get_length() const;
+	const CrossingDecision& get_crossing_decision() const {
+		return crossing_decision;
+	};
+
+	void add_member(const Member& member) { members.push_back(member); };
+	/* Removes the member at index and all members behind it */
+	void truncate(size_t index);
+	void update_member(size_t index, const Member& member) {
+		members[index] = member;
+	};
+
+	/* The leader records its commanded acceleration every step */
+	void add_leader_acceleration(double time, double acceleration);
+	/* Leader's commanded acceleration at the given time (the latest one
+	recorded at or before it, or the oldest one recorded). Zero if there is
+	none. */
+	double get_leader_acceleration(double time) const;
+
+	/* Platoon level controller, called by the leader once per step with
+	its perception frame */
+	const CrossingDecision& decide_crossing(const PerceptionFrame& frame,
+		double max_acceleration, double comfortable_braking);
+
+	/* Time to travel the distance accelerating at max_acceleration up to
+	the desired velocity [s] */
+	static double compute_travel_time(double distance, double velocity,
+		double max_acceleration, double desired_velocity);
+
+private:
+	struct TrajectorySample {
+		double time{ -1.0 }; // [s]
+		double acceleration{ 0.0 }; // [m/s^2]
+	};
+
+	/* Enough samples for the last follower of a full platoon at a 0.1 s
+	simulation time step */
+	static constexpr size_t trajectory_size{ 64 };
+
+	long id{ 0 };
+	std::vector<Member> members;
+	/* Ring buffer of the leader's commanded accelerations */
+	std::vector<TrajectorySample> leader_trajectory;
+	size_t newest_sample{ 0 };
+	CrossingDecision crossing_decision;
+};
@@ -0,0 +1,125 @@
+#include "PlatoonManager.h"
+
+Platoon* PlatoonManager::update(const Report& report)
+{
+	long vehicle_id = report.member.id;
+	Platoon* platoon = find_platoon(vehicle_id);
+	if (platoon != nullptr)
+	{
+		size_t index = platoon->find_member(vehicle_id);
+		if (index == 0)
+		{
+			platoon->update_member(index, report.member);
+			/* Platoon leaders may merge into the platoon ahead */
+			Platoon* platoon_ahead = join(report);
+			return platoon_ahead != nullptr ? platoon_ahead : platoon;
+		}
+		const Platoon::Member& member_ahead =
+			platoon->get_members()[index - 1];
+		if (report.leader_id == member_ahead.id
+			&& report.member.gap <= Platoon::leave_gap)
+		{
+			platoon->update_member(index, report.member);
+			return platoon;
+		}
+		remove_members(*platoon, index);
+	}
+	return join(report);
+}
+
+Platoon* PlatoonManager::find_platoon(long vehicle_id)
+{
+	std::unordered_map<long, long>::const_iterator platoon_id =
+		platoon_id_by_vehicle.find(vehicle_id);
+	if (platoon_id == platoon_id_by_vehicle.end()) return nullptr;
+	return &platoons.at(platoon_id->second);
+}
+
+void PlatoonManager::remove_vehicle(long vehicle_id)
+{
+	Platoon* platoon = find_platoon(vehicle_id);
+	if (platoon == nullptr) return;
+	remove_members(*platoon, platoon->find_member(vehicle_id));
+}
+
+void PlatoonManager::clear()
+{
+	platoons.clear();
+	platoon_id_by_vehicle.clear();
+	next_platoon_id = 1;
+}
+
+void PlatoonManager::remove_members(Platoon& platoon, size_t index)
+{
+	const std::vector<Platoon::Member>& members = platoon.get_members();
+	for (size_t i = index; i < members.size(); i++)
+	{
+		platoon_id_by_vehicle.erase(members[i].id);
+	}
+	if (index >= 2)
+	{
+		platoon.truncate(index);
+		return;
+	}
+	/* At most one vehicle remains */
+	for (size_t i = 0; i < index; i++)
+	{
+		platoon_id_by_vehicle.erase(members[i].id);
+	}
+	platoons.erase(platoon.get_id());
+}
+
+Platoon* PlatoonManager::join(const Report& report)
+{
+	if (!report.is_leader_platoon_car
+		|| report.member.gap > Platoon::join_gap) return nullptr;
+
+	Platoon* platoon_ahead = find_platoon(report.leader_id);
+	if (platoon_ahead == nullptr)
+	{
+		Platoon::Member leader;
+		leader.id = report.leader_id;
+		leader.length = report.leader_length;
+		long platoon_id = next_platoon_id++;
+		platoon_ahead = &platoons.emplace(platoon_id,
+			Platoon{ platoon_id, leader }).first->second;
+		platoon_id_by_vehicle[leader.id] = platoon_id;
+	}
+	long vehicle_id = report.member.id;
+	Platoon* platoon = find_platoon(vehicle_id);
+	if (platoon_ahead == platoon
+		|| platoon_ahead->get_last_member_id() != report.leader_id)
+	{
+		return nullptr;
+	}
+	if (platoon != nullptr)
+	{
+		/* The vehicle leads its own platoon */
+		if (platoon_ahead->size() + platoon->size() > Platoon::max_size)
+		{
+			if (platoon_ahead->size() == 1)
+			{
+				/* Just created above */
+				platoon_id_by_vehicle.erase(report.leader_id);
+				platoons.erase(platoon_ahead->get_id());
+			}
+			return nullptr;
+		}
+		merge(*platoon, *platoon_ahead);
+		return platoon_ahead;
+	}
+	if (platoon_ahead->size() >= Platoon::max_size) return nullptr;
+	platoon_ahead->add_member(report.member);
+	platoon_id_by_vehicle[vehicle_id] = platoon_ahead->get_id();
+	return platoon_ahead;
+}
+
+void PlatoonManager::merge(Platoon& platoon, Platoon& platoon_ahead)
+{
+	for (const Platoon::Member& member : platoon.get_members())
+	{
+		platoon_ahead.add_member(member);
+		platoon_id_by_vehicle[member.id] = platoon_ahead.get_id();
+	}
+	platoons.erase(platoon.get_id());
+}
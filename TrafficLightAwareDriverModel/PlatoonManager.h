@@ -0,0 +1,63 @@
+/*==========================================================================*/
+/*  PlatoonManager.h														*/
+/*  Formation and dissolution of platoons									*/
+/*                                                                          */
+/*  Version of 2022-06	                              Fernando V. Monteiro  */
+/*==========================================================================*/
+
+#pragma once
+
+#include <unordered_map>
+
+#include "Platoon.h"
+
+/* Owns the platoons and the membership of platoon cars. Every step, each
+platoon car reports itself and its leader, and the manager:
+- keeps it in its platoon while its leader is the member ahead of it and
+within Platoon::leave_gap. Otherwise the vehicle leaves, together with the
+members behind it, who join again behind it in the next steps;
+- adds it behind its leader if the leader is a platoon car within
+Platoon::join_gap and the last member of its platoon (or in no platoon);
+- merges the vehicle's platoon into the one ahead when the vehicle leads a
+platoon and can join the one ahead, if both fit in Platoon::max_size.
+Platoons with a single vehicle are dissolved.
+
+Vehicles find their platoon by id every step instead of keeping pointers,
+since platoons are dissolved and merged by other vehicles' reports. Not
+thread safe: vehicles must be evaluated sequentially, as in VISSIM. */
+class PlatoonManager
+{
+public:
+	struct Report {
+		Platoon::Member member;
+		/* Zero if the vehicle has no leader */
+		long leader_id{ 0 };
+		double leader_length{ 0.0 }; // [m]
+		/* The leader is a platoon car on the same lane (not cutting in) */
+		bool is_leader_platoon_car{ false };
+	};
+
+	/* Returns the vehicle's platoon, or nullptr if it is in none */
+	Platoon* update(const Report& report);
+	/* Returns nullptr if the vehicle is in no platoon */
+	Platoon* find_platoon(long vehicle_id);
+	/* The vehicle left the simulation */
+	void remove_vehicle(long vehicle_id);
+	/* Dissolves all platoons (new simulation run) */
+	void clear();
+
+	size_t get_n_platoons() const { return platoons.size(); };
+	/* Vehicles in platoons */
+	size_t get_n_members() const { return platoon_id_by_vehicle.size(); };
+
+private:
+	/* Removes the member at index and all behind it, and dissolves the
+	platoon if a single vehicle remains */
+	void remove_members(Platoon& platoon, size_t index);
+	Platoon* join(const Report& report);
+	void merge(Platoon& platoon, Platoon& platoon_ahead);
+
+	std::unordered_map<long, Platoon> platoons;
+	std::unordered_map<long, long> platoon_id_by_vehicle;
+	long next_platoon_id{ 1 };
+};
@@ -0,0 +1,129 @@
+#include <algorithm>
+#include <cmath>
+
+#include "PlatoonVehicle.h"
+
+double PlatoonVehicle::compute_desired_acceleration()
+{
+	Platoon* platoon = update_platoon_membership();
+	size_t index = platoon != nullptr ?
+		platoon->find_member(get_id()) : 0;
+
+	double desired_acceleration = index > 0 ?
+		compute_follower_acceleration(*platoon, index)
+		: compute_leader_acceleration(platoon);
+	publish_to_v2v_board(desired_acceleration);
+	return desired_acceleration;
+}
+
+Platoon* PlatoonVehicle::update_platoon_membership()
+{
+	if (platoon_manager == nullptr) return nullptr;
+
+	const PerceptionFrame& frame = get_perception_frame();
+	PlatoonManager::Report report;
+	report.member.id = get_id();
+	report.member.length = get_length();
+	report.member.velocity = frame.velocity;
+	if (frame.has_leader)
+	{
+		std::shared_ptr<NearbyVehicle> leader = get_leader();
+		report.member.gap = frame.gap;
+		report.leader_id = frame.leader_id;
+		report.leader_length = leader->get_length();
+		report.is_leader_platoon_car =
+			leader->get_type() == VehicleType::platoon_car
+			&& !frame.is_leader_cutting_in;
+	}
+	return platoon_manager->update(report);
+}
+
+double PlatoonVehicle::compute_follower_acceleration(const Platoon& platoon,
+	size_t index) const
+{
+	const PerceptionFrame& frame = get_perception_frame();
+	double velocity = frame.velocity;
+	double spacing_error = frame.gap - Platoon::standstill_distance
+		- Platoon::time_headway * velocity;
+	double desired_acceleration =
+		platoon.get_leader_acceleration(
+			frame.time - index * Platoon::time_headway)
+		+ gap_gain * spacing_error
+		+ velocity_gain * (frame.leader_velocity - velocity);
+	/* Does not accelerate beyond the desired velocity */
+	desired_acceleration = std::min(desired_acceleration,
+		velocity_gain * (frame.desired_velocity - velocity));
+
+	/* When the platoon stops at the follower's next traffic light, tracking
+	the leader keeps the follower behind it. The follower only brakes on
+	its own if it could no longer stop comfortably before the stop line. */
+	const Platoon::CrossingDecision& decision =
+		platoon.get_crossing_decision();
+	if (frame.has_traffic_light && !decision.can_clear
+		&& decision.traffic_light_id == frame.traffic_light_id
+		&& frame.distance_to_traffic_light > 0.0)
+	{
+		double stopping_acceleration = -std::pow(velocity, 2) / 2
+			/ frame.distance_to_traffic_light;
+		if (stopping_acceleration < -get_comfortable_brake())
+		{
+			desired_acceleration = std::min(desired_acceleration,
+				stopping_acceleration);
+		}
+	}
+
+	desired_acceleration = std::max(std::min(desired_acceleration,
+		get_comfortable_acceleration()), -get_max_brake());
+	if (is_too_close())
+	{
+		return -get_max_brake();
+	}
+	return desired_acceleration;
+}
+
+bool PlatoonVehicle::is_too_close() const
+{
+	const PerceptionFrame& frame = get_perception_frame();
+	if (!frame.has_leader) return false;
+	double braking_distance_difference = (std::pow(frame.velocity, 2)
+		- std::pow(frame.leader_velocity, 2)) / 2 / get_max_brake();
+	return frame.gap < min_safe_gap + braking_distance_difference;
+}
+
+double PlatoonVehicle::compute_leader_acceleration(Platoon* platoon)
+{
+	if (platoon != nullptr)
+	{
+		const Platoon::CrossingDecision& decision =
+			platoon->decide_crossing(get_perception_frame(),
+				get_comfortable_acceleration(), get_comfortable_brake());
+		const PerceptionFrame& frame = get_perception_frame();
+		if (frame.has_traffic_light)
+		{
+			set_perceived_traffic_light(!decision.can_clear,
+				decision.leader_time_of_next_red);
+		}
+	}
+
+	double desired_acceleration = compute_controller_acceleration();
+	if (platoon != nullptr)
+	{
+		platoon->add_leader_acceleration(get_time(), desired_acceleration);
+	}
+	return desired_acceleration;
+}
+
+double PlatoonVehicle::compute_controller_acceleration()
+{
+	LongitudinalControllerWithTrafficLights::State old_mode =
+		get_controller_mode();
+	double desired_acceleration =
+		controller.get_traffic_light_acc_acceleration(*this);
+	if (get_controller_mode() != old_mode)
+	{
+		add_event(Event::Type::mode_transition,
+			static_cast<long>(old_mode),
+			static_cast<long>(get_controller_mode()));
+	}
+	return desired_acceleration;
+}
@@ -0,0 +1,68 @@
+/*==========================================================================*/
+/*  PlatoonVehicle.h														*/
+/*  Connected vehicle that drives in platoons								*/
+/*                                                                          */
+/*  Version of 2022-06	                              Fernando V. Monteiro  */
+/*==========================================================================*/
+
+#pragma once
+
+#include "EgoVehicle.h"
+#include "Platoon.h"
+
+/* Platoon cars join the platoon of a platoon car right ahead of them (see
+PlatoonManager). Platoon leaders and vehicles in no platoon use the
+traffic light CACC; leaders see the next traffic light as their platoon
+decided (see Platoon::decide_crossing). Followers track the leader's
+commanded acceleration, delayed by their time headway to it, with a spacing
+and velocity correction towards the vehicle ahead:
+	a = a_L(t - i h) + k_g (g - d_0 - h v) + k_v (v_ahead - v),
+limited by the desired velocity and the vehicle's acceleration limits.
+Followers do not evaluate the controller and ignore their own traffic
+light input: they cross or stop as their platoon decided, so a follower
+never brakes for a light the platoon is clearing. If the platoon stops at
+the follower's next light, the follower also brakes for the stop line in
+case tracking could no longer stop it comfortably. Their safety check is
+a braking distance test against the vehicle ahead: when too close, they
+brake at their maximum.
+
+Vehicles not connected to a platoon manager (as in the replayer) never
+form platoons and drive as traffic light CACC vehicles. */
+class PlatoonVehicle : public EgoVehicle
+{
+public:
+	static constexpr double gap_gain{ 0.2 }; // [1/s^2]
+	static constexpr double velocity_gain{ 0.7 }; // [1/s]
+	/* Gap left when the follower and the vehicle ahead stop braking
+	equally hard */
+	static constexpr double min_safe_gap{ 1.0 }; // [m]
+
+	PlatoonVehicle(long id, double desired_velocity,
+		double simulation_time_step, double creation_time,
+		bool verbose = false) :
+		EgoVehicle(id, VehicleType::platoon_car, desired_velocity, true,
+			true, simulation_time_step, creation_time, verbose) {}
+
+	/* As sent by VISSIM */
+	int get_next_traffic_light_id() const override {
+		return get_signal_ahead_id();
+	};
+	double get_distance_to_next_traffic_light() const override {
+		return get_signal_ahead_distance();
+	};
+
+private:
+	double compute_desired_acceleration() override;
+
+	/* Reports to the platoon manager and returns the vehicle's platoon,
+	or nullptr if it is in none */
+	Platoon* update_platoon_membership();
+	double compute_follower_acceleration(const Platoon& platoon,
+		size_t index) const;
+	/* The gap is shorter than min_safe_gap plus the difference between
+	the braking distances of the follower and the vehicle ahead */
+	bool is_too_close() const;
+	double compute_leader_acceleration(Platoon* platoon);
+	/* Traffic light CACC acceleration */
+	double compute_controller_acceleration();
+};
@@ -0,0 +1,26 @@
+#include <windows.h>
+#include <psapi.h>
+
+#include "ProcessMemory.h"
+
+size_t ProcessMemory::get_working_set()
+{
+	PROCESS_MEMORY_COUNTERS counters;
+	if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters,
+		sizeof(counters)))
+	{
+		return 0;
+	}
+	return counters.WorkingSetSize;
+}
+
+size_t ProcessMemory::get_peak_working_set()
+{
+	PROCESS_MEMORY_COUNTERS counters;
+	if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters,
+		sizeof(counters)))
+	{
+		return 0;
+	}
+	return counters.PeakWorkingSetSize;
+}
@@ -0,0 +1,22 @@
+/*==========================================================================*/
+/*  ProcessMemory.h															*/
+/*  Memory used by the process that loaded the DLL							*/
+/*                                                                          */
+/*  Version of 2022-06	                              Fernando V. Monteiro  */
+/*==========================================================================*/
+
+#pragma once
+
+#include <cstddef>
+
+/* Working set (resident memory) of the current process, i.e., VISSIM or
+any other program that loaded the DLL. */
+class ProcessMemory
+{
+public:
+	/* Current working set [bytes]. Returns 0 if it cannot be read. */
+	static size_t get_working_set();
+	/* Largest working set since the process started [bytes]. Returns 0 if
+	it cannot be read. */
+	static size_t get_peak_working_set();
+};
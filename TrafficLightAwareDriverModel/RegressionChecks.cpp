@@ -0,0 +1,457 @@
+#include <cstdio>
+#include <iostream>
+#include <sstream>
+
+#include "DriverModel.h"
+#include "RegressionChecks.h"
+#include "SignalGraph.h"
+#include "SignalProgramFileReader.h"
+#include "StepInputReplayer.h"
+
+/* Signal controller 7 of the checks: 31 s of red, 35 s of green and 5 s of
+amber */
+static const std::string valid_signal_controller_file{
+	"<?xml version='1.0' encoding='UTF-8'?>\n"
+	"<sc version=\"201602\" id=\"7\" name=\"\">\n"
+	"  <signaldisplays>\n"
+	"    <display id=\"1\" name=\"Red\" state=\"RED\" />\n"
+	"    <display id=\"3\" name=\"Green\" state=\"GREEN\" />\n"
+	"    <display id=\"4\" name=\"Amber\" state=\"AMBER\" />\n"
+	"  </signaldisplays>\n"
+	"  <signalsequences>\n"
+	"    <signalsequence id=\"7\" name=\"Red-Green-Amber\">\n"
+	"      <state display=\"1\" isFixedDuration=\"false\" "
+	"defaultDuration=\"1000\" />\n"
+	"      <state display=\"3\" isFixedDuration=\"false\" "
+	"defaultDuration=\"5000\" />\n"
+	"      <state display=\"4\" isFixedDuration=\"true\" "
+	"defaultDuration=\"3000\" />\n"
+	"    </signalsequence>\n"
+	"  </signalsequences>\n"
+	"  <sgs>\n"
+	"    <sg id=\"1\" name=\"Signal group 1\" defaultSignalSequence=\"7\" />\n"
+	"  </sgs>\n"
+	"  <progs>\n"
+	"    <prog id=\"1\" cycletime=\"71000\" offset=\"0\">\n"
+	"      <sgs>\n"
+	"        <sg sg_id=\"1\" signal_sequence=\"7\">\n"
+	"          <cmds>\n"
+	"            <cmd display=\"1\" begin=\"0\" />\n"
+	"            <cmd display=\"3\" begin=\"31000\" />\n"
+	"          </cmds>\n"
+	"          <fixedstates>\n"
+	"            <fixedstate display=\"4\" duration=\"5000\" />\n"
+	"          </fixedstates>\n"
+	"        </sg>\n"
+	"      </sgs>\n"
+	"    </prog>\n"
+	"  </progs>\n"
+	"</sc>\n" };
+
+RegressionChecks::RegressionChecks(bool can_replay_live_run) :
+	can_replay_live_run{ can_replay_live_run } {}
+
+bool RegressionChecks::run_all(const std::string& results_file_name)
+{
+	std::ofstream results_file(results_file_name);
+	if (!results_file.is_open())
+	{
+		std::clog << "Unable to open the regression check results file "
+			<< results_file_name << std::endl;
+		return false;
+	}
+	results_file << "check, passed, details" << std::endl;
+
+	std::vector<Result> results;
+	results.push_back(check_traffic_light_file_parser());
+	results.push_back(check_network_file_parser());
+	results.push_back(check_signal_controller_file_reader());
+	results.push_back(check_replay_against_live());
+
+	bool all_passed = true;
+	for (const Result& result : results)
+	{
+		results_file << result.name
+			<< ", " << (result.passed ? "yes" : "no")
+			<< ", " << result.details << std::endl;
+		std::clog << "Regression check " << result.name << ": "
+			<< (result.passed ? "passed" : "FAILED") << " ("
+			<< result.details << ")" << std::endl;
+		all_passed = all_passed && result.passed;
+	}
+	return all_passed;
+}
+
+RegressionChecks::Result RegressionChecks::check_replay_against_live()
+{
+	Result result;
+	result.name = "replay against live";
+	if (!can_replay_live_run)
+	{
+		result.passed = true;
+		result.details = "skipped: the DLL uses options the replayer "
+			"does not model";
+		return result;
+	}
+
+	std::unordered_map<int, TrafficLight> base_layout;
+	base_layout.emplace(1, TrafficLight(1, 300.0, 31.0, 35.0, 5.0));
+	base_layout.emplace(2, TrafficLight(2, 700.0, 30.0, 25.0, 5.0));
+	SyntheticLoadGenerator::Configuration configuration;
+	configuration.n_vehicles = 150;
+	configuration.n_traffic_lights = 4;
+	configuration.n_nearby_vehicles = 12;
+	configuration.turnover_rate = 2.0;
+	/* The run starts at time zero, which the DLL takes as a new run */
+	SyntheticLoadGenerator generator{ configuration, base_layout,
+		time_step, 0.0, 1 };
+	if (!generator.write_traffic_light_file(traffic_light_file_name))
+	{
+		result.details = std::string("unable to write ")
+			+ traffic_light_file_name;
+		return result;
+	}
+	std::string file_name{ traffic_light_file_name };
+	DriverModelSetValue(DRIVER_DATA_PARAMETERFILE, 0, 0, 0, 0.0,
+		&file_name[0]);
+
+	std::map<std::pair<double, long>, Decision> live_decisions;
+	{
+		/* The file is complete once the recorder is destroyed */
+		StepInputRecorder recorder{ step_inputs_file_name };
+		recorder.start();
+		if (!recorder.is_recording())
+		{
+			result.details = std::string("unable to write ")
+				+ step_inputs_file_name;
+			return result;
+		}
+		for (long step = 0; step < n_replayed_steps; step++)
+		{
+			execute(generator, generator.generate_step(), recorder,
+				live_decisions);
+		}
+		execute(generator, generator.generate_removal_of_all_vehicles(),
+			recorder, live_decisions);
+	}
+
+	std::unordered_map<int, TrafficLight> traffic_lights;
+	TrafficLightFileReader::from_file_to_objects(traffic_light_file_name,
+		traffic_lights);
+	StepInputReplayer replayer{ traffic_lights, "", 0, false };
+	if (replayer.replay(step_inputs_file_name, replay_output_file_name) < 0)
+	{
+		result.details = "the recorded run could not be replayed";
+		return result;
+	}
+	std::ifstream replay_output(replay_output_file_name);
+	std::string line;
+	std::getline(replay_output, line); // header
+	long n_compared = 0;
+	long n_different = 0;
+	std::ostringstream first_difference;
+	while (std::getline(replay_output, line))
+	{
+		std::istringstream line_stream(line);
+		char separator;
+		double replay_time;
+		long vehicle_id;
+		Decision replayed;
+		line_stream >> replay_time >> separator >> vehicle_id >> separator
+			>> replayed.desired_acceleration >> separator
+			>> replayed.lane_change_direction;
+		auto live = live_decisions.find({ replay_time, vehicle_id });
+		bool is_equal = live != live_decisions.end()
+			&& live->second.desired_acceleration
+			== replayed.desired_acceleration
+			&& live->second.lane_change_direction
+			== replayed.lane_change_direction;
+		if (!is_equal && n_different == 0)
+		{
+			first_difference.precision(17);
+			first_difference << "; first at t = " << replay_time
+				<< " s, veh. " << vehicle_id << ": replayed "
+				<< replayed.desired_acceleration << " m/s^2, lane change "
+				<< replayed.lane_change_direction;
+			if (live == live_decisions.end())
+			{
+				first_difference << ", not moved in the live run";
+			}
+			else
+			{
+				first_difference << ", live "
+					<< live->second.desired_acceleration
+					<< " m/s^2, lane change "
+					<< live->second.lane_change_direction;
+			}
+		}
+		if (!is_equal) n_different++;
+		n_compared++;
+	}
+	replay_output.close();
+
+	result.passed = n_compared > 0 && n_different == 0
+		&& n_compared == static_cast<long>(live_decisions.size());
+	result.details = std::to_string(n_compared) + " replayed and "
+		+ std::to_string(live_decisions.size()) + " live vehicle steps, "
+		+ std::to_string(n_different) + " different"
+		+ first_difference.str();
+	if (result.passed)
+	{
+		std::remove(traffic_light_file_name);
+		std::remove(step_inputs_file_name);
+		std::remove(replay_output_file_name);
+	}
+	return result;
+}
+
+void RegressionChecks::execute(SyntheticLoadGenerator& generator,
+	const std::vector<SyntheticLoadGenerator::Call>& calls,
+	StepInputRecorder& recorder,
+	std::map<std::pair<double, long>, Decision>& live_decisions)
+{
+	double current_time{ 0.0 };
+	long current_vehicle_id{ 0 };
+	for (const SyntheticLoadGenerator::Call& call : calls)
+	{
+		switch (call.call_type)
+		{
+		case SyntheticLoadGenerator::CallType::set_value:
+			if (call.type == DRIVER_DATA_TIME)
+			{
+				current_time = call.double_value;
+			}
+			else if (call.type == DRIVER_DATA_VEH_ID)
+			{
+				current_vehicle_id = call.long_value;
+			}
+			recorder.record_set_value(call.type, call.index1, call.index2,
+				call.long_value, call.double_value);
+			DriverModelSetValue(call.type, call.index1, call.index2,
+				call.long_value, call.double_value, nullptr);
+			break;
+		case SyntheticLoadGenerator::CallType::get_value:
+		{
+			long long_value = 0;
+			double double_value = 0.0;
+			char* string_value = nullptr;
+			DriverModelGetValue(call.type, call.index1, call.index2,
+				&long_value, &double_value, &string_value);
+			generator.set_result(call, double_value);
+			if (call.type == DRIVER_DATA_DESIRED_ACCELERATION)
+			{
+				live_decisions[{ current_time, current_vehicle_id }]
+					.desired_acceleration = double_value;
+			}
+			else if (call.type == DRIVER_DATA_ACTIVE_LANE_CHANGE)
+			{
+				live_decisions[{ current_time, current_vehicle_id }]
+					.lane_change_direction = long_value;
+			}
+			break;
+		}
+		case SyntheticLoadGenerator::CallType::command:
+			recorder.record_command(call.type);
+			DriverModelExecuteCommand(call.type);
+			break;
+		}
+	}
+}
+
+RegressionChecks::Result RegressionChecks::check_traffic_light_file_parser()
+{
+	const char* header = "id,position,red duration,green duration,"
+		"amber duration\n";
+	std::vector<CsvCase> cases = {
+		{ "valid, with CRLF, a blank line and no final line break",
+			"1, 100, 30, 25, 5\r\n\n2,200,30,25,5", 0, 0, 2 },
+		{ "header only", "", 0, 0, 0 },
+		{ "missing field", "1,100,30,25\n", 2, 12, 0 },
+		{ "text instead of a number", "1,abc,30,25,5\n", 2, 3, 0 },
+		{ "extra field", "1,100,30,25,5,7\n", 2, 14, 0 },
+		{ "number out of range", "1,100,30,25,1e999\n", 2, 13, 0 },
+		{ "zero id", "0,100,30,25,5\n", 2, 1, 0 },
+		{ "negative duration", "1,100,-30,25,5\n", 2, 1, 0 },
+		{ "zero cycle time", "1,100,0,0,0\n", 2, 1, 0 },
+		{ "repeated id", "1,100,30,25,5\n2,200,30,25,5\n1,300,30,25,5\n",
+			4, 1, 0 },
+		{ "truncated file", "1,100,30,25,5\n2,2", 3, 4, 0 },
+		{ "lone separator", ",\n", 2, 1, 0 },
+	};
+
+	Result result;
+	result.name = "traffic light file parser";
+	std::string mismatch = check_csv_cases<TrafficLightFileReader::Row>(
+		header, cases, &TrafficLightFileReader::parse);
+	result.passed = mismatch.empty();
+	result.details = result.passed ?
+		std::to_string(cases.size()) + " cases" : mismatch;
+	return result;
+}
+
+RegressionChecks::Result RegressionChecks::check_network_file_parser()
+{
+	const char* header = "link,length,traffic light,position\n";
+	std::vector<CsvCase> cases = {
+		{ "valid, with a link without traffic lights",
+			"10,120.5,1,100\n10,120.5,2,0\n11,80,0,0\n", 0, 0, 3 },
+		{ "header only", "", 0, 0, 0 },
+		{ "missing field", "5,100,1\n", 2, 8, 0 },
+		{ "text instead of a number", "5,100,x,50\n", 2, 7, 0 },
+		{ "extra field", "5,100,1,50,3\n", 2, 11, 0 },
+		{ "zero link id", "0,100,1,50\n", 2, 1, 0 },
+		{ "zero link length", "5,0,1,0\n", 2, 1, 0 },
+		{ "negative traffic light id", "5,100,-1,50\n", 2, 1, 0 },
+		{ "position beyond the link", "5,100,1,150\n", 2, 1, 0 },
+		{ "error after valid lines", "5,100,1,50\n\n6,100,1,-1\n", 4, 1,
+			0 },
+	};
+
+	Result result;
+	result.name = "network file parser";
+	std::string mismatch = check_csv_cases<SignalGraph::Row>(
+		header, cases, &SignalGraph::parse);
+	result.passed = mismatch.empty();
+	result.details = result.passed ?
+		std::to_string(cases.size()) + " cases" : mismatch;
+	return result;
+}
+
+RegressionChecks::Result
+RegressionChecks::check_signal_controller_file_reader()
+{
+	Result result;
+	result.name = "signal controller file reader";
+	auto replace = [](std::string text, const std::string& from,
+		const std::string& to) {
+		std::string::size_type start = text.find(from);
+		if (start != std::string::npos) text.replace(start, from.size(), to);
+		return text;
+	};
+	const std::string& valid = valid_signal_controller_file;
+	struct SignalControllerCase {
+		const char* description;
+		std::string contents;
+		int program_id;
+	};
+	std::vector<SignalControllerCase> cases = {
+		{ "unclosed tag", valid.substr(0, valid.find("<cmd display=\"3\"")
+			+ 8), 0 },
+		{ "no signal controller id",
+			replace(valid, " id=\"7\" name=\"\"", ""), 0 },
+		{ "missing program", valid, 2 },
+		{ "cycle time is not a number",
+			replace(valid, "cycletime=\"71000\"", "cycletime=\"abc\""), 0 },
+		{ "no switch to green",
+			replace(valid, "<cmd display=\"3\" begin=\"31000\" />", ""), 0 },
+		{ "amber longer than green",
+			replace(valid, "<fixedstate display=\"4\" duration=\"5000\"",
+				"<fixedstate display=\"4\" duration=\"50000\""), 0 },
+		{ "not a signal controller file", "id,position\n1,100\n", 0 },
+	};
+
+	/* Traffic lights read before must survive malformed files */
+	const double position{ 250.0 }; // [m]
+	std::unordered_map<int, TrafficLight> traffic_lights;
+	traffic_lights.emplace(7, TrafficLight(7, position, 10.0, 10.0, 10.0));
+	std::string file_name{ "regression_check.sig" };
+	for (const SignalControllerCase& sig_case : cases)
+	{
+		if (!write_file(file_name, sig_case.contents))
+		{
+			result.details = "unable to write " + file_name;
+			return result;
+		}
+		bool is_read = SignalProgramFileReader::from_file_to_objects(
+			file_name, sig_case.program_id, -1.0, traffic_lights);
+		if (is_read || traffic_lights.size() != 1
+			|| traffic_lights.at(7).get_red_duration() != 10.0)
+		{
+			result.details = std::string(sig_case.description)
+				+ ": the file was accepted or changed the traffic lights";
+			return result;
+		}
+	}
+	if (SignalProgramFileReader::from_file_to_objects(
+		"regression_check_missing.sig", 0, -1.0, traffic_lights))
+	{
+		result.details = "missing file: the file was accepted";
+		return result;
+	}
+	std::string plan_file_name{ "regression_check.sigplan" };
+	if (!write_file(plan_file_name,
+		"sig file,program,position\nregression_check.sig,x,100\n")
+		|| SignalProgramFileReader::from_plan_to_objects(plan_file_name,
+			traffic_lights))
+	{
+		result.details = "malformed plan file: the file was accepted";
+		return result;
+	}
+
+	/* The valid file replaces the traffic light but keeps its position */
+	if (!write_file(file_name, valid)
+		|| !SignalProgramFileReader::from_file_to_objects(file_name, 0,
+			-1.0, traffic_lights))
+	{
+		result.details = "valid file: the file was rejected";
+		return result;
+	}
+	const TrafficLight& traffic_light = traffic_lights.at(7);
+	if (traffic_light.get_position() != position
+		|| traffic_light.get_red_duration() != 31.0
+		|| traffic_light.get_green_duration() != 35.0
+		|| traffic_light.get_amber_duration() != 5.0)
+	{
+		result.details = "valid file: wrong durations or position";
+		return result;
+	}
+	std::remove(file_name.c_str());
+	std::remove(plan_file_name.c_str());
+	result.passed = true;
+	result.details = std::to_string(cases.size() + 3) + " cases";
+	return result;
+}
+
+template <typename Row>
+std::string RegressionChecks::check_csv_cases(const char* header,
+	const std::vector<CsvCase>& cases,
+	bool (*parse)(const char* begin, const char* end,
+		std::vector<Row>& rows, TrafficLightFileReader::Error& error))
+{
+	for (const CsvCase& csv_case : cases)
+	{
+		std::string contents = header + std::string(csv_case.contents);
+		std::vector<Row> rows;
+		TrafficLightFileReader::Error error;
+		bool is_valid = parse(contents.data(),
+			contents.data() + contents.size(), rows, error);
+		bool is_expected = csv_case.error_line == 0 ?
+			is_valid && rows.size() == csv_case.n_rows
+			: !is_valid && error.line == csv_case.error_line
+			&& error.column == csv_case.error_column
+			&& !error.message.empty();
+		if (is_expected) continue;
+		std::string mismatch = std::string(csv_case.description) + ": ";
+		if (is_valid)
+		{
+			mismatch += "accepted with " + std::to_string(rows.size())
+				+ " rows";
+		}
+		else
+		{
+			mismatch += "rejected at line " + std::to_string(error.line)
+				+ ", column " + std::to_string(error.column)
+				+ " (" + error.message + ")";
+		}
+		return mismatch;
+	}
+	return std::string();
+}
+
+bool RegressionChecks::write_file(const std::string& file_name,
+	const std::string& contents)
+{
+	std::ofstream file(file_name, std::ios::binary);
+	file << contents;
+	return file.good();
+}
@@ -0,0 +1,104 @@
+/*==========================================================================*/
+/*  RegressionChecks.h														*/
+/*  Checks of the DLL that run without VISSIM								*/
+/*                                                                          */
+/*  Version of 2022-06	                              Fernando V. Monteiro  */
+/*==========================================================================*/
+
+#pragma once
+
+#include <fstream>
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "StepInputRecorder.h"
+#include "SyntheticLoadGenerator.h"
+#include "TrafficLight.h"
+#include "TrafficLightFileReader.h"
+
+/* Checks that can run in the same process as the DLL, without VISSIM:
+1. Replay against live: a synthetic run (see SyntheticLoadGenerator) goes
+through the DLL's interface functions while its calls are recorded as
+StepInputRecorder does. The recording is then replayed by
+StepInputReplayer, and every desired acceleration and lane change decision
+must equal the one the DLL returned.
+2. Parsers: valid and malformed traffic light files, network files and
+VISSIM signal controller files must be accepted or rejected, with the
+error at the expected line and column for the CSV files. Malformed files
+must not change the traffic lights already read.
+The parsers write the errors they find to std::clog, so the log of a
+successful run also shows them.
+
+The replay check uses the DLL's global state, so it must not run in a
+process where VISSIM is also using the DLL. Files are written to the
+working directory and removed after each check passes. */
+class RegressionChecks
+{
+public:
+	struct Result {
+		std::string name;
+		bool passed{ false };
+		/* Why the check failed, or what it covered */
+		std::string details;
+	};
+
+	/* can_replay_live_run: false if the DLL uses options the replayer does
+	not model (lane vehicle index, platoons, V2V board), which skips the
+	replay check */
+	explicit RegressionChecks(bool can_replay_live_run);
+
+	/* Runs all checks and writes one line per check to the results file.
+	Returns false if any check fails or the results file cannot be
+	opened. */
+	bool run_all(const std::string& results_file_name);
+	Result check_replay_against_live();
+	Result check_traffic_light_file_parser();
+	Result check_network_file_parser();
+	Result check_signal_controller_file_reader();
+
+private:
+	/* Decisions returned by the DLL for one vehicle in one time step */
+	struct Decision {
+		double desired_acceleration{ 0.0 };
+		long lane_change_direction{ 0 };
+	};
+	/* Contents of a CSV file, after its header, and the expected result
+	of parsing them */
+	struct CsvCase {
+		const char* description;
+		const char* contents;
+		/* Zero if the contents are valid */
+		size_t error_line;
+		size_t error_column;
+		/* Rows of valid contents */
+		size_t n_rows;
+	};
+
+	const double time_step{ 0.1 }; // [s]
+	const long n_replayed_steps{ 300 };
+	const char* traffic_light_file_name{
+		"regression_check_traffic_lights.csv" };
+	const char* step_inputs_file_name{
+		"regression_check_step_inputs.bin" };
+	const char* replay_output_file_name{ "regression_check_replay.csv" };
+
+	/* Calls the DLL's interface functions, records the calls and keeps
+	the decisions by time and vehicle id */
+	void execute(SyntheticLoadGenerator& generator,
+		const std::vector<SyntheticLoadGenerator::Call>& calls,
+		StepInputRecorder& recorder,
+		std::map<std::pair<double, long>, Decision>& live_decisions);
+	/* Returns the first mismatch, or an empty string */
+	template <typename Row>
+	static std::string check_csv_cases(const char* header,
+		const std::vector<CsvCase>& cases,
+		bool (*parse)(const char* begin, const char* end,
+			std::vector<Row>& rows, TrafficLightFileReader::Error& error));
+	static bool write_file(const std::string& file_name,
+		const std::string& contents);
+
+	bool can_replay_live_run{ true };
+};
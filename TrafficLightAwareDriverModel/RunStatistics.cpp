@@ -0,0 +1,171 @@
+#include <algorithm>
+#include <sstream>
+
+#include "ProcessMemory.h"
+#include "RunStatistics.h"
+
+void RunStatistics::start_step(double time, size_t n_vehicles)
+{
+	std::chrono::steady_clock::time_point now =
+		std::chrono::steady_clock::now();
+	if (n_steps == 0)
+	{
+		start_time = std::time(nullptr);
+		run_start = now;
+		allocations_at_start = AllocationCounter::get_counts();
+		decimation_at_start = ControlDecimation::get_counts();
+		first_time = time;
+	}
+	else
+	{
+		StepRecord step;
+		step.time = current_time;
+		step.wall_time = std::chrono::duration<double>(
+			now - step_start).count();
+		step.n_vehicles = n_vehicles;
+		add_slowest_step(step);
+		peak_vehicles = std::max(peak_vehicles, n_vehicles);
+		sum_of_vehicles += n_vehicles;
+	}
+	peak_working_set = std::max(peak_working_set,
+		ProcessMemory::get_working_set());
+	step_start = now;
+	current_time = time;
+	n_steps++;
+}
+
+void RunStatistics::add_slowest_step(const StepRecord& step)
+{
+	if (slowest_steps.size() == n_slowest_steps
+		&& step.wall_time <= slowest_steps.back().wall_time) return;
+
+	auto position = std::upper_bound(slowest_steps.begin(),
+		slowest_steps.end(), step,
+		[](const StepRecord& a, const StepRecord& b) {
+			return a.wall_time > b.wall_time; });
+	slowest_steps.insert(position, step);
+	if (slowest_steps.size() > n_slowest_steps) slowest_steps.pop_back();
+}
+
+std::string RunStatistics::to_json_line(
+	const TrafficLightKpiCollector::RunTotals& traffic_light_kpis) const
+{
+	AllocationCounter::Scope scope{
+		AllocationCounter::Subsystem::logging };
+
+	double wall_time = has_started() ? std::chrono::duration<double>(
+		std::chrono::steady_clock::now() - run_start).count() : 0.0;
+	double simulated_time = current_time - first_time;
+	/* The last step has no end, so it is not counted */
+	long n_finished_steps = std::max(n_steps - 1, 0L);
+	AllocationCounter::Counts allocations = AllocationCounter::get_counts();
+	uint64_t n_allocations = allocations.n_allocations
+		- allocations_at_start.n_allocations;
+	const double bytes_per_megabyte = 1024.0 * 1024.0;
+
+	std::ostringstream json;
+	json << "{\"record\": \"run_summary\""
+		<< ", \"dll_build\": \"" << __DATE__ << " " << __TIME__ << "\""
+		<< ", \"run\": \"" << run_id << "\""
+		<< ", \"start_time\": " << static_cast<long long>(start_time)
+		<< ", \"steps\": " << n_steps
+		<< ", \"simulated_time_s\": " << simulated_time
+		<< ", \"wall_time_s\": " << wall_time
+		<< ", \"real_time_factor\": "
+		<< (wall_time > 0 ? simulated_time / wall_time : 0.0)
+		<< ", \"wall_time_per_simulated_second_s\": "
+		<< (simulated_time > 0 ? wall_time / simulated_time : 0.0)
+		<< ", \"peak_vehicles\": " << peak_vehicles
+		<< ", \"mean_vehicles\": " << (n_finished_steps > 0 ?
+			double(sum_of_vehicles) / n_finished_steps : 0.0)
+		<< ", \"created_vehicles\": " << n_created_vehicles
+		<< ", \"destroyed_vehicles\": " << n_destroyed_vehicles
+		<< ", \"peak_working_set_mb\": "
+		<< peak_working_set / bytes_per_megabyte
+		<< ", \"process_peak_working_set_mb\": "
+		<< ProcessMemory::get_peak_working_set() / bytes_per_megabyte
+		<< ", \"final_working_set_mb\": "
+		<< ProcessMemory::get_working_set() / bytes_per_megabyte
+		<< ", \"allocations\": " << n_allocations
+		<< ", \"deallocations\": " << allocations.n_deallocations
+			- allocations_at_start.n_deallocations
+		<< ", \"allocated_mb\": " << (allocations.allocated_bytes
+			- allocations_at_start.allocated_bytes) / bytes_per_megabyte
+		<< ", \"allocations_per_vehicle_step\": " << (sum_of_vehicles > 0 ?
+			double(n_allocations) / sum_of_vehicles : 0.0)
+		<< ", \"slowest_steps\": [";
+	for (size_t i = 0; i < slowest_steps.size(); i++)
+	{
+		if (i > 0) json << ", ";
+		json << "{\"time\": " << slowest_steps[i].time
+			<< ", \"wall_time_ms\": " << slowest_steps[i].wall_time * 1000
+			<< ", \"vehicles\": " << slowest_steps[i].n_vehicles << "}";
+	}
+	json << "]";
+	long n_arrivals = traffic_light_kpis.arrivals_on_green
+		+ traffic_light_kpis.arrivals_on_red;
+	double n_crossings = std::max(traffic_light_kpis.throughput, 1L);
+	json << ", \"traffic_light_kpis\": {"
+		<< "\"throughput\": " << traffic_light_kpis.throughput
+		<< ", \"arrivals_on_green_fraction\": " << (n_arrivals > 0 ?
+			double(traffic_light_kpis.arrivals_on_green) / n_arrivals : 0.0)
+		<< ", \"stops_per_vehicle\": "
+		<< traffic_light_kpis.number_of_stops / n_crossings
+		<< ", \"mean_control_delay_s\": "
+		<< traffic_light_kpis.total_control_delay / n_crossings
+		<< "}";
+	if (ControlDecimation::is_enabled())
+	{
+		/* The saving is estimated from the mean times of the evaluated
+		and reused steps timed in this run (see ControlDecimation::Timer) */
+		ControlDecimation::Counts decimation = ControlDecimation::get_counts();
+		uint64_t n_evaluations = decimation.n_evaluations
+			- decimation_at_start.n_evaluations;
+		uint64_t n_reused = decimation.n_reused
+			- decimation_at_start.n_reused;
+		uint64_t n_timed_evaluations = decimation.n_timed_evaluations
+			- decimation_at_start.n_timed_evaluations;
+		uint64_t n_timed_reused = decimation.n_timed_reused
+			- decimation_at_start.n_timed_reused;
+		double mean_evaluation_time = n_timed_evaluations > 0 ?
+			(decimation.evaluation_time_ns
+				- decimation_at_start.evaluation_time_ns) * 1e-9
+			/ n_timed_evaluations : 0.0;
+		double mean_reused_time = n_timed_reused > 0 ?
+			(decimation.reused_time_ns
+				- decimation_at_start.reused_time_ns) * 1e-9
+			/ n_timed_reused : 0.0;
+		double evaluation_time = n_evaluations * mean_evaluation_time;
+		double reused_time = n_reused * mean_reused_time;
+		double saved_time = n_reused
+			* std::max(mean_evaluation_time - mean_reused_time, 0.0);
+		json << ", \"control_decimation\": {"
+			<< "\"max_reused_steps\": "
+			<< ControlDecimation::get_parameters().max_reused_steps
+			<< ", \"evaluations\": " << n_evaluations
+			<< ", \"reused_steps\": " << n_reused
+			<< ", \"reused_fraction\": " << (n_evaluations + n_reused > 0 ?
+				double(n_reused) / (n_evaluations + n_reused) : 0.0)
+			<< ", \"estimated_controller_time_ms\": "
+			<< (evaluation_time + reused_time) * 1000
+			<< ", \"estimated_saved_time_ms\": " << saved_time * 1000
+			<< "}";
+	}
+	if (AllocationCounter::is_tracking_subsystems())
+	{
+		/* The peaks are reset at the end of each run */
+		json << ", \"subsystem_peak_mb\": {";
+		for (int i = 0; i < AllocationCounter::n_subsystems; i++)
+		{
+			AllocationCounter::Subsystem subsystem =
+				AllocationCounter::Subsystem(i);
+			if (i > 0) json << ", ";
+			json << "\"" << AllocationCounter::subsystem_to_string(subsystem)
+				<< "\": " << AllocationCounter::get_subsystem_counts(
+					subsystem).peak_bytes / bytes_per_megabyte;
+		}
+		json << "}";
+	}
+	json << "}";
+	return json.str();
+}
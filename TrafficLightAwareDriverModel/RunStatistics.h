@@ -0,0 +1,71 @@
+/*==========================================================================*/
+/*  RunStatistics.h															*/
+/*  Performance and memory figures of a simulation run						*/
+/*                                                                          */
+/*  Version of 2022-06	                              Fernando V. Monteiro  */
+/*==========================================================================*/
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <ctime>
+#include <string>
+#include <vector>
+
+#include "AllocationCounter.h"
+#include "ControlDecimation.h"
+#include "TrafficLightKpiCollector.h"
+
+/* Collects timing, vehicle count and memory figures over a simulation run
+and summarizes them in a single JSON line, which is appended to the
+persistent log at the end of the run so that runs and DLL versions can be
+compared. Step times are wall clock times between consecutive simulation
+times, so they include the time VISSIM spends outside the DLL.
+The traffic light KPI totals are part of the summary so that runs with
+different settings (e.g., with and without decimated control) can be
+compared by their KPIs as well as by their performance. */
+class RunStatistics
+{
+public:
+	/* Must be called when the simulation time changes. n_vehicles is the
+	number of vehicles during the step that just ended. */
+	void start_step(double time, size_t n_vehicles);
+	void add_created_vehicle() { n_created_vehicles++; };
+	void add_destroyed_vehicle() { n_destroyed_vehicles++; };
+	bool has_started() const { return n_steps > 0; };
+	/* Identifies the run's rows in the results files */
+	void set_run_id(const std::string& run_id) { this->run_id = run_id; };
+	/* Single line JSON object with the run summary */
+	std::string to_json_line(
+		const TrafficLightKpiCollector::RunTotals& traffic_light_kpis) const;
+
+private:
+	struct StepRecord {
+		double time{ 0.0 }; // simulation time [s]
+		double wall_time{ 0.0 }; // [s]
+		size_t n_vehicles{ 0 };
+	};
+
+	static const size_t n_slowest_steps{ 5 };
+
+	void add_slowest_step(const StepRecord& step);
+
+	std::string run_id;
+	std::time_t start_time{ 0 };
+	std::chrono::steady_clock::time_point run_start;
+	std::chrono::steady_clock::time_point step_start;
+	AllocationCounter::Counts allocations_at_start;
+	ControlDecimation::Counts decimation_at_start;
+	double first_time{ 0.0 };
+	double current_time{ 0.0 };
+	long n_steps{ 0 };
+	size_t peak_vehicles{ 0 };
+	/* Largest working set sampled at the start of each step [bytes] */
+	size_t peak_working_set{ 0 };
+	uint64_t sum_of_vehicles{ 0 }; // over finished steps
+	long n_created_vehicles{ 0 };
+	long n_destroyed_vehicles{ 0 };
+	/* Sorted from slowest to fastest */
+	std::vector<StepRecord> slowest_steps;
+};
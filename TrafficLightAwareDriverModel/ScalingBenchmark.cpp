@@ -0,0 +1,166 @@
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+
+#include "DriverModel.h"
+#include "ProcessMemory.h"
+#include "ScalingBenchmark.h"
+#include "TrafficLightFileReader.h"
+
+ScalingBenchmark::ScalingBenchmark(const std::string& base_layout_file_name)
+{
+	TrafficLightFileReader::from_file_to_objects(base_layout_file_name,
+		base_layout);
+}
+
+bool ScalingBenchmark::run_all(const std::string& results_file_name)
+{
+	std::ofstream results_file(results_file_name);
+	if (!results_file.is_open())
+	{
+		std::clog << "Unable to open the benchmark results file "
+			<< results_file_name << std::endl;
+		return false;
+	}
+	results_file << "dimension, vehicles, traffic lights, nearby vehicles, "
+		<< "turnover rate, steps, steps per second, ns per vehicle step, "
+		<< "working set [MB], peak working set [MB], "
+		<< "process peak working set [MB]" << std::endl;
+
+	const Configuration base_configuration;
+	std::vector<std::pair<std::string, Configuration>> runs;
+	for (long n_vehicles : { 100, 300, 1000, 3000, 10000 })
+	{
+		Configuration configuration = base_configuration;
+		configuration.n_vehicles = n_vehicles;
+		runs.push_back({ "vehicles", configuration });
+	}
+	for (int n_nearby_vehicles : { 0, 2, 4, 8, 12 })
+	{
+		Configuration configuration = base_configuration;
+		configuration.n_nearby_vehicles = n_nearby_vehicles;
+		runs.push_back({ "nearby vehicles", configuration });
+	}
+	for (double turnover_rate : { 0.0, 1.0, 5.0, 20.0 })
+	{
+		Configuration configuration = base_configuration;
+		configuration.turnover_rate = turnover_rate;
+		runs.push_back({ "turnover rate", configuration });
+	}
+	/* Last because the DLL keeps traffic lights from previous runs */
+	for (int n_traffic_lights : { 4, 16, 64, 256 })
+	{
+		Configuration configuration = base_configuration;
+		configuration.n_traffic_lights = n_traffic_lights;
+		runs.push_back({ "traffic lights", configuration });
+	}
+
+	const double bytes_per_megabyte = 1024.0 * 1024.0;
+	for (const std::pair<std::string, Configuration>& pair : runs)
+	{
+		Result result = run(pair.first, pair.second);
+		results_file << result.dimension
+			<< ", " << result.configuration.n_vehicles
+			<< ", " << result.configuration.n_traffic_lights
+			<< ", " << result.configuration.n_nearby_vehicles
+			<< ", " << result.configuration.turnover_rate
+			<< ", " << result.n_steps
+			<< ", " << result.steps_per_second
+			<< ", " << result.ns_per_vehicle_step
+			<< ", " << result.working_set / bytes_per_megabyte
+			<< ", " << result.peak_working_set / bytes_per_megabyte
+			<< ", " << result.process_peak_working_set / bytes_per_megabyte
+			<< std::endl;
+		std::clog << "Benchmark " << result.dimension
+			<< ": " << result.configuration.n_vehicles << " veh., "
+			<< result.configuration.n_traffic_lights << " traffic lights, "
+			<< result.configuration.n_nearby_vehicles << " nearby veh., "
+			<< result.configuration.turnover_rate << " veh/s turnover -> "
+			<< result.steps_per_second << " steps/s, "
+			<< result.ns_per_vehicle_step << " ns/veh. step" << std::endl;
+	}
+	return true;
+}
+
+ScalingBenchmark::Result ScalingBenchmark::run(const std::string& dimension,
+	const Configuration& configuration)
+{
+	SyntheticLoadGenerator generator{ configuration, base_layout,
+		time_step, time, seed++ };
+	if (generator.write_traffic_light_file(traffic_light_file_name))
+	{
+		std::string file_name{ traffic_light_file_name };
+		DriverModelSetValue(DRIVER_DATA_PARAMETERFILE, 0, 0, 0, 0.0,
+			&file_name[0]);
+	}
+
+	for (long step = 0; step < n_warm_up_steps; step++)
+	{
+		execute(generator, generator.generate_step());
+	}
+
+	std::chrono::steady_clock::duration elapsed_time{ 0 };
+	long n_vehicle_steps = 0;
+	size_t peak_working_set = ProcessMemory::get_working_set();
+	for (long step = 0; step < n_measured_steps; step++)
+	{
+		/* Only the time spent inside the DLL is measured */
+		const std::vector<SyntheticLoadGenerator::Call>& calls =
+			generator.generate_step();
+		std::chrono::steady_clock::time_point start =
+			std::chrono::steady_clock::now();
+		execute(generator, calls);
+		elapsed_time += std::chrono::steady_clock::now() - start;
+		n_vehicle_steps += generator.get_n_moved_vehicles();
+		peak_working_set = std::max(peak_working_set,
+			ProcessMemory::get_working_set());
+	}
+
+	Result result;
+	result.dimension = dimension;
+	result.configuration = configuration;
+	result.n_steps = n_measured_steps;
+	double elapsed_ns = static_cast<double>(
+		std::chrono::duration_cast<std::chrono::nanoseconds>(
+			elapsed_time).count());
+	result.steps_per_second = elapsed_ns > 0 ?
+		n_measured_steps / elapsed_ns * 1e9 : 0.0;
+	result.ns_per_vehicle_step = n_vehicle_steps > 0 ?
+		elapsed_ns / n_vehicle_steps : 0.0;
+	result.working_set = ProcessMemory::get_working_set();
+	result.peak_working_set = peak_working_set;
+	result.process_peak_working_set = ProcessMemory::get_peak_working_set();
+
+	execute(generator, generator.generate_removal_of_all_vehicles());
+	time = generator.get_time() + time_step;
+	return result;
+}
+
+void ScalingBenchmark::execute(SyntheticLoadGenerator& generator,
+	const std::vector<SyntheticLoadGenerator::Call>& calls)
+{
+	for (const SyntheticLoadGenerator::Call& call : calls)
+	{
+		switch (call.call_type)
+		{
+		case SyntheticLoadGenerator::CallType::set_value:
+			DriverModelSetValue(call.type, call.index1, call.index2,
+				call.long_value, call.double_value, nullptr);
+			break;
+		case SyntheticLoadGenerator::CallType::get_value:
+		{
+			long long_value = 0;
+			double double_value = 0.0;
+			char* string_value = nullptr;
+			DriverModelGetValue(call.type, call.index1, call.index2,
+				&long_value, &double_value, &string_value);
+			generator.set_result(call, double_value);
+			break;
+		}
+		case SyntheticLoadGenerator::CallType::command:
+			DriverModelExecuteCommand(call.type);
+			break;
+		}
+	}
+}
@@ -0,0 +1,69 @@
+/*==========================================================================*/
+/*  ScalingBenchmark.h														*/
+/*  Measures how the DLL's cost grows with the size of the simulation		*/
+/*                                                                          */
+/*  Version of 2022-06	                              Fernando V. Monteiro  */
+/*==========================================================================*/
+
+#pragma once
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "SyntheticLoadGenerator.h"
+#include "TrafficLight.h"
+
+/* Feeds synthetic call sequences (see SyntheticLoadGenerator) to the DLL's
+interface functions in the same process and measures the time spent in
+them. Starting from a base configuration, one dimension (number of
+vehicles, nearby vehicles per vehicle, turnover rate or number of traffic
+lights) grows at a time.
+
+The benchmark uses the DLL's global state, so it must not run in a process
+where VISSIM is also using the DLL. */
+class ScalingBenchmark
+{
+public:
+	using Configuration = SyntheticLoadGenerator::Configuration;
+
+	struct Result {
+		std::string dimension;
+		Configuration configuration;
+		long n_steps{ 0 };
+		double steps_per_second{ 0.0 };
+		double ns_per_vehicle_step{ 0.0 };
+		size_t working_set{ 0 }; // [bytes] at the end of the run
+		/* Largest working set sampled after each step of the run [bytes] */
+		size_t peak_working_set{ 0 };
+		/* Largest working set since the process started [bytes], which
+		never decreases from one run to the next */
+		size_t process_peak_working_set{ 0 };
+	};
+
+	/* base_layout_file_name: traffic light file whose layout is
+	extrapolated to the requested number of traffic lights */
+	explicit ScalingBenchmark(const std::string& base_layout_file_name);
+
+	/* Runs all dimensions and writes one line per run to the results
+	file. Returns false if the results file cannot be opened. */
+	bool run_all(const std::string& results_file_name);
+	Result run(const std::string& dimension,
+		const Configuration& configuration);
+
+private:
+	const double time_step{ 0.1 }; // [s]
+	const long n_warm_up_steps{ 50 };
+	const long n_measured_steps{ 200 };
+	const char* traffic_light_file_name{ "synthetic_traffic_lights.csv" };
+
+	/* Calls the DLL's interface functions and passes the values got from
+	get_value calls back to the generator */
+	void execute(SyntheticLoadGenerator& generator,
+		const std::vector<SyntheticLoadGenerator::Call>& calls);
+
+	std::unordered_map<int, TrafficLight> base_layout;
+	/* Simulation time keeps increasing from one run to the next */
+	double time{ 0.0 };
+	unsigned int seed{ 1 };
+};
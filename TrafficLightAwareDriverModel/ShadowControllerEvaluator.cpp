@@ -0,0 +1,298 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <unordered_map>
+
+#include "ControlDecimation.h"
+#include "EgoVehicle.h"
+#include "ShadowControllerEvaluator.h"
+#include "SimulationLogger.h"
+
+ShadowControllerEvaluator::ShadowControllerEvaluator(
+	const std::vector<Parameters>& variants) :
+	n_variants{ variants.size() },
+	variants{ variants },
+	acceleration(variants.size()), gap_error(variants.size()),
+	h3(variants.size()), candidate(variants.size()),
+	mode(variants.size()), statistics(variants.size())
+{
+	for (const Parameters& p : variants)
+	{
+		time_headway.push_back(p.time_headway);
+		standstill_distance.push_back(p.standstill_distance);
+		veh_foll_gain.push_back(p.veh_foll_gain);
+		vel_control_gain.push_back(p.vel_control_gain);
+		beta.push_back(p.beta);
+	}
+	if (has_variants())
+	{
+		clock_overhead_ns = ControlDecimation::measure_clock_overhead();
+	}
+}
+
+ShadowControllerEvaluator::~ShadowControllerEvaluator()
+{
+	write_statistics();
+}
+
+void ShadowControllerEvaluator::evaluate(const EgoVehicle& ego_vehicle)
+{
+	if (!has_variants()) return;
+
+	if (n_calls++ % timing_period != 0)
+	{
+		evaluate_variants(ego_vehicle);
+	}
+	else
+	{
+		std::chrono::steady_clock::time_point start =
+			std::chrono::steady_clock::now();
+		evaluate_variants(ego_vehicle);
+		uint64_t elapsed_ns = std::chrono::duration_cast<
+			std::chrono::nanoseconds>(
+				std::chrono::steady_clock::now() - start).count();
+		variants_time_ns += elapsed_ns - std::min(elapsed_ns,
+			clock_overhead_ns);
+		time_controller_evaluation(ego_vehicle);
+		n_timed_calls++;
+	}
+	add_samples(ego_vehicle.get_perception_frame(),
+		ego_vehicle.get_desired_acceleration());
+}
+
+void ShadowControllerEvaluator::evaluate_variants(
+	const EgoVehicle& ego_vehicle)
+{
+	using Controller = LongitudinalControllerWithTrafficLights;
+	const size_t n = n_variants;
+
+	/* Parameter independent quantities ----------------------------------- */
+	const PerceptionFrame& frame = ego_vehicle.get_perception_frame();
+	double ego_vel = frame.velocity;
+	double braking = ego_vehicle.get_comfortable_brake();
+	double max_brake = ego_vehicle.get_max_brake();
+
+	/* Parameter dependent terms, one loop per mode ----------------------- */
+	std::fill(acceleration.begin(), acceleration.end(),
+		ego_vehicle.get_comfortable_acceleration());
+	std::fill(mode.begin(), mode.end(), static_cast<int>(State::max_accel));
+
+	if (frame.has_leader)
+	{
+		double braking_distance_difference =
+			Controller::compute_braking_distance_difference(ego_vel,
+				frame.leader_velocity, braking);
+		for (size_t k = 0; k < n; k++)
+		{
+			gap_error[k] = Controller::gap_error_formula(frame.gap, ego_vel,
+				braking_distance_difference, time_headway[k],
+				standstill_distance[k]);
+		}
+		if (frame.is_leader_connected)
+		{
+			double connected_extra_term =
+				Controller::compute_connected_extra_term(frame, braking);
+			for (size_t k = 0; k < n; k++)
+			{
+				candidate[k] = Controller::connected_vehicle_following_formula(
+					frame, gap_error[k], connected_extra_term,
+					veh_foll_gain[k], braking);
+			}
+		}
+		else
+		{
+			for (size_t k = 0; k < n; k++)
+			{
+				candidate[k] = Controller::vehicle_following_formula(frame,
+					gap_error[k], time_headway[k], veh_foll_gain[k],
+					braking);
+			}
+		}
+		choose_minimum(State::vehicle_following);
+	}
+
+	for (size_t k = 0; k < n; k++)
+	{
+		candidate[k] = Controller::velocity_control_formula(frame,
+			vel_control_gain[k]);
+	}
+	choose_minimum(State::velocity_control);
+
+	if (frame.has_traffic_light)
+	{
+		double stop_distance = Controller::compute_stop_distance(frame);
+		double braking_distance = Controller::compute_braking_distance(
+			ego_vel, braking);
+		for (size_t k = 0; k < n; k++)
+		{
+			double dht;
+			double ht = Controller::transient_safe_set_formula(frame,
+				beta[k], braking, dht);
+			double hx = Controller::traffic_light_gap_error_formula(
+				stop_distance, ego_vel, braking_distance, beta[k],
+				standstill_distance[k]);
+			h3[k] = ht + hx;
+			candidate[k] = Controller::traffic_light_formula(ego_vel, h3[k],
+				dht, beta[k], braking);
+		}
+		choose_minimum(State::traffic_light);
+	}
+
+	/* Safety override ---------------------------------------------------- */
+	if (frame.has_leader)
+	{
+		for (size_t k = 0; k < n; k++)
+		{
+			if (Controller::is_too_close(gap_error[k]))
+			{
+				acceleration[k] = std::max(acceleration[k], -max_brake);
+				mode[k] = static_cast<int>(State::too_close);
+			}
+		}
+	}
+}
+
+void ShadowControllerEvaluator::choose_minimum(State candidate_mode)
+{
+	for (size_t k = 0; k < n_variants; k++)
+	{
+		if (candidate[k] < acceleration[k])
+		{
+			acceleration[k] = candidate[k];
+			mode[k] = static_cast<int>(candidate_mode);
+		}
+	}
+}
+
+void ShadowControllerEvaluator::time_controller_evaluation(
+	const EgoVehicle& ego_vehicle)
+{
+	std::chrono::steady_clock::time_point start =
+		std::chrono::steady_clock::now();
+	LongitudinalControllerWithTrafficLights controller{ ego_vehicle,
+		variants[0], false };
+	std::unordered_map<State, double> possible_accelerations;
+	controller.get_nominal_input(possible_accelerations);
+	controller.compute_vehicle_following_input(ego_vehicle,
+		possible_accelerations);
+	controller.compute_velocity_control_input(ego_vehicle,
+		possible_accelerations);
+	controller.compute_traffic_light_input(ego_vehicle,
+		possible_accelerations);
+	controller.choose_acceleration(ego_vehicle, possible_accelerations);
+	uint64_t elapsed_ns = std::chrono::duration_cast<
+		std::chrono::nanoseconds>(
+			std::chrono::steady_clock::now() - start).count();
+	controller_time_ns += elapsed_ns - std::min(elapsed_ns,
+		clock_overhead_ns);
+}
+
+void ShadowControllerEvaluator::add_samples(const PerceptionFrame& frame,
+	double primary_acceleration)
+{
+	for (size_t k = 0; k < n_variants; k++)
+	{
+		Statistics& stats = statistics[k];
+		double difference = std::abs(acceleration[k] - primary_acceleration);
+		stats.n_samples++;
+		stats.sum_abs_difference += difference;
+		stats.sum_squared_difference += difference * difference;
+		stats.max_abs_difference = std::max(stats.max_abs_difference,
+			difference);
+		stats.mode_count[mode[k]]++;
+		if (frame.has_leader)
+		{
+			if (stats.n_gap_error_samples == 0
+				|| gap_error[k] < stats.min_gap_error)
+			{
+				stats.min_gap_error = gap_error[k];
+			}
+			stats.n_gap_error_samples++;
+			if (gap_error[k] < 0) stats.n_negative_gap_error++;
+		}
+		if (frame.has_traffic_light)
+		{
+			if (stats.n_traffic_light_samples == 0
+				|| h3[k] < stats.min_h3)
+			{
+				stats.min_h3 = h3[k];
+			}
+			stats.n_traffic_light_samples++;
+			if (h3[k] < 0) stats.n_negative_h3++;
+		}
+	}
+}
+
+void ShadowControllerEvaluator::reset_statistics()
+{
+	std::fill(statistics.begin(), statistics.end(), Statistics());
+	n_calls = 0;
+	n_timed_calls = 0;
+	variants_time_ns = 0;
+	controller_time_ns = 0;
+}
+
+void ShadowControllerEvaluator::write_statistics()
+{
+	if (!has_variants()) return;
+
+	std::ostringstream header;
+	header << "variant, time headway, standstill distance, "
+		<< "veh. foll. gain, vel. control gain, beta, samples, "
+		<< "mean abs. accel. diff., rms accel. diff., max abs. accel. diff.";
+	for (int m = 0; m < n_modes; m++)
+	{
+		header << ", "
+			<< LongitudinalControllerWithTrafficLights::mode_to_string(
+				State(m));
+	}
+	header << ", min gap error, negative gap error fraction, "
+		<< "min h3, negative h3 fraction, "
+		<< "time per call [us], time relative to K controller evaluations";
+	std::ofstream statistics_file;
+	if (!SimulationLogger::open_results_file(statistics_file,
+		statistics_file_name, header.str()))
+	{
+		std::clog << "Unable to open the shadow controller statistics file."
+			<< std::endl;
+		return;
+	}
+
+	/* Same for all rows */
+	double n_timed_calls_or_one = std::max(n_timed_calls, 1L);
+	double time_per_call = variants_time_ns / n_timed_calls_or_one / 1000;
+	double relative_time = variants_time_ns
+		/ std::max(double(n_variants * controller_time_ns), 1.0);
+	for (size_t k = 0; k < n_variants; k++)
+	{
+		const Statistics& stats = statistics[k];
+		double n_samples = std::max(stats.n_samples, 1L);
+		statistics_file << run_id
+			<< ", " << k
+			<< ", " << variants[k].time_headway
+			<< ", " << variants[k].standstill_distance
+			<< ", " << variants[k].veh_foll_gain
+			<< ", " << variants[k].vel_control_gain
+			<< ", " << variants[k].beta
+			<< ", " << stats.n_samples
+			<< ", " << stats.sum_abs_difference / n_samples
+			<< ", " << std::sqrt(stats.sum_squared_difference / n_samples)
+			<< ", " << stats.max_abs_difference;
+		for (int m = 0; m < n_modes; m++)
+		{
+			statistics_file << ", " << stats.mode_count[m] / n_samples;
+		}
+		statistics_file << ", " << stats.min_gap_error
+			<< ", " << stats.n_negative_gap_error
+			/ std::max(double(stats.n_gap_error_samples), 1.0)
+			<< ", " << stats.min_h3
+			<< ", " << stats.n_negative_h3
+			/ std::max(double(stats.n_traffic_light_samples), 1.0)
+			<< ", " << time_per_call
+			<< ", " << relative_time
+			<< "\n";
+	}
+}
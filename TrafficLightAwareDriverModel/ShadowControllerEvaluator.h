@@ -0,0 +1,97 @@
+/*==========================================================================*/
+/*  ShadowControllerEvaluator.h												*/
+/*  Evaluates alternative controller parameters on the same observations	*/
+/*  as the controller in use, without affecting the simulation				*/
+/*                                                                          */
+/*  Version of 2022-06	                              Fernando V. Monteiro  */
+/*==========================================================================*/
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "LongitudinalControllerWithTrafficLights.h"
+
+class EgoVehicle;
+
+/* Every time a vehicle computes its desired acceleration, the evaluator
+computes what the traffic light ACC would have chosen with each of K
+parameter sets (variants). Only the vehicle's own result goes back to
+VISSIM. Only traffic light ACC and CACC vehicles should be evaluated, since
+the other vehicle types do not drive with the controller at every step.
+Terms that only depend on the vehicle's perception frame are computed once
+per call, and the parameter dependent terms are computed in loops over the
+K variants stored as arrays. Every term comes from the static mode formulas
+of LongitudinalControllerWithTrafficLights, so the variants use the same
+formulas as the controller in use. The variants have no decimation, so they
+compute a new acceleration at every call.
+One in timing_period calls is timed, along with one evaluation of a
+controller object with the first variant's parameters on the same frame,
+so that the statistics show the cost of the K variants relative to K
+controller evaluations. */
+class ShadowControllerEvaluator
+{
+public:
+	using Parameters = LongitudinalControllerWithTrafficLights::Parameters;
+	using State = LongitudinalControllerWithTrafficLights::State;
+
+	ShadowControllerEvaluator(const std::vector<Parameters>& variants);
+	~ShadowControllerEvaluator();
+
+	bool has_variants() const { return n_variants > 0; };
+	/* Must be called after the vehicle computed its desired acceleration
+	in the current time step. Reads the vehicle's perception frame. */
+	void evaluate(const EgoVehicle& ego_vehicle);
+	void write_statistics();
+	/* Discards the statistics of the previous simulation run */
+	void reset_statistics();
+	/* Written in every row, since the file keeps the results of all runs */
+	void set_run_id(const std::string& run_id) { this->run_id = run_id; };
+
+private:
+	static const int n_modes{ 5 };
+	static const long timing_period{ 32 };
+
+	struct Statistics {
+		long n_samples{ 0 };
+		double sum_abs_difference{ 0.0 };
+		double sum_squared_difference{ 0.0 };
+		double max_abs_difference{ 0.0 };
+		long mode_count[n_modes]{};
+		long n_gap_error_samples{ 0 };
+		long n_negative_gap_error{ 0 };
+		double min_gap_error{ 0.0 };
+		long n_traffic_light_samples{ 0 };
+		long n_negative_h3{ 0 };
+		double min_h3{ 0.0 };
+	};
+
+	size_t n_variants{ 0 };
+	std::vector<Parameters> variants;
+	/* Parameters as arrays */
+	std::vector<double> time_headway, standstill_distance, veh_foll_gain,
+		vel_control_gain, beta;
+	/* Per variant results of the current evaluation */
+	std::vector<double> acceleration, gap_error, h3, candidate;
+	std::vector<int> mode;
+
+	std::vector<Statistics> statistics;
+	long n_calls{ 0 };
+	long n_timed_calls{ 0 };
+	uint64_t variants_time_ns{ 0 };
+	uint64_t controller_time_ns{ 0 };
+	/* Time of two consecutive clock reads */
+	uint64_t clock_overhead_ns{ 0 };
+	std::string run_id;
+	const char* statistics_file_name{ "shadow_controller_statistics.csv" };
+
+	void evaluate_variants(const EgoVehicle& ego_vehicle);
+	void choose_minimum(State candidate_mode);
+	/* Adds the time of one controller evaluation on the vehicle's frame */
+	void time_controller_evaluation(const EgoVehicle& ego_vehicle);
+	void add_samples(const PerceptionFrame& frame,
+		double primary_acceleration);
+	void measure_clock_overhead();
+};
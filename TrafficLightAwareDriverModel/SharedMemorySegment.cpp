@@ -0,0 +1,46 @@
+#include <cstdint>
+#include <windows.h>
+
+#include "SharedMemorySegment.h"
+
+SharedMemorySegment::SharedMemorySegment(const std::string& name)
+{
+	mapping = OpenFileMappingA(FILE_MAP_READ, FALSE, name.c_str());
+	if (mapping == nullptr) return;
+	void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+	if (view == nullptr) return;
+	MEMORY_BASIC_INFORMATION region;
+	if (VirtualQuery(view, &region, sizeof(region)) == 0)
+	{
+		UnmapViewOfFile(view);
+		return;
+	}
+	data = static_cast<char*>(view);
+	size = region.RegionSize;
+}
+
+SharedMemorySegment::SharedMemorySegment(const std::string& name,
+	size_t size)
+{
+	uint64_t segment_size = size;
+	mapping = CreateFileMappingA(INVALID_HANDLE_VALUE, nullptr,
+		PAGE_READWRITE, static_cast<DWORD>(segment_size >> 32),
+		static_cast<DWORD>(segment_size & 0xffffffff), name.c_str());
+	if (mapping == nullptr) return;
+	if (GetLastError() == ERROR_ALREADY_EXISTS)
+	{
+		already_exists = true;
+		return;
+	}
+	data = static_cast<char*>(
+		MapViewOfFile(mapping, FILE_MAP_WRITE, 0, 0, 0));
+	if (data == nullptr) return;
+	this->size = size;
+	is_writable = true;
+}
+
+SharedMemorySegment::~SharedMemorySegment()
+{
+	if (data != nullptr) UnmapViewOfFile(data);
+	if (mapping != nullptr) CloseHandle(mapping);
+}
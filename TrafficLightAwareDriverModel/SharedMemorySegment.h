@@ -0,0 +1,49 @@
+/*==========================================================================*/
+/*  SharedMemorySegment.h													*/
+/*  Named memory segment shared by the processes of the same session		*/
+/*                                                                          */
+/*  Version of 2022-06	                              Fernando V. Monteiro  */
+/*==========================================================================*/
+
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+/* Named shared memory (a page file backed file mapping), through which
+concurrent VISSIM instances on the same machine share data that each would
+otherwise build and keep by itself. One process creates and fills the
+segment; the others open it read-only. The segment exists while at least
+one process has it open, so nothing is left behind when the last instance
+closes. Contents must not hold pointers, since each process maps the
+segment at a different address. */
+class SharedMemorySegment
+{
+public:
+	/* Opens an existing segment for reading */
+	explicit SharedMemorySegment(const std::string& name);
+	/* Creates a segment for writing. The segment is not opened if another
+	process created it first (see get_already_exists). */
+	SharedMemorySegment(const std::string& name, size_t size);
+	~SharedMemorySegment();
+	SharedMemorySegment(const SharedMemorySegment&) = delete;
+	SharedMemorySegment& operator=(const SharedMemorySegment&) = delete;
+
+	bool is_open() const { return data != nullptr; };
+	bool get_already_exists() const { return already_exists; };
+	const char* begin() const { return data; };
+	/* Null for segments opened for reading */
+	char* get_writable_data() const { return is_writable ? data : nullptr; };
+	/* At least the size requested by the creator (rounded up to whole
+	pages for segments opened for reading) */
+	size_t get_size() const { return size; };
+
+private:
+	/* Windows handle, kept as void* so that this header does not include
+	windows.h */
+	void* mapping{ nullptr };
+	char* data{ nullptr };
+	size_t size{ 0 };
+	bool is_writable{ false };
+	bool already_exists{ false };
+};
@@ -0,0 +1,262 @@
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <mutex>
+
+#include "MappedFile.h"
+#include "SignalGraph.h"
+
+std::string SignalGraph::network_file_name(
+	const std::string& traffic_light_file)
+{
+	std::string::size_type extension = traffic_light_file.rfind(".csv");
+	return traffic_light_file.substr(0, extension) + "_network.csv";
+}
+
+bool SignalGraph::load(const std::string& file_name)
+{
+	clear();
+	MappedFile file(file_name);
+	if (!file.is_open()) return false;
+
+	std::vector<Row> rows;
+	TrafficLightFileReader::Error error;
+	if (!parse(file.begin(), file.end(), rows, error))
+	{
+		std::clog << "Error in network file " << file_name
+			<< ", line " << error.line << ", column " << error.column
+			<< ": " << error.message << std::endl;
+		return false;
+	}
+	std::stable_sort(rows.begin(), rows.end(),
+		[](const Row& a, const Row& b) {
+		return a.link < b.link || (a.link == b.link
+			&& a.position < b.position);
+	});
+
+	for (const Row& row : rows)
+	{
+		Link& link = links.emplace(row.link,
+			Link{ row.length, signals_on_links.size(), 0 }).first->second;
+		if (row.traffic_light_id != 0)
+		{
+			signals_on_links.push_back(
+				SignalOnLink{ row.traffic_light_id, row.position });
+			link.n_signals++;
+		}
+	}
+	std::clog << "Signal graph: " << links.size() << " links, "
+		<< signals_on_links.size() << " signal heads" << std::endl;
+	return !links.empty();
+}
+
+bool SignalGraph::parse(const char* begin, const char* end,
+	std::vector<Row>& rows, TrafficLightFileReader::Error& error)
+{
+	rows.clear();
+	const char* line_start = begin;
+	size_t line = 0;
+	while (line_start < end)
+	{
+		line++;
+		const char* line_end = static_cast<const char*>(
+			std::memchr(line_start, '\n', end - line_start));
+		if (line_end == nullptr) line_end = end;
+		const char* next_line_start = line_end + (line_end < end ? 1 : 0);
+		if (line_end > line_start && *(line_end - 1) == '\r') line_end--;
+		/* Skips the header and blank lines */
+		if (line == 1 || std::all_of(line_start, line_end,
+			[](char c) { return c == ' ' || c == '\t'; }))
+		{
+			line_start = next_line_start;
+			continue;
+		}
+
+		Row row;
+		const char* cursor = line_start;
+		const char* error_position = nullptr;
+		const char* error_message = nullptr;
+		bool is_valid =
+			TrafficLightFileReader::parse_field(cursor, line_end, false,
+				row.link, error_position, error_message)
+			&& TrafficLightFileReader::parse_field(cursor, line_end, false,
+				row.length, error_position, error_message)
+			&& TrafficLightFileReader::parse_field(cursor, line_end, false,
+				row.traffic_light_id, error_position, error_message)
+			&& TrafficLightFileReader::parse_field(cursor, line_end, true,
+				row.position, error_position, error_message);
+		if (is_valid)
+		{
+			error_position = line_start;
+			if (row.link <= 0)
+			{
+				error_message = "link ids must be positive";
+			}
+			else if (row.length <= 0)
+			{
+				error_message = "link lengths must be positive";
+			}
+			else if (row.traffic_light_id < 0)
+			{
+				error_message = "traffic light ids must not be negative";
+			}
+			else if (row.position < 0 || row.position > row.length)
+			{
+				error_message = "positions must be on the link";
+			}
+		}
+		if (error_message != nullptr)
+		{
+			error.line = line;
+			error.column = error_position - line_start + 1;
+			error.message = error_message;
+			return false;
+		}
+		rows.push_back(row);
+		line_start = next_line_start;
+	}
+	return true;
+}
+
+void SignalGraph::clear()
+{
+	links.clear();
+	signals_on_links.clear();
+	routes.clear();
+	route_by_links.clear();
+}
+
+void SignalGraph::locate(const std::vector<long>& route_links,
+	RouteCursor& cursor)
+{
+	if (route_links.empty()) return;
+	{
+		std::shared_lock<std::shared_mutex> read_lock(routes_mutex);
+		if (advance_along_route(route_links, cursor)) return;
+	}
+
+	/* Another vehicle may have added the route since the lock was
+	released */
+	std::unique_lock<std::shared_mutex> write_lock(routes_mutex);
+	auto route_it = route_by_links.find(route_links);
+	cursor.route = route_it != route_by_links.end() ?
+		route_it->second : add_route(route_links);
+	cursor.link = 0;
+}
+
+bool SignalGraph::advance_along_route(const std::vector<long>& route_links,
+	RouteCursor& cursor) const
+{
+	/* Routes are discarded when the graph is reloaded */
+	if (cursor.route >= routes.size()) return false;
+	const std::vector<long>& links_of_route = routes[cursor.route].links;
+	/* Vehicles only move forward along their routes */
+	size_t link = cursor.link;
+	while (link < links_of_route.size()
+		&& links_of_route[link] != route_links.front())
+	{
+		link++;
+	}
+	if (links_of_route.size() - std::min(link, links_of_route.size())
+		>= route_links.size()
+		&& std::equal(route_links.begin(), route_links.end(),
+			links_of_route.begin() + link))
+	{
+		cursor.link = link;
+		return true;
+	}
+	return false;
+}
+
+size_t SignalGraph::get_n_signals_ahead(const RouteCursor& cursor) const
+{
+	std::shared_lock<std::shared_mutex> read_lock(routes_mutex);
+	if (cursor.route >= routes.size()) return 0;
+	const Route& route = routes[cursor.route];
+	return route.traffic_light_ids.size()
+		- route.first_signal_by_link[cursor.link];
+}
+
+SignalGraph::SignalAhead SignalGraph::find_following_signal(
+	const RouteCursor& cursor, int traffic_light_id) const
+{
+	SignalAhead following;
+	std::shared_lock<std::shared_mutex> read_lock(routes_mutex);
+	if (cursor.route >= routes.size()) return following;
+	const Route& route = routes[cursor.route];
+	for (size_t i = route.first_signal_by_link[cursor.link];
+		i + 1 < route.traffic_light_ids.size(); i++)
+	{
+		if (route.traffic_light_ids[i] == traffic_light_id)
+		{
+			if (route.n_missing_links_before[i]
+				!= route.n_missing_links_before[i + 1])
+			{
+				break;
+			}
+			following.traffic_light_id = route.traffic_light_ids[i + 1];
+			following.distance = route.positions[i + 1]
+				- route.positions[i];
+			break;
+		}
+	}
+	return following;
+}
+
+size_t SignalGraph::add_route(const std::vector<long>& route_links)
+{
+	Route route;
+	route.links = route_links;
+	route.first_signal_by_link.reserve(route_links.size());
+	double link_start = 0.0;
+	std::vector<long> missing_links;
+	for (long link_id : route_links)
+	{
+		route.first_signal_by_link.push_back(
+			route.traffic_light_ids.size());
+		/* Links missing from the file have no signals and an unknown
+		length */
+		auto link_it = links.find(link_id);
+		if (link_it == links.end())
+		{
+			missing_links.push_back(link_id);
+			continue;
+		}
+		const Link& link = link_it->second;
+		for (size_t i = link.first_signal;
+			i < link.first_signal + link.n_signals; i++)
+		{
+			route.traffic_light_ids.push_back(
+				signals_on_links[i].traffic_light_id);
+			route.positions.push_back(
+				link_start + signals_on_links[i].position);
+			route.n_missing_links_before.push_back(missing_links.size());
+		}
+		link_start += link.length;
+	}
+	if (!missing_links.empty())
+	{
+		std::clog << "Route starting on link " << route_links.front()
+			<< " has links missing from the network file:";
+		for (long link_id : missing_links) std::clog << " " << link_id;
+		std::clog << ". Distances between traffic lights across them are "
+			"unknown." << std::endl;
+	}
+
+	size_t index = routes.size();
+	routes.push_back(std::move(route));
+	route_by_links.emplace(route_links, index);
+	return index;
+}
+
+size_t SignalGraph::LinkSequenceHash::operator()(
+	const std::vector<long>& links) const
+{
+	/* FNV-1a over the link numbers */
+	size_t hash = 2166136261u;
+	for (long link : links)
+	{
+		hash = (hash ^ static_cast<size_t>(link)) * 16777619u;
+	}
+	return hash;
+}
@@ -0,0 +1,142 @@
+/*==========================================================================*/
+/*  SignalGraph.h															*/
+/*  Signal heads on the links of the network and along vehicle routes		*/
+/*                                                                          */
+/*  Version of 2022-06	                              Fernando V. Monteiro  */
+/*==========================================================================*/
+
+#pragma once
+
+#include <cstddef>
+#include <shared_mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "TrafficLightFileReader.h"
+
+/* Maps the links of the network to the signal heads on them, so that
+vehicles find the traffic lights along their routes instead of assuming a
+single corridor with traffic lights ordered by id.
+
+The graph is read once from a network file (see network_file_name) with
+one row per signal head, or per link without signal heads:
+	link, link length [m], traffic light id (0 if none), position on link [m]
+Malformed lines are reported with their line and column (as in
+TrafficLightFileReader), and a file with errors gives an empty graph.
+Routes are the link sequences sent by VISSIM (DRIVER_DATA_VEH_CURRENT_LINK
+followed by DRIVER_DATA_VEH_NEXT_LINKS). The first time a route is seen,
+the sequence of signal heads along it and their distances from the start
+of the route are computed and kept; later vehicles on the same route
+reuse them. Each vehicle keeps a cursor to its route and current link,
+which moves forward as the vehicle advances, so the cost of finding the
+traffic lights ahead grows with the length of the route but not with the
+size of the network.
+Route links missing from the network file (often connectors) have unknown
+lengths. They are logged once per route, and no distance is given between
+signal heads on both sides of a missing link.
+
+Routes are added while vehicles are evaluated, under a lock, so vehicles
+can be evaluated in parallel (see StepInputReplayer). Loading and clearing
+the graph are not thread safe. */
+class SignalGraph
+{
+public:
+	static constexpr size_t no_route{ static_cast<size_t>(-1) };
+
+	/* Position of a vehicle on its route. Kept by the vehicle. */
+	struct RouteCursor {
+		size_t route{ no_route };
+		/* Index of the vehicle's current link in the route */
+		size_t link{ 0 };
+	};
+	struct SignalAhead {
+		/* Zero if there is none */
+		int traffic_light_id{ 0 };
+		/* From the reference traffic light [m] */
+		double distance{ 0.0 };
+	};
+	/* One line of the network file */
+	struct Row {
+		long link{ 0 };
+		double length{ 0.0 }; // [m]
+		int traffic_light_id{ 0 };
+		double position{ 0.0 }; // from the start of the link [m]
+	};
+
+	/* The network file of a traffic light file: the same name ending in
+	_network.csv */
+	static std::string network_file_name(
+		const std::string& traffic_light_file);
+
+	/* Replaces the graph with the one in the file. Returns false, and
+	leaves the graph empty, if the file cannot be read or has errors,
+	which are written to std::clog. */
+	bool load(const std::string& file_name);
+	/* Parses the contents of a network file. Stops at the first error. */
+	static bool parse(const char* begin, const char* end,
+		std::vector<Row>& rows, TrafficLightFileReader::Error& error);
+	void clear();
+	bool empty() const { return links.empty(); };
+	size_t get_n_links() const { return links.size(); };
+	size_t get_n_routes() const { return routes.size(); };
+
+	/* Moves the cursor to the route made of route_links (the current link
+	first). Advances along the cursor's route when route_links is the rest
+	of it, and otherwise finds or builds the route. */
+	void locate(const std::vector<long>& route_links,
+		RouteCursor& cursor);
+	/* Traffic lights on the rest of the route, from the cursor's link,
+	in the order the vehicle reaches them */
+	size_t get_n_signals_ahead(const RouteCursor& cursor) const;
+	/* The traffic light after the given one along the route, and the
+	distance between both. Zero id if there is none, if the given
+	traffic light is not on the rest of the route, or if a link between
+	both is missing from the network file. */
+	SignalAhead find_following_signal(const RouteCursor& cursor,
+		int traffic_light_id) const;
+
+private:
+	struct Link {
+		double length{ 0.0 }; // [m]
+		/* Range in signals_on_links */
+		size_t first_signal{ 0 };
+		size_t n_signals{ 0 };
+	};
+	struct SignalOnLink {
+		int traffic_light_id{ 0 };
+		double position{ 0.0 }; // from the start of the link [m]
+	};
+	struct Route {
+		std::vector<long> links;
+		/* Signal heads along the route and their distances from the start
+		of the first link */
+		std::vector<int> traffic_light_ids;
+		std::vector<double> positions; // [m]
+		/* For each signal head, links missing from the network file
+		before it on the route. Distances are only known between signal
+		heads with the same count. */
+		std::vector<size_t> n_missing_links_before;
+		/* For each link, index of the first signal head on it or after
+		it */
+		std::vector<size_t> first_signal_by_link;
+	};
+	struct LinkSequenceHash {
+		size_t operator()(const std::vector<long>& links) const;
+	};
+
+	/* True if route_links is the rest of the cursor's route. Moves the
+	cursor to its first link. */
+	bool advance_along_route(const std::vector<long>& route_links,
+		RouteCursor& cursor) const;
+	size_t add_route(const std::vector<long>& route_links);
+
+	std::unordered_map<long, Link> links;
+	/* Grouped by link, in driving order */
+	std::vector<SignalOnLink> signals_on_links;
+	std::vector<Route> routes;
+	std::unordered_map<std::vector<long>, size_t, LinkSequenceHash>
+		route_by_links;
+	/* Exclusive to add routes, shared to read them */
+	mutable std::shared_mutex routes_mutex;
+};
@@ -0,0 +1,465 @@
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+
+#include "MappedFile.h"
+#include "SignalProgramFileReader.h"
+
+bool SignalProgramFileReader::from_file_to_objects(
+	const std::string& full_address, int program_id, double position,
+	std::unordered_map<int, TrafficLight>& traffic_lights)
+{
+	MappedFile file(full_address);
+	if (!file.is_open())
+	{
+		std::clog << "Could not open signal controller file "
+			<< full_address << std::endl;
+		return false;
+	}
+
+	/* Durations and times in the file are in milliseconds */
+	struct DisplayDuration {
+		int display{ 0 };
+		double duration{ 0.0 };
+	};
+	struct SequenceState {
+		int display{ 0 };
+		bool is_fixed_duration{ false };
+		double default_duration{ 0.0 };
+	};
+	struct SignalGroup {
+		int id{ 0 };
+		int signal_sequence{ 0 };
+		std::vector<DisplayDuration> default_durations;
+	};
+	struct Command {
+		int display{ 0 };
+		double begin{ 0.0 };
+	};
+	struct ProgramSignalGroup {
+		int id{ 0 };
+		int signal_sequence{ 0 };
+		std::vector<Command> commands;
+		std::vector<DisplayDuration> fixed_states;
+	};
+	struct Program {
+		int id{ 0 };
+		double cycle_time{ 0.0 };
+		double offset{ 0.0 };
+		std::vector<ProgramSignalGroup> signal_groups;
+	};
+
+	int controller_id{ 0 };
+	std::unordered_map<int, TrafficLight::State> state_by_display;
+	std::unordered_map<int, std::vector<SequenceState>> signal_sequences;
+	std::vector<SignalGroup> signal_groups;
+	std::vector<Program> programs;
+	int current_signal_sequence{ 0 };
+	bool is_in_program{ false };
+
+	const char* cursor = file.begin();
+	Tag tag;
+	while (next_tag(cursor, file.end(), tag))
+	{
+		if (tag.is_closing)
+		{
+			if (tag.name == "prog") is_in_program = false;
+			else if (tag.name == "signalsequence") current_signal_sequence = 0;
+		}
+		else if (tag.name == "sc")
+		{
+			read_attribute(tag, "id", controller_id);
+		}
+		else if (tag.name == "display")
+		{
+			int display{ 0 };
+			read_attribute(tag, "id", display);
+			std::string_view state = find_attribute(tag.attributes, "state");
+			state_by_display[display] =
+				state == "RED" ? TrafficLight::State::red
+				: state == "AMBER" ? TrafficLight::State::amber
+				: state == "GREEN" ? TrafficLight::State::green
+				: TrafficLight::State::no_traffic_light;
+		}
+		else if (tag.name == "signalsequence")
+		{
+			read_attribute(tag, "id", current_signal_sequence);
+			signal_sequences[current_signal_sequence];
+		}
+		else if (tag.name == "state" && current_signal_sequence != 0)
+		{
+			SequenceState state;
+			read_attribute(tag, "display", state.display);
+			read_attribute(tag, "defaultDuration", state.default_duration);
+			state.is_fixed_duration = find_attribute(tag.attributes,
+				"isFixedDuration") == "true";
+			signal_sequences[current_signal_sequence].push_back(state);
+		}
+		else if (tag.name == "sg" && is_in_program)
+		{
+			ProgramSignalGroup signal_group;
+			read_attribute(tag, "sg_id", signal_group.id);
+			read_attribute(tag, "signal_sequence",
+				signal_group.signal_sequence);
+			programs.back().signal_groups.push_back(signal_group);
+		}
+		else if (tag.name == "sg")
+		{
+			SignalGroup signal_group;
+			read_attribute(tag, "id", signal_group.id);
+			read_attribute(tag, "defaultSignalSequence",
+				signal_group.signal_sequence);
+			signal_groups.push_back(signal_group);
+		}
+		else if (tag.name == "defaultDuration" && !signal_groups.empty())
+		{
+			DisplayDuration default_duration;
+			read_attribute(tag, "display", default_duration.display);
+			read_attribute(tag, "duration", default_duration.duration);
+			signal_groups.back().default_durations.push_back(
+				default_duration);
+		}
+		else if (tag.name == "prog")
+		{
+			Program program;
+			read_attribute(tag, "id", program.id);
+			read_attribute(tag, "cycletime", program.cycle_time);
+			read_attribute(tag, "offset", program.offset);
+			programs.push_back(program);
+			is_in_program = !tag.is_self_closing;
+		}
+		else if (tag.name == "cmd" && is_in_program
+			&& !programs.back().signal_groups.empty())
+		{
+			Command command;
+			read_attribute(tag, "display", command.display);
+			read_attribute(tag, "begin", command.begin);
+			programs.back().signal_groups.back().commands.push_back(command);
+		}
+		else if (tag.name == "fixedstate" && is_in_program
+			&& !programs.back().signal_groups.empty())
+		{
+			DisplayDuration fixed_state;
+			read_attribute(tag, "display", fixed_state.display);
+			read_attribute(tag, "duration", fixed_state.duration);
+			programs.back().signal_groups.back().fixed_states.push_back(
+				fixed_state);
+		}
+	}
+
+	auto report_error = [&full_address](const std::string& message) {
+		std::clog << "Error in signal controller file " << full_address
+			<< ": " << message << std::endl;
+		return false;
+	};
+	if (cursor != file.end())
+	{
+		long line = 1 + static_cast<long>(
+			std::count(file.begin(), cursor, '\n'));
+		return report_error("unclosed tag on line " + std::to_string(line));
+	}
+	if (controller_id <= 0) return report_error("no signal controller id");
+	auto program = std::find_if(programs.begin(), programs.end(),
+		[program_id](const Program& p) {
+		return program_id == 0 || p.id == program_id;
+	});
+	if (program == programs.end())
+	{
+		return report_error("no signal program "
+			+ std::to_string(program_id));
+	}
+	if (program->cycle_time <= 0 || program->signal_groups.empty())
+	{
+		return report_error("signal program "
+			+ std::to_string(program->id) + " has no cycle time or no "
+			"signal groups");
+	}
+	const ProgramSignalGroup& signal_group = program->signal_groups.front();
+	auto is_display = [&state_by_display](int display,
+		TrafficLight::State state) {
+		auto it = state_by_display.find(display);
+		return it != state_by_display.end() && it->second == state;
+	};
+
+	double red_begin{ -1.0 };
+	double green_begin{ -1.0 };
+	for (const Command& command : signal_group.commands)
+	{
+		if (is_display(command.display, TrafficLight::State::red))
+		{
+			red_begin = command.begin;
+		}
+		else if (is_display(command.display, TrafficLight::State::green))
+		{
+			green_begin = command.begin;
+		}
+	}
+	if (red_begin < 0 || green_begin < 0)
+	{
+		return report_error("signal group "
+			+ std::to_string(signal_group.id) + " of program "
+			+ std::to_string(program->id)
+			+ " does not switch to both red and green");
+	}
+
+	/* The amber duration set in the program, or else the defaults of the
+	signal group and of its signal sequence */
+	double amber_duration{ -1.0 };
+	for (const DisplayDuration& fixed_state : signal_group.fixed_states)
+	{
+		if (is_display(fixed_state.display, TrafficLight::State::amber))
+		{
+			amber_duration = fixed_state.duration;
+		}
+	}
+	auto default_group = std::find_if(signal_groups.begin(),
+		signal_groups.end(), [&signal_group](const SignalGroup& g) {
+		return g.id == signal_group.id;
+	});
+	if (amber_duration < 0 && default_group != signal_groups.end())
+	{
+		for (const DisplayDuration& default_duration
+			: default_group->default_durations)
+		{
+			if (is_display(default_duration.display,
+				TrafficLight::State::amber))
+			{
+				amber_duration = default_duration.duration;
+			}
+		}
+	}
+	int signal_sequence = signal_group.signal_sequence != 0 ?
+		signal_group.signal_sequence
+		: default_group != signal_groups.end() ?
+		default_group->signal_sequence : 0;
+	if (amber_duration < 0)
+	{
+		for (const SequenceState& state : signal_sequences[signal_sequence])
+		{
+			if (state.is_fixed_duration
+				&& is_display(state.display, TrafficLight::State::amber))
+			{
+				amber_duration = state.default_duration;
+			}
+		}
+	}
+	amber_duration = std::max(amber_duration, 0.0);
+
+	double cycle_time = program->cycle_time;
+	double red_duration = std::fmod(
+		std::fmod(green_begin - red_begin, cycle_time) + cycle_time,
+		cycle_time);
+	double green_duration = cycle_time - red_duration - amber_duration;
+	if (green_duration < 0)
+	{
+		return report_error("the amber time of signal group "
+			+ std::to_string(signal_group.id)
+			+ " is longer than its green time");
+	}
+	double offset = std::fmod(program->offset + red_begin, cycle_time);
+
+	if (position < 0)
+	{
+		auto existing = traffic_lights.find(controller_id);
+		position = existing != traffic_lights.end() ?
+			existing->second.get_position() : 0.0;
+	}
+	traffic_lights.insert_or_assign(controller_id,
+		TrafficLight(controller_id, position, red_duration / 1000,
+			green_duration / 1000, amber_duration / 1000, offset / 1000));
+	return true;
+}
+
+bool SignalProgramFileReader::from_plan_to_objects(
+	const std::string& full_address,
+	std::unordered_map<int, TrafficLight>& traffic_lights)
+{
+	MappedFile file(full_address);
+	if (!file.is_open())
+	{
+		std::clog << "Could not open signal plan file " << full_address
+			<< std::endl;
+		return false;
+	}
+	std::string::size_type folder_end = full_address.find_last_of("/\\");
+	std::string folder = folder_end == std::string::npos ?
+		"" : full_address.substr(0, folder_end + 1);
+
+	bool is_plan_read{ true };
+	std::string_view text{ file.begin(), file.get_size() };
+	long line = 0;
+	while (!text.empty())
+	{
+		line++;
+		std::string_view::size_type line_end = text.find('\n');
+		std::string_view fields = text.substr(0, line_end);
+		text.remove_prefix(line_end == std::string_view::npos ?
+			text.size() : line_end + 1);
+		if (!fields.empty() && fields.back() == '\r') fields.remove_suffix(1);
+		if (line == 1 || fields.find_first_not_of(" \t")
+			== std::string_view::npos)
+		{
+			continue; // header and blank lines
+		}
+
+		std::string_view field[3];
+		for (std::string_view& f : field)
+		{
+			std::string_view::size_type comma = fields.find(',');
+			f = fields.substr(0, comma);
+			fields.remove_prefix(comma == std::string_view::npos ?
+				fields.size() : comma + 1);
+			while (!f.empty() && (f.front() == ' ' || f.front() == '\t'))
+			{
+				f.remove_prefix(1);
+			}
+			while (!f.empty() && (f.back() == ' ' || f.back() == '\t'))
+			{
+				f.remove_suffix(1);
+			}
+		}
+		int program_id{ 0 };
+		double position{ 0.0 };
+		const char* program_end = field[1].data() + field[1].size();
+		const char* position_end = field[2].data() + field[2].size();
+		if (field[0].empty()
+			|| std::from_chars(field[1].data(), program_end,
+				program_id).ptr != program_end
+			|| std::from_chars(field[2].data(), position_end,
+				position).ptr != position_end)
+		{
+			std::clog << "Error in signal plan file " << full_address
+				<< ", line " << line << ": expected .sig file, program, "
+				"position" << std::endl;
+			is_plan_read = false;
+			continue;
+		}
+		std::string sig_file{ field[0] };
+		bool is_absolute = sig_file.front() == '/' || sig_file.front() == '\\'
+			|| (sig_file.size() > 1 && sig_file[1] == ':');
+		is_plan_read &= from_file_to_objects(
+			is_absolute ? sig_file : folder + sig_file, program_id, position,
+			traffic_lights);
+	}
+	return is_plan_read;
+}
+
+bool SignalProgramFileReader::is_signal_program_file(
+	const std::string& file_name)
+{
+	return ends_with(file_name, signal_controller_extension)
+		|| ends_with(file_name, plan_extension);
+}
+
+bool SignalProgramFileReader::next_tag(const char*& cursor, const char* end,
+	Tag& tag)
+{
+	while (cursor < end)
+	{
+		const char* tag_start = static_cast<const char*>(
+			std::memchr(cursor, '<', end - cursor));
+		if (tag_start == nullptr)
+		{
+			cursor = end;
+			return false;
+		}
+		std::string_view rest{ tag_start, static_cast<size_t>(
+			end - tag_start) };
+		if (rest.compare(0, 4, "<!--") == 0)
+		{
+			std::string_view::size_type comment_end = rest.find("-->");
+			if (comment_end == std::string_view::npos)
+			{
+				cursor = tag_start;
+				return false;
+			}
+			cursor = tag_start + comment_end + 3;
+			continue;
+		}
+		const char* tag_end = static_cast<const char*>(
+			std::memchr(tag_start, '>', end - tag_start));
+		if (tag_end == nullptr)
+		{
+			cursor = tag_start;
+			return false;
+		}
+		cursor = tag_end + 1;
+		/* Declarations (<?xml ...?>, <!DOCTYPE ...>) */
+		if (tag_start[1] == '?' || tag_start[1] == '!') continue;
+
+		const char* name_start = tag_start + 1;
+		tag.is_closing = *name_start == '/';
+		if (tag.is_closing) name_start++;
+		tag.is_self_closing = tag_end[-1] == '/';
+		const char* content_end = tag.is_self_closing ? tag_end - 1 : tag_end;
+		const char* name_end = name_start;
+		while (name_end < content_end && *name_end != ' '
+			&& *name_end != '\t' && *name_end != '\r' && *name_end != '\n')
+		{
+			name_end++;
+		}
+		tag.name = std::string_view{ name_start,
+			static_cast<size_t>(name_end - name_start) };
+		tag.attributes = std::string_view{ name_end,
+			static_cast<size_t>(content_end - name_end) };
+		return true;
+	}
+	return false;
+}
+
+std::string_view SignalProgramFileReader::find_attribute(
+	std::string_view attributes, std::string_view name)
+{
+	std::string_view::size_type position = 0;
+	while ((position = attributes.find(name, position))
+		!= std::string_view::npos)
+	{
+		std::string_view::size_type value_start = position + name.size();
+		/* Whole attribute names only (id, not sg_id) */
+		bool is_name_start = position == 0
+			|| attributes[position - 1] == ' '
+			|| attributes[position - 1] == '\t'
+			|| attributes[position - 1] == '\n'
+			|| attributes[position - 1] == '\r';
+		if (is_name_start && value_start + 1 < attributes.size()
+			&& attributes[value_start] == '='
+			&& (attributes[value_start + 1] == '"'
+				|| attributes[value_start + 1] == '\''))
+		{
+			char quote = attributes[value_start + 1];
+			std::string_view::size_type value_end =
+				attributes.find(quote, value_start + 2);
+			if (value_end == std::string_view::npos) return {};
+			return attributes.substr(value_start + 2,
+				value_end - value_start - 2);
+		}
+		position = value_start;
+	}
+	return {};
+}
+
+template <typename Number>
+bool SignalProgramFileReader::read_attribute(const Tag& tag,
+	std::string_view name, Number& value)
+{
+	std::string_view text = find_attribute(tag.attributes, name);
+	if (text.empty()) return false;
+	const char* text_end = text.data() + text.size();
+	Number number{};
+	if (std::from_chars(text.data(), text_end, number).ptr != text_end)
+	{
+		return false;
+	}
+	value = number;
+	return true;
+}
+
+bool SignalProgramFileReader::ends_with(const std::string& text,
+	const char* suffix)
+{
+	size_t suffix_size = std::strlen(suffix);
+	return text.size() >= suffix_size
+		&& text.compare(text.size() - suffix_size, suffix_size, suffix) == 0;
+}
@@ -0,0 +1,88 @@
+/*==========================================================================*/
+/*  SignalProgramFileReader.h												*/
+/*  Reads traffic light timings from VISSIM signal controller files (.sig)	*/
+/*                                                                          */
+/*  Version of 2022-06	                              Fernando V. Monteiro  */
+/*==========================================================================*/
+
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "TrafficLight.h"
+
+/* Derives the traffic lights from the fixed time signal programs in the
+.sig files VISSIM itself uses, so that the timings are not copied by hand
+into the traffic light CSV file.
+
+A .sig file describes one signal controller, with one or more programs.
+For the chosen program and the controller's first signal group:
+- the cycle time is the program's cycletime;
+- red lasts from the red command to the green command;
+- amber is the fixed state after green (from the program, or from the
+signal group's or signal sequence's default durations), and ends at the
+red command;
+- green is the rest of the cycle;
+- the offset, the time in the cycle at which red starts, is the program's
+offset plus the time of the red command.
+The DLL identifies traffic lights by signal controller, so each file gives
+one traffic light with the controller's id.
+
+The .sig files do not have the position of the traffic lights, which come
+from a signal plan file (see from_plan_to_objects) or from a traffic light
+CSV file read before. The XML is read in a single pass over the mapped
+file, without building a document tree. */
+class SignalProgramFileReader
+{
+public:
+	/* Signal plan files list the .sig files of a simulation, so that
+	sweeping signal plans means pointing at another plan file */
+	static constexpr const char* plan_extension{ ".sigplan" };
+	static constexpr const char* signal_controller_extension{ ".sig" };
+
+	/* Adds or replaces the controller's traffic light. Program zero is
+	the first program in the file. Negative positions keep the position of
+	the traffic light already in traffic_lights, if any. Returns false, and
+	changes nothing, if the file cannot be read or has no usable program,
+	with the reason written to std::clog. */
+	static bool from_file_to_objects(const std::string& full_address,
+		int program_id, double position,
+		std::unordered_map<int, TrafficLight>& traffic_lights);
+	/* Reads a signal plan file: a CSV file with one header line and one
+	.sig file per line:
+		.sig file (relative to the plan file's folder), program, position
+	Returns false if any of the files cannot be read. */
+	static bool from_plan_to_objects(const std::string& full_address,
+		std::unordered_map<int, TrafficLight>& traffic_lights);
+	/* True for .sig and signal plan files */
+	static bool is_signal_program_file(const std::string& file_name);
+	static bool is_signal_plan_file(const std::string& file_name) {
+		return ends_with(file_name, plan_extension);
+	};
+
+private:
+	struct Tag {
+		std::string_view name;
+		/* Text between the name and the end of the tag */
+		std::string_view attributes;
+		bool is_closing{ false };
+		bool is_self_closing{ false };
+	};
+
+	/* Moves the cursor past the next element tag, skipping declarations,
+	comments and text. Returns false at the end of the file or if a tag is
+	not closed. */
+	static bool next_tag(const char*& cursor, const char* end, Tag& tag);
+	/* Empty if the tag does not have the attribute */
+	static std::string_view find_attribute(std::string_view attributes,
+		std::string_view name);
+	/* Returns false if the tag does not have the attribute or it is not
+	a number */
+	template <typename Number>
+	static bool read_attribute(const Tag& tag, std::string_view name,
+		Number& value);
+	static bool ends_with(const std::string& text, const char* suffix);
+};
@@ -10,9 +10,13 @@
 #include <iostream>
 #include <fstream>
 
+#include "AllocationCounter.h"
+#include "MappedFile.h"
 #include "SimulationLogger.h"
 
 void SimulationLogger::create_log_file() {
+	AllocationCounter::Scope scope{
+		AllocationCounter::Subsystem::logging };
 	/* clog writes to stderr, so that's the destination we change
 	Note that cerr will write to that file too. If we want to write error
 	to a different file, use the method writeToErrorLog */
@@ -35,11 +39,23 @@ void SimulationLogger::create_log_file() {
 }
 
 void SimulationLogger::write_to_persistent_log(std::string& message) {
+	AllocationCounter::Scope scope{
+		AllocationCounter::Subsystem::logging };
 	if (persistent_log.is_open()) {
 		persistent_log << message << std::endl;
 	}
 }
 
+bool SimulationLogger::open_results_file(std::ofstream& file,
+	const char* file_name, const std::string& header)
+{
+	bool is_new_file = MappedFile::get_attributes(file_name).size == 0;
+	file.open(file_name, std::ios::app);
+	if (!file.is_open()) return false;
+	if (is_new_file) file << "run, " << header << "\n";
+	return true;
+}
+
 void SimulationLogger::write_to_error_log(std::string& message) {
 	std::streambuf* error_buffer = std::cerr.rdbuf(); /* save the default 
 													  error buffer to restore
@@ -19,6 +19,12 @@ public:
 	void create_log_file();
 
 	void write_to_persistent_log(std::string& message);
+
+	/* Opens a results file (e.g., KPIs per cycle) for appending, so that
+	the results of earlier runs and sessions are kept, and writes the header
+	line if the file is new. The rows should start with the run id. */
+	static bool open_results_file(std::ofstream& file, const char* file_name,
+		const std::string& header);
 	
 	/* Sets the output of cerr to a specific "error_log" file to make it 
 	separate from the log used for behavior checking, and writes the error 
@@ -0,0 +1,233 @@
+#include <algorithm>
+#include <cmath>
+
+#include "SpatialHash.h"
+
+SpatialHash::OrientedBox SpatialHash::OrientedBox::from_entry(
+	const Entry& entry, double margin)
+{
+	OrientedBox box;
+	double dx = entry.front_x - entry.rear_x;
+	double dy = entry.front_y - entry.rear_y;
+	double length = std::sqrt(dx * dx + dy * dy);
+	box.center_x = (entry.front_x + entry.rear_x) / 2.0;
+	box.center_y = (entry.front_y + entry.rear_y) / 2.0;
+	if (length > 0.0)
+	{
+		box.direction_x = dx / length;
+		box.direction_y = dy / length;
+	}
+	box.half_length = length / 2.0 + margin;
+	box.half_width = entry.width / 2.0 + margin;
+	return box;
+}
+
+bool SpatialHash::OrientedBox::intersects(const OrientedBox& other) const
+{
+	/* Separating axis test on the sides of both boxes */
+	double center_dx = other.center_x - center_x;
+	double center_dy = other.center_y - center_y;
+	const OrientedBox* boxes[2] = { this, &other };
+	for (const OrientedBox* axis_box : boxes)
+	{
+		for (int side = 0; side < 2; side++)
+		{
+			double axis_x = side == 0 ?
+				axis_box->direction_x : -axis_box->direction_y;
+			double axis_y = side == 0 ?
+				axis_box->direction_y : axis_box->direction_x;
+			double projected_radii = 0.0;
+			for (const OrientedBox* box : boxes)
+			{
+				double along = box->direction_x * axis_x
+					+ box->direction_y * axis_y;
+				double across = -box->direction_y * axis_x
+					+ box->direction_x * axis_y;
+				projected_radii += box->half_length * std::abs(along)
+					+ box->half_width * std::abs(across);
+			}
+			if (std::abs(center_dx * axis_x + center_dy * axis_y)
+				> projected_radii) return false;
+		}
+	}
+	return true;
+}
+
+double SpatialHash::OrientedBox::distance_to_point(double x,
+	double y) const
+{
+	double dx = x - center_x;
+	double dy = y - center_y;
+	double outside_length = std::max(
+		std::abs(dx * direction_x + dy * direction_y) - half_length, 0.0);
+	double outside_width = std::max(
+		std::abs(-dx * direction_y + dy * direction_x) - half_width, 0.0);
+	return std::sqrt(outside_length * outside_length
+		+ outside_width * outside_width);
+}
+
+SpatialHash::SpatialHash(double cell_size) :
+	cell_size{ cell_size } {}
+
+void SpatialHash::add(const Entry& entry)
+{
+	pending_items.push_back(make_item(entry));
+	const OrientedBox& box = pending_items.back().box;
+	pending_max_item_extent = std::max(pending_max_item_extent,
+		std::sqrt(box.half_length * box.half_length
+			+ box.half_width * box.half_width));
+}
+
+void SpatialHash::start_step(double time)
+{
+	if (time == current_time) return;
+	current_time = time;
+
+	items.swap(pending_items);
+	pending_items.clear();
+	max_item_extent = pending_max_item_extent;
+	pending_max_item_extent = 0.0;
+
+	/* Counting sort by bucket. The number of buckets follows the number of
+	vehicles, so that most buckets hold one cell. */
+	size_t n_buckets = 1;
+	while (n_buckets < items.size()) n_buckets <<= 1;
+	bucket_mask = n_buckets - 1;
+	bucket_starts.assign(n_buckets + 1, 0);
+	item_buckets.resize(items.size());
+	for (size_t i = 0; i < items.size(); i++)
+	{
+		item_buckets[i] = static_cast<uint32_t>(
+			to_bucket(items[i].cell_x, items[i].cell_y));
+		bucket_starts[item_buckets[i]]++;
+	}
+	for (size_t b = 1; b < n_buckets; b++)
+	{
+		bucket_starts[b] += bucket_starts[b - 1];
+	}
+	/* Each bucket now holds its end; filling it backwards leaves its
+	start */
+	sorted_items.resize(items.size());
+	for (size_t i = items.size(); i-- > 0;)
+	{
+		sorted_items[--bucket_starts[item_buckets[i]]] =
+			static_cast<uint32_t>(i);
+	}
+	bucket_starts[n_buckets] = static_cast<uint32_t>(items.size());
+}
+
+void SpatialHash::clear()
+{
+	items.clear();
+	sorted_items.clear();
+	bucket_starts.clear();
+	item_buckets.clear();
+	bucket_mask = 0;
+	max_item_extent = 0.0;
+	pending_items.clear();
+	pending_max_item_extent = 0.0;
+	current_time = -1.0;
+}
+
+SpatialHash::Item SpatialHash::make_item(const Entry& entry) const
+{
+	Item item;
+	item.entry = entry;
+	item.box = OrientedBox::from_entry(entry, 0.0);
+	item.cell_x = to_cell(item.box.center_x);
+	item.cell_y = to_cell(item.box.center_y);
+	return item;
+}
+
+int32_t SpatialHash::to_cell(double coordinate) const
+{
+	return static_cast<int32_t>(std::floor(coordinate / cell_size));
+}
+
+size_t SpatialHash::to_bucket(int32_t cell_x, int32_t cell_y) const
+{
+	uint64_t hash = static_cast<uint64_t>(static_cast<uint32_t>(cell_x))
+		* 73856093u
+		^ static_cast<uint64_t>(static_cast<uint32_t>(cell_y)) * 19349663u;
+	return static_cast<size_t>(hash) & bucket_mask;
+}
+
+template <typename Function>
+void SpatialHash::for_each_near(double x, double y, double reach,
+	Function function) const
+{
+	if (items.empty()) return;
+	int32_t first_x = to_cell(x - reach);
+	int32_t last_x = to_cell(x + reach);
+	int32_t first_y = to_cell(y - reach);
+	int32_t last_y = to_cell(y + reach);
+	for (int32_t cell_x = first_x; cell_x <= last_x; cell_x++)
+	{
+		for (int32_t cell_y = first_y; cell_y <= last_y; cell_y++)
+		{
+			size_t bucket = to_bucket(cell_x, cell_y);
+			for (uint32_t i = bucket_starts[bucket];
+				i < bucket_starts[bucket + 1]; i++)
+			{
+				const Item& item = items[sorted_items[i]];
+				if (item.cell_x == cell_x && item.cell_y == cell_y)
+				{
+					function(item);
+				}
+			}
+		}
+	}
+}
+
+void SpatialHash::find_in_radius(double x, double y, double radius,
+	std::vector<const Entry*>& found) const
+{
+	for_each_near(x, y, radius + max_item_extent,
+		[&](const Item& item) {
+			if (item.box.distance_to_point(x, y) <= radius)
+			{
+				found.push_back(&item.entry);
+			}
+		});
+}
+
+void SpatialHash::find_in_box(const OrientedBox& box,
+	std::vector<const Entry*>& found) const
+{
+	double box_extent = std::sqrt(box.half_length * box.half_length
+		+ box.half_width * box.half_width);
+	for_each_near(box.center_x, box.center_y,
+		box_extent + max_item_extent,
+		[&](const Item& item) {
+			if (box.intersects(item.box)) found.push_back(&item.entry);
+		});
+}
+
+void SpatialHash::find_conflicts(double margin,
+	std::vector<std::pair<long, long>>& conflicts) const
+{
+	for (const Item& item : items)
+	{
+		OrientedBox box = item.box;
+		box.half_length += margin;
+		box.half_width += margin;
+		double box_extent = std::sqrt(box.half_length * box.half_length
+			+ box.half_width * box.half_width);
+		/* The margin moves the corners of the other item up to
+		sqrt(2) * margin further from its center */
+		for_each_near(box.center_x, box.center_y,
+			box_extent + max_item_extent + std::sqrt(2.0) * margin,
+			[&](const Item& other) {
+				if (other.entry.id <= item.entry.id
+					|| other.entry.link == item.entry.link) return;
+				OrientedBox other_box = other.box;
+				other_box.half_length += margin;
+				other_box.half_width += margin;
+				if (box.intersects(other_box))
+				{
+					conflicts.push_back(std::make_pair(item.entry.id,
+						other.entry.id));
+				}
+			});
+	}
+}
@@ -0,0 +1,113 @@
+/*==========================================================================*/
+/*  SpatialHash.h															*/
+/*  Uniform grid of vehicle footprints for proximity and conflict queries	*/
+/*                                                                          */
+/*  Version of 2022-06	                              Fernando V. Monteiro  */
+/*==========================================================================*/
+
+#pragma once
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+/* Vehicle footprints (rectangles from the rear to the front coordinates
+sent by VISSIM) in a uniform grid of square cells. Cells are hashed into a
+table with a power of two number of buckets, so the grid covers any
+network without being sized beforehand. Lane data only shows vehicles on
+the same and adjacent lanes; the grid also finds vehicles on crossing links,
+e.g., inside a signalized intersection.
+
+The grid is rebuilt at every step, in time proportional to the number of
+vehicles: footprints are computed as vehicles are added, and only their
+indices are sorted by bucket (counting sort), into arrays that keep their
+memory from one step to the next. As in LaneVehicleIndex, vehicles
+added during a step become visible at the next call to start_step, so
+queries see all vehicles as they were in the previous step. Vehicles that
+were not added in a step are no longer in the grid. Not thread safe. */
+class SpatialHash
+{
+public:
+	struct Entry {
+		long id{ 0 };
+		long link{ 0 };
+		double front_x{ 0.0 }; // [m]
+		double front_y{ 0.0 }; // [m]
+		double rear_x{ 0.0 }; // [m]
+		double rear_y{ 0.0 }; // [m]
+		double width{ 0.0 }; // [m]
+	};
+	/* Rectangle with sides parallel to (direction_x, direction_y), a unit
+	vector, and to its normal */
+	struct OrientedBox {
+		double center_x{ 0.0 }; // [m]
+		double center_y{ 0.0 }; // [m]
+		double direction_x{ 1.0 };
+		double direction_y{ 0.0 };
+		double half_length{ 0.0 }; // [m]
+		double half_width{ 0.0 }; // [m]
+
+		/* Footprint of the vehicle enlarged by margin on all sides */
+		static OrientedBox from_entry(const Entry& entry, double margin);
+		bool intersects(const OrientedBox& other) const;
+		double distance_to_point(double x, double y) const;
+	};
+
+	explicit SpatialHash(double cell_size);
+
+	/* Records the footprint of the vehicle in the current step */
+	void add(const Entry& entry);
+	/* Must be called when the simulation time changes. Rebuilds the grid
+	with the vehicles added in the previous step. */
+	void start_step(double time);
+	/* Discards all vehicles (new simulation run) */
+	void clear();
+
+	/* Appends to found the vehicles whose footprint is within radius of
+	the point */
+	void find_in_radius(double x, double y, double radius,
+		std::vector<const Entry*>& found) const;
+	/* Appends to found the vehicles whose footprint intersects the box */
+	void find_in_box(const OrientedBox& box,
+		std::vector<const Entry*>& found) const;
+	/* Appends to conflicts the pairs of vehicles on different links whose
+	footprints, enlarged by margin, intersect. Each pair appears once, the
+	smaller id first. */
+	void find_conflicts(double margin,
+		std::vector<std::pair<long, long>>& conflicts) const;
+	size_t size() const { return items.size(); };
+
+private:
+	struct Item {
+		Entry entry;
+		OrientedBox box;
+		int32_t cell_x{ 0 };
+		int32_t cell_y{ 0 };
+	};
+
+	Item make_item(const Entry& entry) const;
+	int32_t to_cell(double coordinate) const;
+	size_t to_bucket(int32_t cell_x, int32_t cell_y) const;
+	/* Calls function(item) for the items in the cells that overlap the
+	square of half side reach around the point. Items are in the cell of
+	their center, so reach must include the extent of the items. */
+	template <typename Function>
+	void for_each_near(double x, double y, double reach,
+		Function function) const;
+
+	double cell_size{ 10.0 }; // [m]
+	/* Visible to queries, in the order they were added */
+	std::vector<Item> items;
+	/* Indices of the items sorted by bucket: the items of bucket b are
+	sorted_items[bucket_starts[b]] to sorted_items[bucket_starts[b + 1] - 1] */
+	std::vector<uint32_t> sorted_items;
+	std::vector<uint32_t> bucket_starts;
+	std::vector<uint32_t> item_buckets;
+	size_t bucket_mask{ 0 };
+	/* Largest distance from the center of an item to its corners [m] */
+	double max_item_extent{ 0.0 };
+	/* Added in the current step */
+	std::vector<Item> pending_items;
+	double pending_max_item_extent{ 0.0 };
+	double current_time{ -1.0 };
+};
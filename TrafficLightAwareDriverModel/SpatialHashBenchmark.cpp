@@ -0,0 +1,180 @@
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <random>
+
+#include "SpatialHashBenchmark.h"
+
+bool SpatialHashBenchmark::run_all(const std::string& results_file_name)
+{
+	std::ofstream results_file(results_file_name);
+	if (!results_file.is_open())
+	{
+		std::clog << "Unable to open the benchmark results file "
+			<< results_file_name << std::endl;
+		return false;
+	}
+	results_file << "vehicles, steps, build [ms per step], "
+		<< "conflict search [ms per step], radius query [ns], "
+		<< "conflicts per step, vehicles per radius query" << std::endl;
+
+	for (long n_vehicles : { 1000, 10000, 50000 })
+	{
+		Result result = run(n_vehicles);
+		results_file << result.n_vehicles
+			<< ", " << result.n_steps
+			<< ", " << result.build_ms_per_step
+			<< ", " << result.conflicts_ms_per_step
+			<< ", " << result.ns_per_radius_query
+			<< ", " << result.conflicts_per_step
+			<< ", " << result.vehicles_per_radius_query << std::endl;
+		std::clog << "Spatial hash benchmark: "
+			<< result.n_vehicles << " veh. -> build "
+			<< result.build_ms_per_step << " ms, conflicts "
+			<< result.conflicts_ms_per_step << " ms, radius query "
+			<< result.ns_per_radius_query << " ns" << std::endl;
+	}
+	return true;
+}
+
+SpatialHashBenchmark::Result SpatialHashBenchmark::run(long n_vehicles)
+{
+	double network_length = 0.0;
+	std::vector<StreetVehicle> fleet = create_fleet(n_vehicles, 1,
+		network_length);
+	SpatialHash spatial_hash{ cell_size };
+	std::vector<std::pair<long, long>> conflicts;
+	std::vector<const SpatialHash::Entry*> found;
+
+	std::chrono::steady_clock::duration build_time{ 0 };
+	std::chrono::steady_clock::duration conflicts_time{ 0 };
+	std::chrono::steady_clock::duration query_time{ 0 };
+	long n_conflicts = 0;
+	long n_found = 0;
+	for (long step = 0; step < n_warm_up_steps + n_measured_steps; step++)
+	{
+		for (StreetVehicle& vehicle : fleet)
+		{
+			vehicle.position += vehicle.direction * vehicle.velocity
+				* time_step;
+			if (vehicle.position > network_length)
+			{
+				vehicle.position -= network_length;
+			}
+			else if (vehicle.position < 0.0)
+			{
+				vehicle.position += network_length;
+			}
+		}
+
+		std::chrono::steady_clock::time_point start =
+			std::chrono::steady_clock::now();
+		for (size_t i = 0; i < fleet.size(); i++)
+		{
+			spatial_hash.add(to_entry(static_cast<long>(i) + 1, fleet[i]));
+		}
+		spatial_hash.start_step(step * time_step);
+		std::chrono::steady_clock::time_point built =
+			std::chrono::steady_clock::now();
+		conflicts.clear();
+		spatial_hash.find_conflicts(conflict_margin, conflicts);
+		std::chrono::steady_clock::time_point searched =
+			std::chrono::steady_clock::now();
+		long n_found_in_step = 0;
+		for (size_t i = 0; i < fleet.size(); i++)
+		{
+			SpatialHash::Entry entry = to_entry(static_cast<long>(i) + 1,
+				fleet[i]);
+			found.clear();
+			spatial_hash.find_in_radius(entry.front_x, entry.front_y,
+				query_radius, found);
+			n_found_in_step += static_cast<long>(found.size());
+		}
+		std::chrono::steady_clock::time_point queried =
+			std::chrono::steady_clock::now();
+
+		if (step >= n_warm_up_steps)
+		{
+			build_time += built - start;
+			conflicts_time += searched - built;
+			query_time += queried - searched;
+			n_conflicts += static_cast<long>(conflicts.size());
+			n_found += n_found_in_step;
+		}
+	}
+
+	double n_queries = double(n_vehicles) * n_measured_steps;
+	Result result;
+	result.n_vehicles = n_vehicles;
+	result.n_steps = n_measured_steps;
+	result.build_ms_per_step = std::chrono::duration_cast<
+		std::chrono::microseconds>(build_time).count()
+		/ 1000.0 / n_measured_steps;
+	result.conflicts_ms_per_step = std::chrono::duration_cast<
+		std::chrono::microseconds>(conflicts_time).count()
+		/ 1000.0 / n_measured_steps;
+	result.ns_per_radius_query = std::chrono::duration_cast<
+		std::chrono::nanoseconds>(query_time).count() / n_queries;
+	result.conflicts_per_step = double(n_conflicts) / n_measured_steps;
+	result.vehicles_per_radius_query = n_found / n_queries;
+	return result;
+}
+
+std::vector<SpatialHashBenchmark::StreetVehicle>
+SpatialHashBenchmark::create_fleet(long n_vehicles, unsigned int seed,
+	double& network_length) const
+{
+	/* n_streets streets along each axis, each with one lane per
+	direction, all network_length long */
+	long n_streets = static_cast<long>(std::ceil(std::sqrt(
+		n_vehicles * vehicle_spacing / (4.0 * block_length))));
+	network_length = n_streets * block_length;
+
+	std::mt19937 generator{ seed };
+	std::uniform_real_distribution<double> uniform{ 0.0, 1.0 };
+	std::vector<StreetVehicle> fleet;
+	for (long i = 0; i < n_vehicles; i++)
+	{
+		long street = static_cast<long>(uniform(generator) * n_streets);
+		StreetVehicle vehicle;
+		vehicle.is_along_x = uniform(generator) < 0.5;
+		vehicle.direction = uniform(generator) < 0.5 ? 1.0 : -1.0;
+		/* Vehicles drive on the right */
+		vehicle.lane_offset = street * block_length
+			- vehicle.direction * lane_width / 2.0;
+		/* One link per street, axis and direction */
+		vehicle.link = 4 * street + (vehicle.is_along_x ? 0 : 2)
+			+ (vehicle.direction > 0 ? 0 : 1) + 1;
+		vehicle.position = uniform(generator) * network_length;
+		vehicle.velocity = 15.0 * uniform(generator);
+		fleet.push_back(vehicle);
+	}
+	return fleet;
+}
+
+SpatialHash::Entry SpatialHashBenchmark::to_entry(long id,
+	const StreetVehicle& vehicle) const
+{
+	double rear_position = vehicle.position
+		- vehicle.direction * vehicle_length;
+	SpatialHash::Entry entry;
+	entry.id = id;
+	entry.link = vehicle.link;
+	entry.width = vehicle_width;
+	if (vehicle.is_along_x)
+	{
+		entry.front_x = vehicle.position;
+		entry.front_y = vehicle.lane_offset;
+		entry.rear_x = rear_position;
+		entry.rear_y = vehicle.lane_offset;
+	}
+	else
+	{
+		entry.front_x = vehicle.lane_offset;
+		entry.front_y = vehicle.position;
+		entry.rear_x = vehicle.lane_offset;
+		entry.rear_y = rear_position;
+	}
+	return entry;
+}
@@ -0,0 +1,66 @@
+/*==========================================================================*/
+/*  SpatialHashBenchmark.h													*/
+/*  Measures the cost of the spatial hash on large street grids			*/
+/*                                                                          */
+/*  Version of 2022-06	                              Fernando V. Monteiro  */
+/*==========================================================================*/
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "SpatialHash.h"
+
+/* Places vehicles on a square grid of two-way streets, sized so that
+vehicles are on average vehicle_spacing apart on each lane, and moves them
+along their lanes. Every step, as in the DLL, all vehicles are added and
+the grid is rebuilt; then conflicts between vehicles on crossing streets
+are searched, and each vehicle makes one radius query. The time of each
+part is measured separately. */
+class SpatialHashBenchmark
+{
+public:
+	struct Result {
+		long n_vehicles{ 0 };
+		long n_steps{ 0 };
+		double build_ms_per_step{ 0.0 };
+		double conflicts_ms_per_step{ 0.0 };
+		double ns_per_radius_query{ 0.0 };
+		double conflicts_per_step{ 0.0 };
+		double vehicles_per_radius_query{ 0.0 };
+	};
+
+	/* Runs all fleet sizes and writes one line per run to the results
+	file. Returns false if the results file cannot be opened. */
+	bool run_all(const std::string& results_file_name);
+	Result run(long n_vehicles);
+
+private:
+	struct StreetVehicle {
+		long link{ 0 };
+		bool is_along_x{ true };
+		/* Coordinate of the lane's center line across the street [m] */
+		double lane_offset{ 0.0 };
+		double direction{ 1.0 }; // +1 or -1
+		double position{ 0.0 }; // front end along the street [m]
+		double velocity{ 0.0 }; // [m/s]
+	};
+
+	const double time_step{ 0.1 }; // [s]
+	const long n_warm_up_steps{ 5 };
+	const long n_measured_steps{ 50 };
+	const double cell_size{ 10.0 }; // [m]
+	const double block_length{ 150.0 }; // [m]
+	const double vehicle_spacing{ 25.0 }; // [m]
+	const double lane_width{ 3.5 }; // [m]
+	const double vehicle_length{ 4.5 }; // [m]
+	const double vehicle_width{ 1.8 }; // [m]
+	/* Small enough for vehicles in opposite lanes not to conflict */
+	const double conflict_margin{ 0.5 }; // [m]
+	const double query_radius{ 20.0 }; // [m]
+
+	std::vector<StreetVehicle> create_fleet(long n_vehicles,
+		unsigned int seed, double& network_length) const;
+	SpatialHash::Entry to_entry(long id, const StreetVehicle& vehicle) const;
+};
@@ -0,0 +1,64 @@
+#include <iostream>
+
+#include "AllocationCounter.h"
+#include "StepInputRecorder.h"
+
+StepInputRecorder::~StepInputRecorder()
+{
+	flush();
+	if (input_file != nullptr) fclose(input_file);
+}
+
+void StepInputRecorder::start()
+{
+	if (is_recording()) return;
+
+	AllocationCounter::Scope scope{
+		AllocationCounter::Subsystem::logging };
+	fopen_s(&input_file, input_file_name, "wb");
+	if (input_file == nullptr)
+	{
+		std::clog << "Unable to open the step inputs file." << std::endl;
+		return;
+	}
+	FileHeader header;
+	fwrite(&header, sizeof(header), 1, input_file);
+	buffer.reserve(buffer_size);
+}
+
+void StepInputRecorder::record_set_value(long type, long index1, long index2,
+	long long_value, double double_value)
+{
+	add_record(Kind::set_value, type, index1, index2, long_value,
+		double_value);
+}
+
+void StepInputRecorder::record_command(long number)
+{
+	add_record(Kind::command, number, 0, 0, 0, 0.0);
+}
+
+void StepInputRecorder::add_record(Kind kind, long type, long index1,
+	long index2, long long_value, double double_value)
+{
+	if (!is_recording()) return;
+
+	AllocationCounter::Scope scope{
+		AllocationCounter::Subsystem::logging };
+	InputRecord record;
+	record.kind = static_cast<uint8_t>(kind);
+	record.type = static_cast<int32_t>(type);
+	record.index1 = static_cast<int32_t>(index1);
+	record.index2 = static_cast<int32_t>(index2);
+	record.long_value = static_cast<int32_t>(long_value);
+	record.double_value = double_value;
+	buffer.push_back(record);
+	if (buffer.size() >= buffer_size) flush();
+}
+
+void StepInputRecorder::flush()
+{
+	if (input_file == nullptr || buffer.empty()) return;
+	fwrite(buffer.data(), sizeof(InputRecord), buffer.size(), input_file);
+	buffer.clear();
+}
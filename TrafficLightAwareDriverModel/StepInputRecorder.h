@@ -0,0 +1,69 @@
+/*==========================================================================*/
+/*  StepInputRecorder.h														*/
+/*  Binary recording of the data VISSIM sends to the DLL					*/
+/*                                                                          */
+/*  Version of 2022-06	                              Fernando V. Monteiro  */
+/*==========================================================================*/
+
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+/* Writes one fixed size binary record per call to DriverModelSetValue
+(except string values) and DriverModelExecuteCommand, in the order in which
+VISSIM makes the calls. The recorded file can be replayed offline by
+StepInputReplayer.
+
+File layout: a FileHeader followed by InputRecord entries, all little
+endian and without padding. */
+class StepInputRecorder
+{
+public:
+	enum class Kind : uint8_t {
+		set_value,
+		command,
+	};
+
+#pragma pack(push, 1)
+	struct InputRecord {
+		uint8_t kind; // Kind
+		int32_t type; // data type or command number
+		int32_t index1;
+		int32_t index2;
+		int32_t long_value;
+		double double_value;
+	};
+	struct FileHeader {
+		char magic[4]{ 'T', 'L', 'S', 'I' };
+		uint16_t version{ 1 };
+		uint16_t record_size{ sizeof(InputRecord) };
+	};
+#pragma pack(pop)
+
+	StepInputRecorder() = default;
+	/* Records to another file than step_inputs.bin */
+	explicit StepInputRecorder(const char* input_file_name) :
+		input_file_name{ input_file_name } {}
+	~StepInputRecorder();
+
+	/* Opens the input file. Calls are only recorded after this call. */
+	void start();
+	bool is_recording() const { return input_file != nullptr; };
+	void record_set_value(long type, long index1, long index2,
+		long long_value, double double_value);
+	void record_command(long number);
+	/* Writes buffered records to the file */
+	void flush();
+
+private:
+	static const size_t buffer_size{ 65536 }; // records
+
+	void add_record(Kind kind, long type, long index1, long index2,
+		long long_value, double double_value);
+
+	std::vector<InputRecord> buffer;
+	FILE* input_file{ nullptr };
+	const char* input_file_name{ "step_inputs.bin" };
+};
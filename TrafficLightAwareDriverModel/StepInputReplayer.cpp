@@ -0,0 +1,377 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <iostream>
+#include <limits>
+
+#include "DriverModel.h"
+#include "EgoVehicleFactory.h"
+#include "StepInputReplayer.h"
+#include "VehicleInput.h"
+
+StepInputReplayer::StepInputReplayer(
+	const std::unordered_map<int, TrafficLight>& traffic_lights,
+	const std::string& network_file_name, size_t n_threads,
+	bool use_v2v_board, bool compare_full_rate) :
+	traffic_lights{ traffic_lights },
+	use_v2v_board{ use_v2v_board },
+	compare_full_rate{ compare_full_rate },
+	thread_pool{ n_threads }
+{
+	if (!network_file_name.empty()) signal_graph.load(network_file_name);
+}
+
+long StepInputReplayer::replay(const std::string& input_file_name,
+	const std::string& output_file_name)
+{
+	FILE* input_file{ nullptr };
+	fopen_s(&input_file, input_file_name.c_str(), "rb");
+	if (input_file == nullptr)
+	{
+		std::clog << "Unable to open the step inputs file "
+			<< input_file_name << std::endl;
+		return -1;
+	}
+	StepInputRecorder::FileHeader expected_header;
+	StepInputRecorder::FileHeader header;
+	if (fread(&header, sizeof(header), 1, input_file) != 1
+		|| std::string(header.magic, 4)
+		!= std::string(expected_header.magic, 4)
+		|| header.version != expected_header.version
+		|| header.record_size != sizeof(InputRecord))
+	{
+		std::clog << input_file_name << " is not a step inputs file."
+			<< std::endl;
+		fclose(input_file);
+		return -1;
+	}
+
+	std::ofstream output_file(output_file_name);
+	if (!output_file.is_open())
+	{
+		std::clog << "Unable to open the replay output file "
+			<< output_file_name << std::endl;
+		fclose(input_file);
+		return -1;
+	}
+	output_file.precision(std::numeric_limits<double>::max_digits10);
+	output_file << "time, id, desired acceleration, "
+		<< "lane change direction";
+	if (compare_full_rate) output_file << ", full rate desired acceleration";
+	output_file << "\n";
+
+	std::vector<InputRecord> buffer(65536);
+	size_t n_read;
+	while ((n_read = fread(buffer.data(), sizeof(InputRecord),
+		buffer.size(), input_file)) > 0)
+	{
+		for (size_t i = 0; i < n_read; i++)
+		{
+			const InputRecord& record = buffer[i];
+			if (record.kind == static_cast<uint8_t>(
+				StepInputRecorder::Kind::set_value)
+				&& record.type == DRIVER_DATA_TIME
+				&& has_pending_step
+				&& record.double_value != current_time)
+			{
+				evaluate_step(output_file);
+			}
+			else if (record.kind == static_cast<uint8_t>(
+				StepInputRecorder::Kind::command)
+				&& record.type == DRIVER_COMMAND_INIT
+				&& !tasks.empty())
+			{
+				/* A new run starting at the time the last one stopped */
+				evaluate_step(output_file);
+			}
+			read_record(record);
+		}
+	}
+	if (has_pending_step) evaluate_step(output_file);
+	fclose(input_file);
+	return n_steps;
+}
+
+void StepInputReplayer::read_record(const InputRecord& record)
+{
+	if (record.kind == static_cast<uint8_t>(
+		StepInputRecorder::Kind::command))
+	{
+		switch (record.type)
+		{
+		case DRIVER_COMMAND_INIT:
+			start_new_run();
+			/* The time of the new run has already been read */
+			has_pending_step = true;
+			break;
+		case DRIVER_COMMAND_CREATE_DRIVER:
+		{
+			vehicles[current_vehicle_id] =
+				EgoVehicleFactory::create_ego_vehicle(current_vehicle_id,
+					current_vehicle_type, current_desired_velocity,
+					simulation_time_step, current_time, false);
+			EgoVehicle* vehicle = vehicles[current_vehicle_id].get();
+			if (use_v2v_board && vehicle != nullptr)
+			{
+				vehicle->connect_to_v2v_board(&v2v_board);
+			}
+			if (!signal_graph.empty() && vehicle != nullptr)
+			{
+				vehicle->connect_to_signal_graph(&signal_graph);
+			}
+			if (compare_full_rate && vehicle != nullptr)
+			{
+				full_rate_vehicles[current_vehicle_id] =
+					EgoVehicleFactory::create_ego_vehicle(current_vehicle_id,
+						current_vehicle_type, current_desired_velocity,
+						simulation_time_step, current_time, false);
+				EgoVehicle* twin = full_rate_vehicles[current_vehicle_id].get();
+				twin->set_full_rate_control();
+				if (use_v2v_board)
+				{
+					twin->connect_to_v2v_board(&full_rate_v2v_board);
+				}
+				if (!signal_graph.empty())
+				{
+					twin->connect_to_signal_graph(&signal_graph);
+				}
+			}
+			current_vehicle_id = 0;
+			current_task_index = -1;
+			break;
+		}
+		case DRIVER_COMMAND_KILL_DRIVER:
+			/* The vehicle may still have inputs to process in this step */
+			killed_vehicles.push_back(current_vehicle_id);
+			break;
+		case DRIVER_COMMAND_MOVE_DRIVER:
+			add_to_vehicle_task(record);
+			break;
+		default:
+			break;
+		}
+		return;
+	}
+
+	switch (record.type)
+	{
+	case DRIVER_DATA_TIMESTEP:
+		simulation_time_step = record.double_value;
+		break;
+	case DRIVER_DATA_TIME:
+		/* The step of the previous time has already been evaluated */
+		if (record.double_value < current_time) start_new_run();
+		current_time = record.double_value;
+		v2v_board.start_step(current_time);
+		full_rate_v2v_board.start_step(current_time);
+		has_pending_step = true;
+		break;
+	case DRIVER_DATA_VEH_ID:
+		current_vehicle_id = record.long_value;
+		start_vehicle_task(current_vehicle_id);
+		add_to_vehicle_task(record);
+		break;
+	case DRIVER_DATA_VEH_TYPE:
+		current_vehicle_type = record.long_value;
+		break;
+	case DRIVER_DATA_VEH_DESIRED_VELOCITY:
+		current_desired_velocity = record.double_value;
+		add_to_vehicle_task(record);
+		break;
+	case DRIVER_DATA_SIGNAL_STATE:
+		/* Signal states are the same for all vehicles of a time step */
+		traffic_lights[record.index1].set_current_state(record.long_value);
+		break;
+	case DRIVER_DATA_SIGNAL_STATE_START:
+		traffic_lights[record.index1].set_current_state_start_time(
+			record.double_value);
+		break;
+	default:
+		if (VehicleInput::is_vehicle_input(record.type))
+		{
+			add_to_vehicle_task(record);
+		}
+		break;
+	}
+}
+
+void StepInputReplayer::start_vehicle_task(long vehicle_id)
+{
+	auto vehicle_it = vehicles.find(vehicle_id);
+	if (vehicle_it == vehicles.end() || vehicle_it->second == nullptr)
+	{
+		/* The vehicle is about to be created */
+		current_task_index = -1;
+		return;
+	}
+	auto task_it = task_index_by_vehicle_id.find(vehicle_id);
+	if (task_it == task_index_by_vehicle_id.end())
+	{
+		task_it = task_index_by_vehicle_id.emplace(
+			vehicle_id, tasks.size()).first;
+		tasks.emplace_back();
+		tasks.back().vehicle = vehicle_it->second.get();
+		if (compare_full_rate)
+		{
+			tasks.back().full_rate_vehicle =
+				full_rate_vehicles[vehicle_id].get();
+		}
+	}
+	current_task_index = static_cast<long>(task_it->second);
+}
+
+void StepInputReplayer::add_to_vehicle_task(const InputRecord& record)
+{
+	if (current_task_index < 0) return;
+	tasks[current_task_index].records.push_back(record);
+}
+
+void StepInputReplayer::evaluate_step(std::ofstream& output_file)
+{
+	thread_pool.run(tasks.size(),
+		[this](size_t i) { evaluate_vehicle(tasks[i]); });
+	decide_lane_changes();
+	if (compare_full_rate) compare_accelerations();
+
+	for (const VehicleTask& task : tasks)
+	{
+		if (!task.was_moved) continue;
+		output_file << current_time
+			<< ", " << task.vehicle->get_id()
+			<< ", " << task.desired_acceleration
+			<< ", " << task.lane_change_direction;
+		if (compare_full_rate)
+		{
+			output_file << ", " << task.full_rate_acceleration;
+		}
+		output_file << "\n";
+	}
+
+	for (long vehicle_id : killed_vehicles)
+	{
+		vehicles.erase(vehicle_id);
+		full_rate_vehicles.erase(vehicle_id);
+	}
+	killed_vehicles.clear();
+	tasks.clear();
+	task_index_by_vehicle_id.clear();
+	current_task_index = -1;
+	has_pending_step = false;
+	n_steps++;
+}
+
+void StepInputReplayer::start_new_run()
+{
+	vehicles.clear();
+	v2v_board.clear();
+	full_rate_vehicles.clear();
+	full_rate_v2v_board.clear();
+	current_vehicle_id = 0;
+	current_task_index = -1;
+}
+
+void StepInputReplayer::decide_lane_changes()
+{
+	lane_change_gap_acceptance.clear();
+	for (const VehicleTask& task : tasks)
+	{
+		if (task.lane_change_direction == 0) continue;
+		lane_change_gap_acceptance.add_candidate(task.lane_change_candidate);
+	}
+	lane_change_gap_acceptance.evaluate();
+	size_t candidate_index = 0;
+	for (VehicleTask& task : tasks)
+	{
+		if (task.lane_change_direction == 0) continue;
+		if (!lane_change_gap_acceptance.is_accepted(candidate_index))
+		{
+			task.lane_change_direction = 0;
+		}
+		candidate_index++;
+	}
+}
+
+void StepInputReplayer::compare_accelerations()
+{
+	for (const VehicleTask& task : tasks)
+	{
+		if (!task.was_moved) continue;
+		double difference = task.desired_acceleration
+			- task.full_rate_acceleration;
+		double absolute_difference = std::abs(difference);
+		decimation_comparison.n_samples++;
+		if (absolute_difference > acceleration_tolerance)
+		{
+			decimation_comparison.n_different++;
+			if (difference > 0) decimation_comparison.n_larger++;
+		}
+		decimation_comparison.sum_absolute_difference += absolute_difference;
+		decimation_comparison.sum_squared_difference +=
+			difference * difference;
+		decimation_comparison.max_absolute_difference = std::max(
+			decimation_comparison.max_absolute_difference,
+			absolute_difference);
+	}
+}
+
+void StepInputReplayer::evaluate_vehicle(VehicleTask& task)
+{
+	task.desired_acceleration = apply_records(*task.vehicle, task.records,
+		&task);
+	if (task.full_rate_vehicle != nullptr)
+	{
+		/* The twin's lane change decisions are not used */
+		task.full_rate_acceleration = apply_records(*task.full_rate_vehicle,
+			task.records, nullptr);
+	}
+}
+
+double StepInputReplayer::apply_records(EgoVehicle& ego_vehicle,
+	const std::vector<InputRecord>& records, VehicleTask* task)
+{
+	double desired_acceleration{ 0.0 };
+	VehicleInput vehicle_input;
+	vehicle_input.set_ego_vehicle(&ego_vehicle);
+	for (const InputRecord& record : records)
+	{
+		if (record.kind == static_cast<uint8_t>(
+			StepInputRecorder::Kind::command))
+		{
+			/* DRIVER_COMMAND_MOVE_DRIVER followed by the GetValue calls
+			for the vehicle's decisions, as in DriverModel */
+			ego_vehicle.update_state();
+			ego_vehicle.analyze_nearby_vehicles();
+			desired_acceleration =
+				ego_vehicle.get_desired_acceleration(traffic_lights);
+			long lane_change_direction =
+				ego_vehicle.get_desired_lane_change_direction();
+			if (task != nullptr)
+			{
+				task->lane_change_direction = lane_change_direction;
+				if (lane_change_direction != 0)
+				{
+					task->lane_change_candidate =
+						ego_vehicle.get_lane_change_candidate();
+				}
+				task->was_moved = true;
+			}
+			ego_vehicle.clear_events();
+			continue;
+		}
+		switch (record.type)
+		{
+		case DRIVER_DATA_VEH_ID:
+			ego_vehicle.clear_nearby_vehicles();
+			vehicle_input.set_ego_vehicle(&ego_vehicle);
+			break;
+		case DRIVER_DATA_VEH_DESIRED_VELOCITY:
+			ego_vehicle.set_desired_velocity(record.double_value);
+			break;
+		default:
+			vehicle_input.set_value(record.type, record.index1,
+				record.index2, record.long_value, record.double_value);
+			break;
+		}
+	}
+	return desired_acceleration;
+}
@@ -0,0 +1,149 @@
+/*==========================================================================*/
+/*  StepInputReplayer.h														*/
+/*  Offline evaluation of the vehicles of a recorded simulation run		*/
+/*                                                                          */
+/*  Version of 2022-06	                              Fernando V. Monteiro  */
+/*==========================================================================*/
+
+#pragma once
+
+#include <fstream>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "EgoVehicle.h"
+#include "LaneChangeGapAcceptance.h"
+#include "SignalGraph.h"
+#include "StepInputRecorder.h"
+#include "TrafficLight.h"
+#include "V2VBoard.h"
+#include "WorkStealingThreadPool.h"
+
+/* Reads a file written by StepInputRecorder and rebuilds the vehicles the
+DLL had during the recorded run. Unlike VISSIM, which evaluates vehicles one
+by one, the replayer reads all the inputs of a time step first and then
+evaluates all vehicles of that step in parallel.
+
+Each step has two phases:
+1. Sequential: vehicle creation, signal states and the time are applied in
+the recorded order, and the remaining vehicle inputs are grouped per
+vehicle.
+2. Parallel: each vehicle applies its own inputs, updates its state and
+computes its desired acceleration and, if it intends to change lanes, its
+gaps on the target lane. Vehicles only read their own data and the
+(constant during the phase) traffic lights, so the results do not depend on
+the number of threads.
+The gaps of all vehicles that intend to change lanes are then accepted or
+rejected in one batch (see LaneChangeGapAcceptance), with the same decisions
+as EgoVehicle::decide_lane_change_direction.
+Killed vehicles are removed after the parallel phase. Results are written
+in the order in which VISSIM evaluated the vehicles.
+Connected followers only read the V2V messages of the previous step, since
+the order of evaluation within a step is not fixed. In the DLL, followers
+evaluated after their leaders read the leaders' messages of the same step,
+so the replayed decisions of connected vehicles can differ from the
+recorded run when USE_V2V_BOARD is set.
+
+With compare_full_rate, each vehicle has a twin that receives the same
+inputs but evaluates its controller every step (see ControlDecimation). The
+output then also has the twin's desired acceleration, and
+get_decimation_comparison summarizes the differences. Twins read their own
+V2V board, so connected twins follow full rate leaders. The replay is open
+loop: both vehicles see the recorded inputs, so differences do not
+accumulate as they would in a closed loop simulation. */
+class StepInputReplayer
+{
+public:
+	/* n_threads = 0 uses one thread per hardware core. Vehicles find the
+	traffic lights along their routes if the network file exists (see
+	SignalGraph); an empty name means no file. */
+	StepInputReplayer(
+		const std::unordered_map<int, TrafficLight>& traffic_lights,
+		const std::string& network_file_name, size_t n_threads,
+		bool use_v2v_board, bool compare_full_rate = false);
+
+	/* Differences between the desired accelerations of the vehicles and
+	of their full rate twins over all moved vehicles */
+	struct DecimationComparison {
+		long n_samples{ 0 };
+		/* Samples whose accelerations differ by more than the tolerance */
+		long n_different{ 0 };
+		/* Samples in which the decimated acceleration is the larger */
+		long n_larger{ 0 };
+		double sum_absolute_difference{ 0.0 }; // [m/s^2]
+		double sum_squared_difference{ 0.0 }; // [m^2/s^4]
+		double max_absolute_difference{ 0.0 }; // [m/s^2]
+	};
+	static constexpr double acceleration_tolerance{ 1e-6 }; // [m/s^2]
+
+	/* Returns the number of replayed time steps, or -1 if the input file
+	could not be read. */
+	long replay(const std::string& input_file_name,
+		const std::string& output_file_name);
+	const DecimationComparison& get_decimation_comparison() const {
+		return decimation_comparison;
+	};
+
+private:
+	using InputRecord = StepInputRecorder::InputRecord;
+
+	/* Everything one vehicle does in one time step */
+	struct VehicleTask {
+		EgoVehicle* vehicle{ nullptr };
+		/* Only with compare_full_rate */
+		EgoVehicle* full_rate_vehicle{ nullptr };
+		/* Inputs and DRIVER_COMMAND_MOVE_DRIVER commands, in order */
+		std::vector<InputRecord> records;
+		/* Outputs, set during evaluation */
+		double desired_acceleration{ 0.0 };
+		long lane_change_direction{ 0 };
+		double full_rate_acceleration{ 0.0 };
+		bool was_moved{ false };
+		/* Only valid if lane_change_direction is not zero before the
+		batched gap acceptance */
+		LaneChangeGapAcceptance::Candidate lane_change_candidate;
+	};
+
+	void read_record(const InputRecord& record);
+	void start_vehicle_task(long vehicle_id);
+	void add_to_vehicle_task(const InputRecord& record);
+	void evaluate_step(std::ofstream& output_file);
+	void evaluate_vehicle(VehicleTask& task);
+	/* Applies the task's records to the vehicle and returns its desired
+	acceleration at the last move */
+	double apply_records(EgoVehicle& ego_vehicle,
+		const std::vector<InputRecord>& records, VehicleTask* task);
+	void compare_accelerations();
+	void decide_lane_changes();
+	/* Removes the vehicles of the previous run (see DriverModel.cpp) */
+	void start_new_run();
+
+	std::unordered_map<int, TrafficLight> traffic_lights;
+	SignalGraph signal_graph;
+	std::unordered_map<long, std::unique_ptr<EgoVehicle>> vehicles;
+	bool use_v2v_board{ false };
+	V2VBoard v2v_board{ false };
+	bool compare_full_rate{ false };
+	std::unordered_map<long, std::unique_ptr<EgoVehicle>> full_rate_vehicles;
+	V2VBoard full_rate_v2v_board{ false };
+	DecimationComparison decimation_comparison;
+	WorkStealingThreadPool thread_pool;
+	LaneChangeGapAcceptance lane_change_gap_acceptance;
+
+	double simulation_time_step{ -1.0 };
+	double current_time{ 0.0 };
+	long current_vehicle_id{ 0 };
+	long current_vehicle_type{ 0 };
+	double current_desired_velocity{ 0.0 };
+
+	/* Current step */
+	bool has_pending_step{ false };
+	std::vector<VehicleTask> tasks;
+	std::unordered_map<long, size_t> task_index_by_vehicle_id;
+	/* Task receiving the current vehicle's inputs (-1 if none) */
+	long current_task_index{ -1 };
+	std::vector<long> killed_vehicles;
+	long n_steps{ 0 };
+};
@@ -0,0 +1,54 @@
+#include <iostream>
+
+#include "AllocationCounter.h"
+#include "SubsystemMemoryReport.h"
+
+void SubsystemMemoryReport::start(double interval)
+{
+	if (is_active()) return;
+
+	this->interval = interval;
+	AllocationCounter::start_subsystem_tracking();
+
+	AllocationCounter::Scope scope{
+		AllocationCounter::Subsystem::logging };
+	report_file.open(report_file_name);
+	if (!report_file.is_open())
+	{
+		std::clog << "Unable to open the memory by subsystem file."
+			<< std::endl;
+		return;
+	}
+	report_file << "time, subsystem, current bytes, peak bytes, "
+		<< "allocated bytes, allocations, deallocations" << std::endl;
+}
+
+void SubsystemMemoryReport::update(double time)
+{
+	if (!is_active() || time < next_snapshot_time) return;
+	write_snapshot(time);
+	next_snapshot_time = time + interval;
+}
+
+void SubsystemMemoryReport::write_snapshot(double time)
+{
+	if (!is_active()) return;
+
+	AllocationCounter::Scope scope{
+		AllocationCounter::Subsystem::logging };
+	for (int i = 0; i < AllocationCounter::n_subsystems; i++)
+	{
+		AllocationCounter::Subsystem subsystem =
+			AllocationCounter::Subsystem(i);
+		AllocationCounter::SubsystemCounts counts =
+			AllocationCounter::get_subsystem_counts(subsystem);
+		report_file << time
+			<< ", " << AllocationCounter::subsystem_to_string(subsystem)
+			<< ", " << counts.current_bytes
+			<< ", " << counts.peak_bytes
+			<< ", " << counts.allocated_bytes
+			<< ", " << counts.n_allocations
+			<< ", " << counts.n_deallocations << "\n";
+	}
+	report_file.flush();
+}
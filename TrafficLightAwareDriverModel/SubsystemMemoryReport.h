@@ -0,0 +1,36 @@
+/*==========================================================================*/
+/*  SubsystemMemoryReport.h													*/
+/*  Periodic snapshots of the memory used by each subsystem of the DLL		*/
+/*                                                                          */
+/*  Version of 2022-06	                              Fernando V. Monteiro  */
+/*==========================================================================*/
+
+#pragma once
+
+#include <fstream>
+
+/* Writes the allocation counters of every subsystem (see
+AllocationCounter) to memory_by_subsystem.csv at a fixed simulation time
+interval. */
+class SubsystemMemoryReport
+{
+public:
+	/* Starts subsystem tracking and opens the report file. interval is in
+	simulation seconds. */
+	void start(double interval);
+	bool is_active() const { return report_file.is_open(); };
+	/* Writes a snapshot if at least one interval has passed since the
+	previous one */
+	void update(double time);
+	void write_snapshot(double time);
+	/* Snapshots of all runs of a session go to the same file, so the memory
+	kept from one run to the next can be checked. The schedule restarts
+	with the simulation time. */
+	void start_new_run() { next_snapshot_time = 0.0; };
+
+private:
+	double interval{ 0.0 };
+	double next_snapshot_time{ 0.0 };
+	std::ofstream report_file;
+	const char* report_file_name{ "memory_by_subsystem.csv" };
+};
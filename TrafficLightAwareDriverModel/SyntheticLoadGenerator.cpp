@@ -0,0 +1,431 @@
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+
+#include "Constants.h"
+#include "DriverModel.h"
+#include "SyntheticLoadGenerator.h"
+
+SyntheticLoadGenerator::SyntheticLoadGenerator(
+	const Configuration& configuration,
+	const std::unordered_map<int, TrafficLight>& base_layout,
+	double time_step, double start_time, unsigned int seed) :
+	configuration{ configuration },
+	time_step{ time_step },
+	time{ start_time },
+	random_generator{ seed }
+{
+	build_traffic_lights(base_layout);
+	corridor_length = (traffic_lights.empty() ?
+		1000.0 : traffic_lights.back().get_position()) + 300.0;
+
+	long vehicles_per_corridor = std::max(1L,
+		static_cast<long>(corridor_length / initial_spacing) * n_lanes);
+	n_corridors = static_cast<int>(
+		(configuration.n_vehicles + vehicles_per_corridor - 1)
+		/ vehicles_per_corridor);
+	lanes.resize(std::max(n_corridors, 1) * n_lanes);
+
+	std::uniform_real_distribution<double> desired_velocity(13.0, 17.0);
+	for (long i = 0; i < configuration.n_vehicles; i++)
+	{
+		long position_in_corridor = i % vehicles_per_corridor;
+		SyntheticVehicle vehicle;
+		vehicle.id = next_vehicle_id++;
+		vehicle.type = static_cast<long>(i % 2 == 0 ?
+			VehicleType::traffic_light_acc_car
+			: VehicleType::traffic_light_cacc_car);
+		vehicle.corridor = static_cast<int>(i / vehicles_per_corridor);
+		vehicle.lane = position_in_corridor % n_lanes + 1;
+		vehicle.position = (position_in_corridor / n_lanes
+			+ double(vehicle.lane) / n_lanes) * initial_spacing;
+		vehicle.velocity = initial_velocity;
+		vehicle.desired_velocity = desired_velocity(random_generator);
+		vehicles.push_back(vehicle);
+	}
+}
+
+bool SyntheticLoadGenerator::write_traffic_light_file(
+	const std::string& file_name) const
+{
+	std::ofstream file(file_name);
+	if (!file.is_open())
+	{
+		std::clog << "Unable to open the synthetic traffic light file "
+			<< file_name << std::endl;
+		return false;
+	}
+	file << "id,position,red duration,green duration,amber duration\n";
+	for (const TrafficLight& traffic_light : traffic_lights)
+	{
+		file << traffic_light.get_id()
+			<< "," << traffic_light.get_position()
+			<< "," << traffic_light.get_red_duration()
+			<< "," << traffic_light.get_green_duration()
+			<< "," << traffic_light.get_amber_duration() << "\n";
+	}
+	return true;
+}
+
+const std::vector<SyntheticLoadGenerator::Call>&
+SyntheticLoadGenerator::generate_step()
+{
+	calls.clear();
+	if (is_first_step)
+	{
+		add_call(CallType::set_value, DRIVER_DATA_TIMESTEP, 0, 0, 0,
+			time_step);
+		is_first_step = false;
+	}
+	else
+	{
+		time += time_step;
+		move_vehicles();
+	}
+	add_call(CallType::set_value, DRIVER_DATA_TIME, 0, 0, 0, time);
+
+	for (long id : removed_vehicle_ids)
+	{
+		add_call(CallType::set_value, DRIVER_DATA_VEH_ID, 0, 0, id);
+		add_call(CallType::command, DRIVER_COMMAND_KILL_DRIVER);
+	}
+	removed_vehicle_ids.clear();
+	for (SyntheticVehicle& vehicle : vehicles)
+	{
+		if (!vehicle.is_new) continue;
+		add_call(CallType::set_value, DRIVER_DATA_VEH_ID, 0, 0, vehicle.id);
+		add_call(CallType::set_value, DRIVER_DATA_VEH_TYPE, 0, 0,
+			vehicle.type);
+		add_call(CallType::set_value, DRIVER_DATA_VEH_DESIRED_VELOCITY,
+			0, 0, 0, vehicle.desired_velocity);
+		add_call(CallType::command, DRIVER_COMMAND_CREATE_DRIVER);
+		vehicle.is_new = false;
+	}
+
+	for (const TrafficLight& traffic_light : traffic_lights)
+	{
+		double state_start_time;
+		long state = get_signal_state(traffic_light, state_start_time);
+		add_call(CallType::set_value, DRIVER_DATA_SIGNAL_STATE,
+			traffic_light.get_id(), 0, state);
+		add_call(CallType::set_value, DRIVER_DATA_SIGNAL_STATE_START,
+			traffic_light.get_id(), 0, 0, state_start_time);
+	}
+
+	sort_lanes();
+	for (size_t i = 0; i < vehicles.size(); i++) add_vehicle_calls(i);
+	n_moved_vehicles = static_cast<long>(vehicles.size());
+	return calls;
+}
+
+const std::vector<SyntheticLoadGenerator::Call>&
+SyntheticLoadGenerator::generate_removal_of_all_vehicles()
+{
+	calls.clear();
+	time += time_step;
+	add_call(CallType::set_value, DRIVER_DATA_TIME, 0, 0, 0, time);
+	for (const SyntheticVehicle& vehicle : vehicles)
+	{
+		if (vehicle.is_new) continue;
+		add_call(CallType::set_value, DRIVER_DATA_VEH_ID, 0, 0, vehicle.id);
+		add_call(CallType::command, DRIVER_COMMAND_KILL_DRIVER);
+	}
+	vehicles.clear();
+	n_moved_vehicles = 0;
+	return calls;
+}
+
+void SyntheticLoadGenerator::set_result(const Call& call, double double_value)
+{
+	if (call.type == DRIVER_DATA_DESIRED_ACCELERATION)
+	{
+		vehicles[call.vehicle_index].acceleration = double_value;
+	}
+}
+
+void SyntheticLoadGenerator::build_traffic_lights(
+	const std::unordered_map<int, TrafficLight>& base_layout)
+{
+	std::vector<const TrafficLight*> base;
+	for (const std::pair<const int, TrafficLight>& pair : base_layout)
+	{
+		base.push_back(&pair.second);
+	}
+	if (base.empty())
+	{
+		if (configuration.n_traffic_lights > 0)
+		{
+			std::clog << "No base traffic light layout. The synthetic "
+				<< "network has no traffic lights." << std::endl;
+		}
+		return;
+	}
+	std::sort(base.begin(), base.end(),
+		[](const TrafficLight* a, const TrafficLight* b) {
+			return a->get_position() < b->get_position(); });
+
+	/* The layout is repeated with the mean spacing between its traffic
+	lights separating one copy from the next */
+	size_t n_base = base.size();
+	double layout_length = base.back()->get_position()
+		- base.front()->get_position();
+	double mean_spacing = n_base > 1 ? layout_length / (n_base - 1) : 500.0;
+	double period = layout_length + mean_spacing;
+	for (int k = 0; k < configuration.n_traffic_lights; k++)
+	{
+		const TrafficLight& original = *base[k % n_base];
+		traffic_lights.emplace_back(k + 1,
+			original.get_position() + (k / n_base) * period,
+			original.get_red_duration(), original.get_green_duration(),
+			original.get_amber_duration());
+	}
+}
+
+void SyntheticLoadGenerator::move_vehicles()
+{
+	for (size_t i = 0; i < vehicles.size(); i++)
+	{
+		SyntheticVehicle& vehicle = vehicles[i];
+		vehicle.velocity = std::max(
+			vehicle.velocity + vehicle.acceleration * time_step, 0.0);
+		vehicle.position += vehicle.velocity * time_step;
+		if (vehicle.position > corridor_length) replace_vehicle(i);
+	}
+
+	pending_turnover += configuration.turnover_rate * time_step;
+	if (vehicles.empty()) return;
+	std::uniform_int_distribution<size_t> vehicle_index(0,
+		vehicles.size() - 1);
+	while (pending_turnover >= 1.0)
+	{
+		replace_vehicle(vehicle_index(random_generator));
+		pending_turnover -= 1.0;
+	}
+}
+
+void SyntheticLoadGenerator::replace_vehicle(size_t vehicle_index)
+{
+	SyntheticVehicle& vehicle = vehicles[vehicle_index];
+	/* Vehicles that were never created in the DLL need not be removed */
+	if (!vehicle.is_new) removed_vehicle_ids.push_back(vehicle.id);
+
+	/* Enter behind the last vehicle of the lane (lanes are sorted as of
+	the previous step) */
+	const std::vector<size_t>& lane =
+		lanes[vehicle.corridor * n_lanes + vehicle.lane - 1];
+	double entry_position = 0.0;
+	if (!lane.empty())
+	{
+		entry_position = std::min(entry_position,
+			vehicles[lane.front()].position - initial_spacing);
+	}
+
+	std::uniform_real_distribution<double> desired_velocity(13.0, 17.0);
+	vehicle.id = next_vehicle_id++;
+	vehicle.position = entry_position;
+	vehicle.velocity = initial_velocity;
+	vehicle.acceleration = 0.0;
+	vehicle.desired_velocity = desired_velocity(random_generator);
+	vehicle.is_new = true;
+}
+
+void SyntheticLoadGenerator::sort_lanes()
+{
+	for (std::vector<size_t>& lane : lanes) lane.clear();
+	for (size_t i = 0; i < vehicles.size(); i++)
+	{
+		lanes[vehicles[i].corridor * n_lanes + vehicles[i].lane - 1]
+			.push_back(i);
+	}
+	for (std::vector<size_t>& lane : lanes)
+	{
+		std::sort(lane.begin(), lane.end(), [this](size_t a, size_t b) {
+			return vehicles[a].position < vehicles[b].position; });
+	}
+}
+
+void SyntheticLoadGenerator::add_vehicle_calls(size_t vehicle_index)
+{
+	const SyntheticVehicle& ego = vehicles[vehicle_index];
+
+	add_call(CallType::set_value, DRIVER_DATA_VEH_ID, 0, 0, ego.id);
+	add_call(CallType::set_value, DRIVER_DATA_VEH_LANE, 0, 0, ego.lane);
+	add_call(CallType::set_value, DRIVER_DATA_VEH_ODOMETER, 0, 0, 0,
+		ego.position);
+	add_call(CallType::set_value, DRIVER_DATA_VEH_LANE_ANGLE);
+	add_call(CallType::set_value, DRIVER_DATA_VEH_LATERAL_POSITION);
+	add_call(CallType::set_value, DRIVER_DATA_VEH_VELOCITY, 0, 0, 0,
+		ego.velocity);
+	add_call(CallType::set_value, DRIVER_DATA_VEH_ACCELERATION, 0, 0, 0,
+		ego.acceleration);
+	add_call(CallType::set_value, DRIVER_DATA_VEH_LENGTH, 0, 0, 0,
+		vehicle_length);
+	add_call(CallType::set_value, DRIVER_DATA_VEH_WIDTH, 0, 0, 0,
+		vehicle_width);
+	add_call(CallType::set_value, DRIVER_DATA_VEH_WEIGHT, 0, 0, 0, 1500.0);
+	add_call(CallType::set_value, DRIVER_DATA_VEH_MAX_ACCELERATION, 0, 0,
+		0, 3.5);
+	add_call(CallType::set_value, DRIVER_DATA_VEH_TURNING_INDICATOR);
+	add_call(CallType::set_value, DRIVER_DATA_VEH_CATEGORY, 0, 0, 1);
+	add_call(CallType::set_value, DRIVER_DATA_VEH_PREFERRED_REL_LANE);
+	add_call(CallType::set_value, DRIVER_DATA_VEH_USE_PREFERRED_LANE);
+	add_call(CallType::set_value, DRIVER_DATA_VEH_DESIRED_VELOCITY, 0, 0,
+		0, ego.desired_velocity);
+	add_call(CallType::set_value, DRIVER_DATA_VEH_TYPE, 0, 0, ego.type);
+	add_call(CallType::set_value, DRIVER_DATA_VEH_CURRENT_LINK, 0, 0,
+		ego.corridor + 1);
+	add_call(CallType::set_value, DRIVER_DATA_VEH_ACTIVE_LANE_CHANGE);
+	add_call(CallType::set_value, DRIVER_DATA_VEH_REL_TARGET_LANE);
+
+	/* Nearby vehicles in the order of relevance: closest ones on the same
+	lane first, then the closest ones on adjacent lanes, then the second
+	closest ones */
+	const int relative_lanes[max_nearby_vehicles] =
+		{ 0, 0, 1, -1, 1, -1, 0, 0, 1, -1, 1, -1 };
+	const int relative_positions[max_nearby_vehicles] =
+		{ 1, -1, 1, 1, -1, -1, 2, -2, 2, 2, -2, -2 };
+	int n_nearby_vehicles = std::min(configuration.n_nearby_vehicles,
+		max_nearby_vehicles);
+	for (int k = 0; k < n_nearby_vehicles; k++)
+	{
+		int lane_number = ego.lane + relative_lanes[k];
+		if (lane_number < 1 || lane_number > n_lanes) continue;
+		const std::vector<size_t>& lane =
+			lanes[ego.corridor * n_lanes + lane_number - 1];
+		long first_ahead = static_cast<long>(
+			find_first_ahead(lane, ego.position));
+		long index;
+		if (relative_positions[k] > 0)
+		{
+			index = first_ahead + relative_positions[k] - 1;
+		}
+		else
+		{
+			/* On the same lane, the ego vehicle is right behind the first
+			vehicle ahead */
+			long first_behind = relative_lanes[k] == 0 ?
+				first_ahead - 2 : first_ahead - 1;
+			index = first_behind + relative_positions[k] + 1;
+		}
+		if (index < 0 || index >= static_cast<long>(lane.size())) continue;
+		add_nearby_vehicle_calls(ego, relative_lanes[k],
+			relative_positions[k], vehicles[lane[index]]);
+	}
+
+	add_call(CallType::set_value, DRIVER_DATA_NO_OF_LANES, 0, 0, n_lanes);
+	for (int lane = 1; lane <= n_lanes; lane++)
+	{
+		add_call(CallType::set_value, DRIVER_DATA_LANE_WIDTH, lane, 0, 0,
+			3.5);
+		add_call(CallType::set_value, DRIVER_DATA_LANE_END_DISTANCE, lane,
+			0, 0, -1.0);
+	}
+
+	auto next_traffic_light = std::upper_bound(traffic_lights.begin(),
+		traffic_lights.end(), ego.position,
+		[](double position, const TrafficLight& traffic_light) {
+			return position < traffic_light.get_position(); });
+	if (next_traffic_light != traffic_lights.end())
+	{
+		double state_start_time;
+		long state = get_signal_state(*next_traffic_light, state_start_time);
+		add_call(CallType::set_value, DRIVER_DATA_SIGNAL_DISTANCE,
+			next_traffic_light->get_id(), 0, 0,
+			next_traffic_light->get_position() - ego.position);
+		add_call(CallType::set_value, DRIVER_DATA_SIGNAL_STATE,
+			next_traffic_light->get_id(), 0, state);
+		add_call(CallType::set_value, DRIVER_DATA_SIGNAL_STATE_START,
+			next_traffic_light->get_id(), 0, 0, state_start_time);
+	}
+
+	/* Suggestions of VISSIM's internal model */
+	add_call(CallType::set_value, DRIVER_DATA_DESIRED_ACCELERATION);
+	add_call(CallType::set_value, DRIVER_DATA_DESIRED_LANE_ANGLE);
+	add_call(CallType::set_value, DRIVER_DATA_ACTIVE_LANE_CHANGE);
+	add_call(CallType::set_value, DRIVER_DATA_REL_TARGET_LANE);
+
+	add_call(CallType::command, DRIVER_COMMAND_MOVE_DRIVER);
+
+	add_call(CallType::get_value, DRIVER_DATA_STATUS);
+	add_call(CallType::get_value, DRIVER_DATA_VEH_TURNING_INDICATOR);
+	add_call(CallType::get_value, DRIVER_DATA_VEH_DESIRED_VELOCITY);
+	add_call(CallType::get_value, DRIVER_DATA_VEH_COLOR);
+	add_call(CallType::get_value, DRIVER_DATA_DESIRED_ACCELERATION,
+		0, 0, 0, 0.0, vehicle_index);
+	add_call(CallType::get_value, DRIVER_DATA_DESIRED_LANE_ANGLE);
+	add_call(CallType::get_value, DRIVER_DATA_ACTIVE_LANE_CHANGE);
+	add_call(CallType::get_value, DRIVER_DATA_REL_TARGET_LANE);
+}
+
+void SyntheticLoadGenerator::add_nearby_vehicle_calls(
+	const SyntheticVehicle& ego, int relative_lane, int relative_position,
+	const SyntheticVehicle& nearby_vehicle)
+{
+	add_call(CallType::set_value, DRIVER_DATA_NVEH_ID, relative_lane,
+		relative_position, nearby_vehicle.id);
+	add_call(CallType::set_value, DRIVER_DATA_NVEH_LANE_ANGLE,
+		relative_lane, relative_position);
+	add_call(CallType::set_value, DRIVER_DATA_NVEH_LATERAL_POSITION,
+		relative_lane, relative_position);
+	add_call(CallType::set_value, DRIVER_DATA_NVEH_DISTANCE, relative_lane,
+		relative_position, 0, nearby_vehicle.position - ego.position);
+	add_call(CallType::set_value, DRIVER_DATA_NVEH_REL_VELOCITY,
+		relative_lane, relative_position, 0,
+		ego.velocity - nearby_vehicle.velocity);
+	add_call(CallType::set_value, DRIVER_DATA_NVEH_ACCELERATION,
+		relative_lane, relative_position, 0, nearby_vehicle.acceleration);
+	add_call(CallType::set_value, DRIVER_DATA_NVEH_LENGTH, relative_lane,
+		relative_position, 0, vehicle_length);
+	add_call(CallType::set_value, DRIVER_DATA_NVEH_WIDTH, relative_lane,
+		relative_position, 0, vehicle_width);
+	add_call(CallType::set_value, DRIVER_DATA_NVEH_WEIGHT, relative_lane,
+		relative_position, 0, 1500.0);
+	add_call(CallType::set_value, DRIVER_DATA_NVEH_TURNING_INDICATOR,
+		relative_lane, relative_position);
+	add_call(CallType::set_value, DRIVER_DATA_NVEH_CATEGORY, relative_lane,
+		relative_position, 1);
+	add_call(CallType::set_value, DRIVER_DATA_NVEH_LANE_CHANGE,
+		relative_lane, relative_position);
+	add_call(CallType::set_value, DRIVER_DATA_NVEH_TYPE, relative_lane,
+		relative_position, nearby_vehicle.type);
+}
+
+size_t SyntheticLoadGenerator::find_first_ahead(
+	const std::vector<size_t>& lane, double position) const
+{
+	return std::upper_bound(lane.begin(), lane.end(), position,
+		[this](double p, size_t i) { return p < vehicles[i].position; })
+		- lane.begin();
+}
+
+long SyntheticLoadGenerator::get_signal_state(
+	const TrafficLight& traffic_light, double& state_start_time) const
+{
+	/* All traffic lights start on red at time zero */
+	double phase = std::fmod(time, traffic_light.get_cycle_time());
+	double cycle_start_time = time - phase;
+	if (phase < traffic_light.get_red_duration())
+	{
+		state_start_time = cycle_start_time;
+		return static_cast<long>(TrafficLight::State::red);
+	}
+	if (phase < traffic_light.get_red_duration()
+		+ traffic_light.get_green_duration())
+	{
+		state_start_time = cycle_start_time
+			+ traffic_light.get_red_duration();
+		return static_cast<long>(TrafficLight::State::green);
+	}
+	state_start_time = cycle_start_time + traffic_light.get_red_duration()
+		+ traffic_light.get_green_duration();
+	return static_cast<long>(TrafficLight::State::amber);
+}
+
+void SyntheticLoadGenerator::add_call(CallType call_type, long type,
+	long index1, long index2, long long_value, double double_value,
+	size_t vehicle_index)
+{
+	calls.push_back({ call_type, type, index1, index2, long_value,
+		double_value, vehicle_index });
+}
@@ -0,0 +1,134 @@
+/*==========================================================================*/
+/*  SyntheticLoadGenerator.h												*/
+/*  Synthetic sequences of VISSIM calls to the DLL							*/
+/*                                                                          */
+/*  Version of 2022-06	                              Fernando V. Monteiro  */
+/*==========================================================================*/
+
+#pragma once
+
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "TrafficLight.h"
+
+/* Generates the calls VISSIM would make to DriverModelSetValue,
+DriverModelGetValue and DriverModelExecuteCommand in each time step, in the
+order given by the interface documentation, for a synthetic network.
+
+The network is made of identical corridors with three lanes and the
+traffic lights of a base layout (usually the one in
+traffic_lights_study_source_times.csv) repeated downstream as many times as
+needed to reach the requested number of traffic lights. Corridors are added
+as the number of vehicles grows, so that the density stays constant.
+Vehicles move according to the desired accelerations returned by the DLL,
+leave the network at the end of the corridor and are replaced by new ones
+at its start. Additional vehicles are replaced at random at the given
+turnover rate. */
+class SyntheticLoadGenerator
+{
+public:
+	struct Configuration {
+		long n_vehicles{ 500 };
+		int n_traffic_lights{ 4 };
+		/* Nearby vehicles sent per vehicle, up to 12 (two upstream and two
+		downstream on the vehicle's lane and on each adjacent lane) */
+		int n_nearby_vehicles{ 4 };
+		/* Vehicles removed and inserted per second besides the ones
+		leaving at the end of the corridor */
+		double turnover_rate{ 1.0 };
+	};
+
+	enum class CallType {
+		set_value,
+		get_value,
+		command,
+	};
+
+	struct Call {
+		CallType call_type{ CallType::set_value };
+		long type{ 0 }; // data type or command number
+		long index1{ 0 };
+		long index2{ 0 };
+		long long_value{ 0 };
+		double double_value{ 0.0 };
+		/* Synthetic vehicle the call refers to (for get_value calls) */
+		size_t vehicle_index{ 0 };
+	};
+
+	SyntheticLoadGenerator(const Configuration& configuration,
+		const std::unordered_map<int, TrafficLight>& base_layout,
+		double time_step, double start_time, unsigned int seed);
+
+	/* Traffic lights of the synthetic network, in the parameter file
+	format read by TrafficLightFileReader */
+	bool write_traffic_light_file(const std::string& file_name) const;
+	/* Calls of the next time step */
+	const std::vector<Call>& generate_step();
+	/* Calls that remove every vehicle from the network */
+	const std::vector<Call>& generate_removal_of_all_vehicles();
+	/* Must be called with the values returned by the DLL for get_value
+	calls, so that vehicles move according to the model */
+	void set_result(const Call& call, double double_value);
+	/* Vehicles moved in the last generated step */
+	long get_n_moved_vehicles() const { return n_moved_vehicles; };
+	double get_time() const { return time; };
+
+private:
+	struct SyntheticVehicle {
+		long id{ 0 };
+		long type{ 0 };
+		int corridor{ 0 };
+		int lane{ 1 }; // 1 is the rightmost lane
+		double position{ 0.0 }; // front bumper [m]
+		double velocity{ 0.0 };
+		double acceleration{ 0.0 };
+		double desired_velocity{ 0.0 };
+		bool is_new{ true };
+	};
+
+	static const int n_lanes{ 3 };
+	static const int max_nearby_vehicles{ 12 };
+	const double vehicle_length{ 4.5 }; // [m]
+	const double vehicle_width{ 1.8 }; // [m]
+	const double initial_spacing{ 40.0 }; // [m]
+	const double initial_velocity{ 15.0 }; // [m/s]
+
+	void build_traffic_lights(
+		const std::unordered_map<int, TrafficLight>& base_layout);
+	void move_vehicles();
+	void replace_vehicle(size_t vehicle_index);
+	void sort_lanes();
+	void add_vehicle_calls(size_t vehicle_index);
+	void add_nearby_vehicle_calls(const SyntheticVehicle& ego,
+		int relative_lane, int relative_position,
+		const SyntheticVehicle& nearby_vehicle);
+	/* Index in the lane's sorted vector of the first vehicle ahead of the
+	given position */
+	size_t find_first_ahead(const std::vector<size_t>& lane,
+		double position) const;
+	long get_signal_state(const TrafficLight& traffic_light,
+		double& state_start_time) const;
+	void add_call(CallType call_type, long type, long index1 = 0,
+		long index2 = 0, long long_value = 0, double double_value = 0.0,
+		size_t vehicle_index = 0);
+
+	Configuration configuration;
+	double time_step{ 0.1 };
+	double time{ 0.0 };
+	double corridor_length{ 0.0 };
+	int n_corridors{ 1 };
+	std::vector<TrafficLight> traffic_lights; // ordered by position
+	std::vector<SyntheticVehicle> vehicles;
+	/* Vehicle indices per corridor and lane, sorted by position */
+	std::vector<std::vector<size_t>> lanes;
+	std::vector<long> removed_vehicle_ids;
+	long next_vehicle_id{ 1 };
+	double pending_turnover{ 0.0 };
+	long n_moved_vehicles{ 0 };
+	bool is_first_step{ true };
+	std::mt19937 random_generator;
+	std::vector<Call> calls;
+};
@@ -1,3 +1,5 @@
+#include <cmath>
+
 #include "TrafficLight.h"
 
 TrafficLight::TrafficLight(int id, double position, double red_duration, double green_duration, double amber_duration, bool starts_on_red) :
@@ -10,6 +12,20 @@ TrafficLight::TrafficLight(int id, double position, double red_duration,
 	TrafficLight(id, position, red_duration, 
 		green_duration, amber_duration, true) {}
 
+TrafficLight::TrafficLight(int id, double position, double red_duration,
+	double green_duration, double amber_duration, double offset) :
+	TrafficLight(id, position, red_duration, green_duration,
+		amber_duration, true)
+{
+	this->offset = offset;
+	/* Whether the light is red at time zero */
+	double cycle_time = get_cycle_time();
+	double time_in_cycle = cycle_time > 0 ?
+		std::fmod(std::fmod(-offset, cycle_time) + cycle_time, cycle_time)
+		: 0.0;
+	starts_on_red = time_in_cycle < red_duration;
+}
+
 double TrafficLight::get_time_of_next_red() const
 {
 	switch (current_state)
@@ -27,10 +27,19 @@ public:
 		double green_duration, double amber_duration, bool starts_on_red);
 	TrafficLight(int id, double position, double red_duration,
 		double green_duration, double amber_duration);
+	/* The offset is the time in the cycle at which red starts */
+	TrafficLight(int id, double position, double red_duration,
+		double green_duration, double amber_duration, double offset);
 
 	int get_id() const { return id; };
 	double get_position() const { return position; };
+	double get_red_duration() const { return red_duration; };
+	double get_green_duration() const { return green_duration; };
 	double get_amber_duration() const { return amber_duration; };
+	double get_cycle_time() const {
+		return red_duration + green_duration + amber_duration;
+	};
+	double get_offset() const { return offset; };
 	State get_current_state() const { return current_state; };
 
 	void set_current_state(long state) { current_state = State(state); };
@@ -52,8 +61,32 @@ private:
 	double position{ 0 }, red_duration{ 0 }, green_duration{ 0 },
 		amber_duration{ 0 };
 	bool starts_on_red{ true };
+	double offset{ 0 }; // [s]
 	// State
 	State current_state{ State::no_traffic_light };
 	double current_state_start_time{ 0.0 };
 };
 
+/* Events generated by a vehicle as it approaches and crosses traffic 
+lights. Used to compute traffic KPIs without storing full trajectories. */
+struct TrafficLightEvent
+{
+	enum class Type {
+		/* the vehicle joined the traffic light's queue (its first stop in
+		the approach) or, if it did not stop, reached the stop line */
+		arrival,
+		crossing, // the vehicle passed the traffic light
+	};
+
+	Type type{ Type::arrival };
+	long vehicle_id{ 0 };
+	int traffic_light_id{ 0 };
+	double time{ 0.0 };
+	/* The members below are only meaningful for crossings */
+	/* Time spent in the approach minus the free flow travel time [s] */
+	double control_delay{ 0.0 };
+	int number_of_stops{ 0 };
+	/* Negative if the vehicle had not crossed any traffic light before */
+	double travel_time_from_last_traffic_light{ -1.0 };
+};
+
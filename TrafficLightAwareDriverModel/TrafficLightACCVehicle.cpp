@@ -16,10 +16,18 @@ void TrafficLightACCVehicle::set_traffic_light_information(
 	distance_to_next_traffic_light = distance;
 }
 
-double TrafficLightACCVehicle::compute_desired_acceleration(
-	const std::unordered_map<int, TrafficLight>& traffic_lights)
+double TrafficLightACCVehicle::compute_desired_acceleration()
 {
+	LongitudinalControllerWithTrafficLights::State old_mode =
+		get_controller_mode();
 	double desired_acceleration =
-		controller.get_traffic_light_acc_acceleration(*this, traffic_lights);
+		controller.get_traffic_light_acc_acceleration(*this);
+	if (get_is_connected()) publish_to_v2v_board(desired_acceleration);
+	if (get_controller_mode() != old_mode)
+	{
+		add_event(Event::Type::mode_transition,
+			static_cast<long>(old_mode),
+			static_cast<long>(get_controller_mode()));
+	}
 	return desired_acceleration;
-}
\ No newline at end of file
+}
@@ -19,16 +19,14 @@ public:
 		bool verbose = false) :
 		EgoVehicle(id, VehicleType::traffic_light_acc_car, desired_velocity,
 			true, false, simulation_time_step, creation_time, verbose) {}
-	/* Note: the "autonomous lane change" of this vehicle is never 
-	lane changing */
 
-	int get_next_traffic_light_id() const {
+	int get_next_traffic_light_id() const override {
 		return next_traffic_light_id;
 	};
 	double get_time_crossed_last_traffic_light() const {
 		return time_crossed_last_traffic_light;
 	};
-	double get_distance_to_next_traffic_light() const {
+	double get_distance_to_next_traffic_light() const override {
 		return distance_to_next_traffic_light;
 	};
 
@@ -36,19 +34,17 @@ public:
 
 protected:
 	TrafficLightACCVehicle(long id, VehicleType type,
-		double desired_velocity, bool is_connected, 
+		double desired_velocity, bool is_connected,
 		double simulation_time_step,
 		double creation_time, bool verbose = false) :
 		EgoVehicle(id, type, desired_velocity, true, is_connected,
 			simulation_time_step, creation_time, verbose) {}
 
 private:
-	double compute_desired_acceleration(
-		const std::unordered_map<int, TrafficLight>& traffic_lights) override;
-	bool can_start_lane_change() override { return false; };
+	double compute_desired_acceleration() override;
 
 	/* Traffic lights -------------------------------------------------------- */
-	void TrafficLightACCVehicle::set_traffic_light_information(
+	void set_traffic_light_information(
 		int traffic_light_id, double distance) override;
 
 	double time_crossed_last_traffic_light{ 0.0 };
@@ -65,7 +61,6 @@ public:
 		double simulation_time_step, double creation_time,
 		bool verbose = false) :
 		TrafficLightACCVehicle(id, VehicleType::traffic_light_cacc_car,
-			desired_velocity, true, simulation_time_step, creation_time, 
+			desired_velocity, true, simulation_time_step, creation_time,
 			verbose) {}
 };
-
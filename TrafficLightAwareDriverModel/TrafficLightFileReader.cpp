@@ -1,36 +1,353 @@
+#include <algorithm>
+#include <charconv>
+#include <cstring>
 #include <fstream>
-#include <sstream>
+#include <iostream>
+#include <new>
 
 #include "TrafficLightFileReader.h"
 
-void TrafficLightFileReader::from_file_to_objects(std::string full_address,
-	std::unordered_map<int, TrafficLight>& traffic_lights) 
-{
-	std::ifstream data_file(full_address);
-	std::string line;
-	int id;
-	double position, red_duration, green_duration, amber_duration;
-
-	std::getline(data_file, line); // discard the header
-	/* The data is ordered as: 
-	id, position, red duration, green duration, amber duration */
-	while (std::getline(data_file, line))
-	{
-		std::istringstream s(line);
-		std::string field;
-		std::getline(s, field, ',');
-		id = std::stoi(field);
-		std::getline(s, field, ',');
-		position = std::stod(field);
-		std::getline(s, field, ',');
-		red_duration = std::stod(field);
-		std::getline(s, field, ',');
-		green_duration = std::stod(field);
-		std::getline(s, field, ',');
-		amber_duration = std::stod(field);
+bool TrafficLightFileReader::uses_binary_images{ false };
+bool TrafficLightFileReader::uses_shared_memory{ false };
+std::unordered_map<std::string, TrafficLightFileReader::CachedTable>
+TrafficLightFileReader::cache;
+
+template <typename Number>
+bool TrafficLightFileReader::parse_field(const char*& cursor,
+	const char* line_end, bool is_last_field, Number& value,
+	const char*& error_position, const char*& error_message)
+{
+	while (cursor < line_end && (*cursor == ' ' || *cursor == '\t'))
+	{
+		cursor++;
+	}
+	std::from_chars_result result = std::from_chars(cursor, line_end,
+		value);
+	if (result.ec != std::errc())
+	{
+		error_position = cursor;
+		error_message = result.ec == std::errc::result_out_of_range ?
+			"number out of range" : "expected a number";
+		return false;
+	}
+	cursor = result.ptr;
+	while (cursor < line_end && (*cursor == ' ' || *cursor == '\t'))
+	{
+		cursor++;
+	}
+	if (is_last_field)
+	{
+		if (cursor == line_end) return true;
+		error_position = cursor;
+		error_message = "unexpected characters after the last field";
+		return false;
+	}
+	if (cursor < line_end && *cursor == ',')
+	{
+		cursor++;
+		return true;
+	}
+	error_position = cursor;
+	error_message = "expected ','";
+	return false;
+}
+
+template bool TrafficLightFileReader::parse_field<int>(const char*& cursor,
+	const char* line_end, bool is_last_field, int& value,
+	const char*& error_position, const char*& error_message);
+template bool TrafficLightFileReader::parse_field<long>(const char*& cursor,
+	const char* line_end, bool is_last_field, long& value,
+	const char*& error_position, const char*& error_message);
+template bool TrafficLightFileReader::parse_field<double>(
+	const char*& cursor, const char* line_end, bool is_last_field,
+	double& value, const char*& error_position, const char*& error_message);
+
+bool TrafficLightFileReader::from_file_to_objects(
+	const std::string& full_address,
+	std::unordered_map<int, TrafficLight>& traffic_lights)
+{
+	MappedFile::Attributes source = MappedFile::get_attributes(
+		full_address);
+	if (!source.exists)
+	{
+		std::clog << "Traffic light file " << full_address
+			<< " not found" << std::endl;
+		return false;
+	}
+
+	auto cached = cache.find(full_address);
+	if (cached == cache.end()
+		|| cached->second.source.size != source.size
+		|| cached->second.source.last_write_time != source.last_write_time)
+	{
+		CachedTable table;
+		table.source = source;
+		if (!uses_shared_memory || !read_shared_table(full_address, table))
+		{
+			std::string image_file = full_address + image_extension;
+			bool is_image_read = uses_binary_images
+				&& read_binary_image(image_file, source, table.own_rows);
+			if (!is_image_read && !parse_file(full_address, table.own_rows))
+			{
+				cache.erase(full_address);
+				return false;
+			}
+			table.rows = table.own_rows.data();
+			table.n_rows = table.own_rows.size();
+			if (uses_binary_images && !is_image_read)
+			{
+				write_binary_image(image_file, table);
+			}
+			if (uses_shared_memory) publish_shared_table(full_address, table);
+		}
+		cached = cache.insert_or_assign(full_address, std::move(table)).first;
+	}
+
+	const CachedTable& table = cached->second;
+	traffic_lights.reserve(traffic_lights.size() + table.n_rows);
+	for (const Row* row = table.rows; row < table.rows + table.n_rows; row++)
+	{
 		traffic_lights.emplace(std::piecewise_construct,
-			std::forward_as_tuple(id),
-			std::forward_as_tuple(id, position, red_duration,
-				green_duration, amber_duration));
+			std::forward_as_tuple(row->id),
+			std::forward_as_tuple(row->id, row->position, row->red_duration,
+				row->green_duration, row->amber_duration));
+	}
+	return true;
+}
+
+bool TrafficLightFileReader::parse(const char* begin, const char* end,
+	std::vector<Row>& rows, Error& error)
+{
+	rows.clear();
+	rows.reserve(std::count(begin, end, '\n'));
+	/* Line of the first occurrence of each id */
+	std::unordered_map<int, size_t> line_by_id;
+	line_by_id.reserve(rows.capacity());
+
+	const char* line_start = begin;
+	size_t line = 0;
+	while (line_start < end)
+	{
+		line++;
+		const char* line_end = static_cast<const char*>(
+			std::memchr(line_start, '\n', end - line_start));
+		if (line_end == nullptr) line_end = end;
+		const char* next_line_start = line_end + (line_end < end ? 1 : 0);
+		if (line_end > line_start && *(line_end - 1) == '\r') line_end--;
+		/* Skips the header and blank lines */
+		if (line == 1 || std::all_of(line_start, line_end,
+			[](char c) { return c == ' ' || c == '\t'; }))
+		{
+			line_start = next_line_start;
+			continue;
+		}
+
+		Row row;
+		const char* cursor = line_start;
+		const char* error_position = nullptr;
+		const char* error_message = nullptr;
+		bool is_valid =
+			parse_field(cursor, line_end, false, row.id,
+				error_position, error_message)
+			&& parse_field(cursor, line_end, false, row.position,
+				error_position, error_message)
+			&& parse_field(cursor, line_end, false, row.red_duration,
+				error_position, error_message)
+			&& parse_field(cursor, line_end, false, row.green_duration,
+				error_position, error_message)
+			&& parse_field(cursor, line_end, true, row.amber_duration,
+				error_position, error_message);
+		if (is_valid)
+		{
+			error_position = line_start;
+			if (row.id <= 0)
+			{
+				error_message = "traffic light ids must be positive";
+			}
+			else if (row.red_duration < 0 || row.green_duration < 0
+				|| row.amber_duration < 0)
+			{
+				error_message = "durations must not be negative";
+			}
+			else if (row.red_duration + row.green_duration
+				+ row.amber_duration <= 0)
+			{
+				error_message = "the cycle time must be positive";
+			}
+		}
+		if (error_message != nullptr)
+		{
+			error.line = line;
+			error.column = error_position - line_start + 1;
+			error.message = error_message;
+			return false;
+		}
+		auto first_line = line_by_id.emplace(row.id, line);
+		if (!first_line.second)
+		{
+			error.line = line;
+			error.column = 1;
+			error.message = "repeated traffic light id (first on line "
+				+ std::to_string(first_line.first->second) + ")";
+			return false;
+		}
+		rows.push_back(row);
+		line_start = next_line_start;
 	}
+	return true;
+}
+
+bool TrafficLightFileReader::parse_file(const std::string& full_address,
+	std::vector<Row>& rows)
+{
+	MappedFile file(full_address);
+	if (!file.is_open())
+	{
+		std::clog << "Could not open traffic light file " << full_address
+			<< std::endl;
+		return false;
+	}
+	Error error;
+	if (!parse(file.begin(), file.end(), rows, error))
+	{
+		std::clog << "Error in traffic light file " << full_address
+			<< ", line " << error.line << ", column " << error.column
+			<< ": " << error.message << std::endl;
+		return false;
+	}
+	return true;
+}
+
+const TrafficLightFileReader::Row* TrafficLightFileReader::find_image_rows(
+	const char* image, size_t image_size,
+	const MappedFile::Attributes& source, size_t& n_rows)
+{
+	if (image_size < sizeof(ImageHeader)) return nullptr;
+	ImageHeader header;
+	ImageHeader expected_header;
+	std::memcpy(&header, image, sizeof(header));
+	if (std::memcmp(header.magic, expected_header.magic,
+		sizeof(header.magic)) != 0
+		|| header.version != expected_header.version
+		|| header.row_size != expected_header.row_size
+		|| header.source_size != source.size
+		|| header.source_write_time != source.last_write_time
+		|| header.n_rows > (image_size - sizeof(ImageHeader)) / sizeof(Row))
+	{
+		return nullptr;
+	}
+	n_rows = static_cast<size_t>(header.n_rows);
+	return reinterpret_cast<const Row*>(image + sizeof(ImageHeader));
+}
+
+bool TrafficLightFileReader::read_binary_image(const std::string& image_file,
+	const MappedFile::Attributes& source, std::vector<Row>& rows)
+{
+	MappedFile image(image_file);
+	if (!image.is_open()) return false;
+	size_t n_rows{ 0 };
+	const Row* image_rows = find_image_rows(image.begin(), image.get_size(),
+		source, n_rows);
+	if (image_rows == nullptr
+		|| image.get_size() != sizeof(ImageHeader) + n_rows * sizeof(Row))
+	{
+		return false;
+	}
+	rows.assign(image_rows, image_rows + n_rows);
+	return true;
+}
+
+void TrafficLightFileReader::write_binary_image(
+	const std::string& image_file, const CachedTable& table)
+{
+	ImageHeader header;
+	header.source_size = table.source.size;
+	header.source_write_time = table.source.last_write_time;
+	header.n_rows = table.n_rows;
+	std::ofstream image(image_file, std::ios::binary | std::ios::trunc);
+	image.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	image.write(reinterpret_cast<const char*>(table.rows),
+		table.n_rows * sizeof(Row));
+	if (!image)
+	{
+		std::clog << "Could not write " << image_file << std::endl;
+	}
+}
+
+std::string TrafficLightFileReader::get_segment_name(
+	const std::string& full_address, const MappedFile::Attributes& source)
+{
+	/* FNV-1a of the path, since segment names cannot have backslashes */
+	uint64_t path_hash = 14695981039346656037ull;
+	for (char c : full_address)
+	{
+		path_hash = (path_hash ^ static_cast<unsigned char>(c))
+			* 1099511628211ull;
+	}
+	return segment_name_prefix + std::to_string(path_hash)
+		+ "_" + std::to_string(source.size)
+		+ "_" + std::to_string(source.last_write_time)
+		+ "_v" + std::to_string(ImageHeader{}.version);
+}
+
+bool TrafficLightFileReader::read_shared_table(
+	const std::string& full_address, CachedTable& table)
+{
+	auto segment = std::make_unique<SharedMemorySegment>(
+		get_segment_name(full_address, table.source));
+	if (!segment->is_open()
+		|| segment->get_size() < sizeof(SharedTableHeader))
+	{
+		return false;
+	}
+	const SharedTableHeader* shared_header =
+		reinterpret_cast<const SharedTableHeader*>(segment->begin());
+	if (shared_header->is_published.load(std::memory_order_acquire) == 0)
+	{
+		return false;
+	}
+	size_t n_rows{ 0 };
+	const Row* rows = find_image_rows(
+		segment->begin() + sizeof(SharedTableHeader),
+		segment->get_size() - sizeof(SharedTableHeader), table.source,
+		n_rows);
+	if (rows == nullptr) return false;
+	table.rows = rows;
+	table.n_rows = n_rows;
+	table.segment = std::move(segment);
+	return true;
+}
+
+void TrafficLightFileReader::publish_shared_table(
+	const std::string& full_address, CachedTable& table)
+{
+	std::string segment_name = get_segment_name(full_address, table.source);
+	auto segment = std::make_unique<SharedMemorySegment>(segment_name,
+		sizeof(SharedTableHeader) + sizeof(ImageHeader)
+		+ table.n_rows * sizeof(Row));
+	if (!segment->is_open())
+	{
+		if (!segment->get_already_exists())
+		{
+			std::clog << "Could not create shared memory segment "
+				<< segment_name << std::endl;
+		}
+		return;
+	}
+
+	char* data = segment->get_writable_data();
+	SharedTableHeader* shared_header = new (data) SharedTableHeader;
+	ImageHeader header;
+	header.source_size = table.source.size;
+	header.source_write_time = table.source.last_write_time;
+	header.n_rows = table.n_rows;
+	char* image = data + sizeof(SharedTableHeader);
+	std::memcpy(image, &header, sizeof(header));
+	std::memcpy(image + sizeof(ImageHeader), table.rows,
+		table.n_rows * sizeof(Row));
+	shared_header->is_published.store(1, std::memory_order_release);
+
+	table.rows = reinterpret_cast<const Row*>(image + sizeof(ImageHeader));
+	table.segment = std::move(segment);
+	std::vector<Row>().swap(table.own_rows);
 }
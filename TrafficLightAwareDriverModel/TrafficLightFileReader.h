@@ -7,17 +7,140 @@
 
 #pragma once
 
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
 #include <string>
 #include <unordered_map>
+#include <vector>
 
+#include "MappedFile.h"
+#include "SharedMemorySegment.h"
 #include "TrafficLight.h"
 
-/* This class implements a simple CSV reader, which get data from the
-given address and stores it in TrafficLight objects.*/
+/* Reads the traffic light CSV files (one header line, then one traffic
+light per line: id, position, red duration, green duration, amber
+duration) into TrafficLight objects.
+
+The file is mapped into memory and parsed in place with std::from_chars,
+without creating strings per line or field. Malformed lines are reported
+with their line and column, and a file with errors adds no traffic lights.
+VISSIM passes the same file once per vehicle type and the DLL reloads it
+at every run, so the parsed table is cached by path, and parsed again only
+if the file's size or modification time changed. Optionally, the table is
+also kept as a binary image next to the file (see image_extension), which
+later sessions load by copying it instead of parsing the file.
+
+When many VISSIM instances run at once on the same machine, the first one
+to read a file can also publish the table in a named shared memory segment
+(see SharedMemorySegment), which the others map read-only instead of
+parsing the file and keeping their own copy. The segment holds the binary
+image, so its layout has no pointers. Its name depends on the file's path,
+size and modification time and on the image version, so changed files and
+older layouts get new segments. A segment that does not match the file, or
+that its creator has not finished writing, is ignored and the file is
+parsed as usual.
+
+Not thread safe. */
 class TrafficLightFileReader
 {
 public:
-	static void from_file_to_objects(std::string full_address, 
+	struct Row {
+		int id{ 0 };
+		double position{ 0.0 }; // [m]
+		double red_duration{ 0.0 }; // [s]
+		double green_duration{ 0.0 }; // [s]
+		double amber_duration{ 0.0 }; // [s]
+	};
+	struct Error {
+		/* Both start at 1 */
+		size_t line{ 0 };
+		size_t column{ 0 };
+		std::string message;
+	};
+
+	static constexpr const char* image_extension{ ".bin" };
+
+	/* Adds the traffic lights of the file to traffic_lights, keeping the
+	ones already there. Returns false, and adds nothing, if the file cannot
+	be read or has errors, which are written to std::clog. */
+	static bool from_file_to_objects(const std::string& full_address,
 		std::unordered_map<int, TrafficLight>& traffic_lights);
-};
+	/* Parses the contents of a file. Stops at the first error. */
+	static bool parse(const char* begin, const char* end,
+		std::vector<Row>& rows, Error& error);
 
+	/* Reads and writes binary images of the tables. Off by default. */
+	static void set_uses_binary_images(bool value) {
+		uses_binary_images = value;
+	};
+	/* Shares the tables with other processes. Off by default. */
+	static void set_uses_shared_memory(bool value) {
+		uses_shared_memory = value;
+	};
+	/* Forgets the parsed tables (and closes their shared memory segments) */
+	static void clear_cache() { cache.clear(); };
+
+	/* Reads a number and the separator after it (a comma, or the end of
+	the line for the last field). Also used by the other CSV readers (see
+	SignalGraph). Defined for int, long and double. */
+	template <typename Number>
+	static bool parse_field(const char*& cursor, const char* line_end,
+		bool is_last_field, Number& value, const char*& error_position,
+		const char*& error_message);
+
+private:
+	struct CachedTable {
+		MappedFile::Attributes source;
+		/* Either in own_rows or in the shared memory segment */
+		const Row* rows{ nullptr };
+		size_t n_rows{ 0 };
+		std::vector<Row> own_rows;
+		std::unique_ptr<SharedMemorySegment> segment;
+	};
+	struct ImageHeader {
+		char magic[8]{ 'T', 'L', 'T', 'A', 'B', 'L', 'E', '\0' };
+		uint32_t version{ 1 };
+		uint32_t row_size{ sizeof(Row) };
+		/* Attributes of the CSV file the image was made from */
+		uint64_t source_size{ 0 };
+		uint64_t source_write_time{ 0 };
+		uint64_t n_rows{ 0 };
+	};
+	/* Shared memory segments hold this header followed by the image */
+	struct SharedTableHeader {
+		/* Set by the creator after writing the image */
+		std::atomic<uint32_t> is_published{ 0 };
+		uint32_t padding{ 0 };
+	};
+	static_assert(std::atomic<uint32_t>::is_always_lock_free,
+		"atomics in shared memory must be lock free");
+	static constexpr const char* segment_name_prefix{
+		"Local\\TrafficLightTable_" };
+
+	static bool parse_file(const std::string& full_address,
+		std::vector<Row>& rows);
+	/* Returns the rows of an image of the source file as it is now, or
+	nullptr if the image is of another file or version */
+	static const Row* find_image_rows(const char* image, size_t image_size,
+		const MappedFile::Attributes& source, size_t& n_rows);
+	/* Returns false if there is no image of the source file as it is now */
+	static bool read_binary_image(const std::string& image_file,
+		const MappedFile::Attributes& source, std::vector<Row>& rows);
+	static void write_binary_image(const std::string& image_file,
+		const CachedTable& table);
+	static std::string get_segment_name(const std::string& full_address,
+		const MappedFile::Attributes& source);
+	/* Returns false if no other process published the table */
+	static bool read_shared_table(const std::string& full_address,
+		CachedTable& table);
+	/* Moves the table's rows into a new segment, unless another process
+	created it first */
+	static void publish_shared_table(const std::string& full_address,
+		CachedTable& table);
+
+	static bool uses_binary_images;
+	static bool uses_shared_memory;
+	static std::unordered_map<std::string, CachedTable> cache;
+};
@@ -0,0 +1,139 @@
+#include <cmath>
+#include <iostream>
+
+#include "SimulationLogger.h"
+#include "TrafficLightKpiCollector.h"
+
+TrafficLightKpiCollector::~TrafficLightKpiCollector()
+{
+	write_remaining_bins();
+}
+
+void TrafficLightKpiCollector::register_traffic_lights(
+	const std::unordered_map<int, TrafficLight>& traffic_lights)
+{
+	for (const auto& pair : traffic_lights)
+	{
+		/* The parameter file may be read more than once */
+		if (approaches.find(pair.first) == approaches.end())
+		{
+			approaches[pair.first].cycle_time =
+				pair.second.get_cycle_time();
+		}
+	}
+
+	if (!kpi_table.is_open())
+	{
+		if (!SimulationLogger::open_results_file(kpi_table,
+			kpi_table_file_name, "traffic light id, cycle, "
+			"cycle start time, throughput, arrivals on green, "
+			"arrivals on red, stops, mean control delay, "
+			"mean travel time from last traffic light"))
+		{
+			std::clog << "Unable to open the traffic light KPI file."
+				<< std::endl;
+		}
+	}
+}
+
+void TrafficLightKpiCollector::add_event(const TrafficLightEvent& event,
+	const std::unordered_map<int, TrafficLight>& traffic_lights)
+{
+	CycleBin* bin = get_bin(event.traffic_light_id, event.time);
+	if (bin == nullptr) return;
+
+	switch (event.type)
+	{
+	case TrafficLightEvent::Type::arrival:
+	{
+		/* Arrivals happen when the vehicle joins the queue or reaches the
+		stop line, so the light's current state is the arrival state */
+		auto it = traffic_lights.find(event.traffic_light_id);
+		if (it != traffic_lights.end()
+			&& it->second.get_current_state() == TrafficLight::State::green)
+		{
+			bin->arrivals_on_green++;
+			run_totals.arrivals_on_green++;
+		}
+		else
+		{
+			bin->arrivals_on_red++;
+			run_totals.arrivals_on_red++;
+		}
+		break;
+	}
+	case TrafficLightEvent::Type::crossing:
+		bin->throughput++;
+		bin->number_of_stops += event.number_of_stops;
+		bin->total_control_delay += event.control_delay;
+		run_totals.throughput++;
+		run_totals.number_of_stops += event.number_of_stops;
+		run_totals.total_control_delay += event.control_delay;
+		if (event.travel_time_from_last_traffic_light >= 0)
+		{
+			bin->travel_time_samples++;
+			bin->total_travel_time +=
+				event.travel_time_from_last_traffic_light;
+		}
+		break;
+	default:
+		break;
+	}
+}
+
+void TrafficLightKpiCollector::write_remaining_bins()
+{
+	for (std::pair<const int, ApproachKpis>& pair : approaches)
+	{
+		for (CycleBin& bin : pair.second.bins)
+		{
+			if (bin.cycle >= 0) write_bin(pair.first, pair.second, bin);
+			bin = CycleBin();
+		}
+	}
+	if (kpi_table.is_open()) kpi_table.close();
+}
+
+TrafficLightKpiCollector::CycleBin* TrafficLightKpiCollector::get_bin(
+	int traffic_light_id, double time)
+{
+	auto it = approaches.find(traffic_light_id);
+	if (it == approaches.end()) return nullptr;
+
+	ApproachKpis& approach = it->second;
+	long cycle = approach.cycle_time > 0 ?
+		static_cast<long>(std::floor(time / approach.cycle_time)) : 0;
+	CycleBin& bin = approach.bins[cycle % n_bins];
+	if (bin.cycle != cycle)
+	{
+		/* Simulation time only moves forward, so the bin can only
+		be holding an older cycle */
+		if (bin.cycle > cycle) return nullptr;
+		if (bin.cycle >= 0) write_bin(traffic_light_id, approach, bin);
+		bin = CycleBin();
+		bin.cycle = cycle;
+	}
+	return &bin;
+}
+
+void TrafficLightKpiCollector::write_bin(int traffic_light_id,
+	const ApproachKpis& approach, const CycleBin& bin)
+{
+	if (!kpi_table.is_open()) return;
+
+	double mean_control_delay = bin.throughput > 0 ?
+		bin.total_control_delay / bin.throughput : 0.0;
+	double mean_travel_time = bin.travel_time_samples > 0 ?
+		bin.total_travel_time / bin.travel_time_samples : 0.0;
+	kpi_table << run_id
+		<< ", " << traffic_light_id
+		<< ", " << bin.cycle
+		<< ", " << bin.cycle * approach.cycle_time
+		<< ", " << bin.throughput
+		<< ", " << bin.arrivals_on_green
+		<< ", " << bin.arrivals_on_red
+		<< ", " << bin.number_of_stops
+		<< ", " << mean_control_delay
+		<< ", " << mean_travel_time
+		<< "\n";
+}
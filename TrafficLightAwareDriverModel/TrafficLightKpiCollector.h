@@ -0,0 +1,78 @@
+/*==========================================================================*/
+/*  TrafficLightKpiCollector.h												*/
+/*  Online aggregation of traffic KPIs per traffic light approach			*/
+/*                                                                          */
+/*  Version of 2022-06	                              Fernando V. Monteiro  */
+/*==========================================================================*/
+
+#pragma once
+
+#include <array>
+#include <fstream>
+#include <string>
+#include <unordered_map>
+
+#include "TrafficLight.h"
+
+/* Aggregates the arrival and crossing events generated by vehicles into
+KPIs binned by traffic light cycle. Each traffic light keeps only a few
+cycle bins in memory. When a bin is reused by a later cycle, its values are
+written as one row of the KPI table, so memory does not grow with the
+simulation duration. */
+class TrafficLightKpiCollector
+{
+public:
+	/* Sums over all traffic lights since the last reset */
+	struct RunTotals {
+		long throughput{ 0 };
+		long arrivals_on_green{ 0 };
+		long arrivals_on_red{ 0 };
+		long number_of_stops{ 0 };
+		double total_control_delay{ 0.0 };
+	};
+
+	TrafficLightKpiCollector() = default;
+	~TrafficLightKpiCollector();
+
+	/* Allocates the bins of all traffic lights. Events of traffic lights
+	that were not registered are ignored. */
+	void register_traffic_lights(
+		const std::unordered_map<int, TrafficLight>& traffic_lights);
+	void add_event(const TrafficLightEvent& event,
+		const std::unordered_map<int, TrafficLight>& traffic_lights);
+	/* Writes all bins still in memory and closes the table */
+	void write_remaining_bins();
+	const RunTotals& get_run_totals() const { return run_totals; };
+	void reset_run_totals() { run_totals = RunTotals(); };
+	/* Written in every row, since the table keeps the results of all
+	runs */
+	void set_run_id(const std::string& run_id) { this->run_id = run_id; };
+
+private:
+	struct CycleBin {
+		long cycle{ -1 }; // -1 means empty bin
+		int throughput{ 0 };
+		int arrivals_on_green{ 0 };
+		/* Arrivals during amber are counted as arrivals on red */
+		int arrivals_on_red{ 0 };
+		int number_of_stops{ 0 };
+		double total_control_delay{ 0.0 };
+		int travel_time_samples{ 0 };
+		double total_travel_time{ 0.0 };
+	};
+	static const int n_bins{ 4 };
+	struct ApproachKpis {
+		double cycle_time{ 0.0 };
+		std::array<CycleBin, n_bins> bins;
+	};
+
+	CycleBin* get_bin(int traffic_light_id, double time);
+	void write_bin(int traffic_light_id, const ApproachKpis& approach,
+		const CycleBin& bin);
+
+	std::unordered_map<int, ApproachKpis> approaches;
+	RunTotals run_totals;
+	std::string run_id;
+	std::ofstream kpi_table;
+	const char* kpi_table_file_name{ "traffic_light_kpis.csv" };
+};
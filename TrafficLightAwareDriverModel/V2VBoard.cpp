@@ -0,0 +1,81 @@
+#include "V2VBoard.h"
+
+V2VBoard::V2VBoard(bool read_current_step) :
+	read_current_step{ read_current_step } {}
+
+void V2VBoard::start_step(double time)
+{
+	if (time == current_time) return;
+	previous_time = current_time;
+	current_time = time;
+	current_buffer = 1 - current_buffer;
+}
+
+void V2VBoard::add_vehicle(long id)
+{
+	if (id < 0) return;
+	size_t page_index = static_cast<size_t>(id / page_size);
+	for (std::vector<Page>& buffer : buffers)
+	{
+		if (buffer.size() <= page_index) buffer.resize(page_index + 1);
+		if (buffer[page_index] == nullptr)
+		{
+			buffer[page_index] = Page(new Message[page_size]);
+		}
+	}
+}
+
+void V2VBoard::publish(long id, const Message& message)
+{
+	Message* slot = find(buffers[current_buffer], id);
+	if (slot == nullptr) return;
+	*slot = message;
+	slot->time = current_time;
+}
+
+const V2VBoard::Message* V2VBoard::read(long id) const
+{
+	if (read_current_step)
+	{
+		const Message* message = find(buffers[current_buffer], id);
+		if (message != nullptr && message->time == current_time
+			&& current_time >= 0)
+		{
+			return message;
+		}
+	}
+	const Message* message = find(buffers[1 - current_buffer], id);
+	if (message != nullptr && message->time == previous_time
+		&& previous_time >= 0)
+	{
+		return message;
+	}
+	return nullptr;
+}
+
+void V2VBoard::clear()
+{
+	/* Keeps the pages for the next run */
+	for (std::vector<Page>& buffer : buffers)
+	{
+		for (Page& page : buffer)
+		{
+			if (page == nullptr) continue;
+			for (long i = 0; i < page_size; i++) page[i] = Message();
+		}
+	}
+	current_time = -1.0;
+	previous_time = -1.0;
+}
+
+V2VBoard::Message* V2VBoard::find(const std::vector<Page>& buffer,
+	long id) const
+{
+	if (id < 0) return nullptr;
+	size_t page_index = static_cast<size_t>(id / page_size);
+	if (page_index >= buffer.size() || buffer[page_index] == nullptr)
+	{
+		return nullptr;
+	}
+	return &buffer[page_index][id % page_size];
+}
@@ -0,0 +1,82 @@
+/*==========================================================================*/
+/*  V2VBoard.h																*/
+/*  In-process exchange of intents between connected vehicles				*/
+/*                                                                          */
+/*  Version of 2022-06	                              Fernando V. Monteiro  */
+/*==========================================================================*/
+
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#include "LongitudinalControllerWithTrafficLights.h"
+
+/* Connected vehicles publish their commanded acceleration and a short
+horizon intent right after computing them, and connected followers read
+their leader's message instead of the acceleration reported by VISSIM,
+which is one step old. The message is only fresher than that when the
+leader published in the current step before the follower read it, which
+requires read_current_step = true and sequential evaluation with the
+leader first. Messages of the previous step carry the same information as
+VISSIM's acceleration.
+
+Messages are stored in two buffers, one for the current step and one for
+the previous step; start_step swaps their roles. Each buffer is an array
+indexed by vehicle id, split into pages allocated when the first vehicle of
+the page is added, so lookups do not hash and unused id ranges cost
+nothing. Every message carries the time it was published, so messages of
+vehicles that left are never taken for fresh ones.
+
+Reads do not lock. Writes to the current step only touch the writer's own
+message. When vehicles are evaluated in parallel, the board must be created
+with read_current_step = false: readers then only see the previous step,
+which no one writes during the step, and the results do not depend on the
+evaluation order, but followers gain nothing over VISSIM's acceleration. */
+class V2VBoard
+{
+public:
+	struct Message {
+		double time{ -1.0 }; // when it was published, set by the board [s]
+		double velocity{ 0.0 }; // [m/s]
+		double acceleration{ 0.0 }; // commanded [m/s^2]
+		/* Intent: velocity at the end of the horizon if the commanded
+		acceleration is kept [m/s] */
+		double horizon_velocity{ 0.0 };
+		LongitudinalControllerWithTrafficLights::State controller_mode{
+			LongitudinalControllerWithTrafficLights::State::max_accel };
+	};
+
+	static constexpr double intent_horizon{ 1.0 }; // [s]
+
+	/* read_current_step: whether readers may see messages published in the
+	current step (only if vehicles are evaluated sequentially) */
+	explicit V2VBoard(bool read_current_step);
+
+	/* Must be called when the simulation time changes, before any vehicle
+	of the new step publishes */
+	void start_step(double time);
+	/* Allocates the vehicle's message. Must be called before the vehicle
+	publishes, and not while vehicles are evaluated in parallel. */
+	void add_vehicle(long id);
+	/* Ignored if the vehicle was not added */
+	void publish(long id, const Message& message);
+	/* Freshest message of the vehicle, or nullptr if it did not publish in
+	the current (if allowed) or previous step */
+	const Message* read(long id) const;
+	/* Discards all messages (new simulation run) */
+	void clear();
+
+private:
+	static const long page_size{ 1024 }; // messages
+	using Page = std::unique_ptr<Message[]>;
+
+	Message* find(const std::vector<Page>& buffer, long id) const;
+
+	bool read_current_step{ true };
+	/* The current step writes to buffers[current_buffer] */
+	std::vector<Page> buffers[2];
+	int current_buffer{ 0 };
+	double current_time{ -1.0 };
+	double previous_time{ -1.0 };
+};
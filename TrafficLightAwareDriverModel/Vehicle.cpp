@@ -35,7 +35,8 @@ void Vehicle::set_category(long category)
 
 bool Vehicle::is_a_connected_type(VehicleType vehicle_type) const 
 {
-	return vehicle_type == VehicleType::traffic_light_cacc_car;
+	return vehicle_type == VehicleType::traffic_light_cacc_car
+		|| vehicle_type == VehicleType::platoon_car;
 }
 
 bool Vehicle::has_lane_change_intention() const 
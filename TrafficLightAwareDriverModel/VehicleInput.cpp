@@ -0,0 +1,246 @@
+#include "AllocationCounter.h"
+#include "DriverModel.h"
+#include "EgoVehicle.h"
+#include "VehicleInput.h"
+
+static_assert(DRIVER_DATA_ALLOW_MULTITHREADING < 1024,
+	"The dispatch table must hold all data types");
+
+const std::array<VehicleInput::Entry, VehicleInput::table_size>
+VehicleInput::table = VehicleInput::build_table();
+
+bool VehicleInput::is_vehicle_input(long type)
+{
+	return type >= 0 && type < table_size
+		&& table[type].target != Target::none;
+}
+
+bool VehicleInput::is_nearby_vehicle_input(long type)
+{
+	return type >= 0 && type < table_size
+		&& table[type].subsystem
+		== AllocationCounter::Subsystem::nearby_vehicles;
+}
+
+std::array<VehicleInput::Entry, VehicleInput::table_size>
+VehicleInput::build_table()
+{
+	std::array<Entry, table_size> table;
+	Handler reject = [](Cursor&, const Value&) { return 0; };
+	Handler accept = [](Cursor&, const Value&) { return 1; };
+	for (Entry& entry : table) entry.handler = reject;
+
+	auto add_ego_input = [&table](long type, Handler handler) {
+		table[type] = Entry{ handler, Target::ego_vehicle,
+			AllocationCounter::Subsystem::histories };
+	};
+	auto add_nearby_input = [&table](long type, Handler handler) {
+		table[type] = Entry{ handler, Target::nearby_vehicle,
+			AllocationCounter::Subsystem::nearby_vehicles };
+	};
+
+	/* Ego vehicle -------------------------------------------------------- */
+	add_ego_input(DRIVER_DATA_VEH_LANE, [](Cursor& c, const Value& v) {
+		c.ego_vehicle->set_lane(v.long_value);
+		return 1;
+	});
+	add_ego_input(DRIVER_DATA_VEH_ODOMETER, [](Cursor& c, const Value& v) {
+		c.ego_vehicle->set_odometer(v.double_value);
+		return 1;
+	});
+	add_ego_input(DRIVER_DATA_VEH_LATERAL_POSITION,
+		[](Cursor& c, const Value& v) {
+		c.ego_vehicle->set_lateral_position(v.double_value);
+		return 1;
+	});
+	add_ego_input(DRIVER_DATA_VEH_X_COORDINATE,
+		[](Cursor& c, const Value& v) {
+		c.ego_vehicle->set_front_x(v.double_value);
+		return 1;
+	});
+	add_ego_input(DRIVER_DATA_VEH_Y_COORDINATE,
+		[](Cursor& c, const Value& v) {
+		c.ego_vehicle->set_front_y(v.double_value);
+		return 1;
+	});
+	add_ego_input(DRIVER_DATA_VEH_REAR_X_COORDINATE,
+		[](Cursor& c, const Value& v) {
+		c.ego_vehicle->set_rear_x(v.double_value);
+		return 1;
+	});
+	add_ego_input(DRIVER_DATA_VEH_REAR_Y_COORDINATE,
+		[](Cursor& c, const Value& v) {
+		c.ego_vehicle->set_rear_y(v.double_value);
+		return 1;
+	});
+	add_ego_input(DRIVER_DATA_VEH_VELOCITY, [](Cursor& c, const Value& v) {
+		c.ego_vehicle->set_velocity(v.double_value);
+		return 1;
+	});
+	add_ego_input(DRIVER_DATA_VEH_ACCELERATION,
+		[](Cursor& c, const Value& v) {
+		c.ego_vehicle->set_acceleration(v.double_value);
+		return 1;
+	});
+	add_ego_input(DRIVER_DATA_VEH_LENGTH, [](Cursor& c, const Value& v) {
+		c.ego_vehicle->set_length(v.double_value);
+		return 1;
+	});
+	add_ego_input(DRIVER_DATA_VEH_WIDTH, [](Cursor& c, const Value& v) {
+		c.ego_vehicle->set_width(v.double_value);
+		return 1;
+	});
+	add_ego_input(DRIVER_DATA_VEH_TURNING_INDICATOR,
+		[](Cursor& c, const Value& v) {
+		c.ego_vehicle->set_turning_indicator(v.long_value);
+		return 1;
+	});
+	add_ego_input(DRIVER_DATA_VEH_CATEGORY, [](Cursor& c, const Value& v) {
+		c.ego_vehicle->set_category(v.long_value);
+		return 1;
+	});
+	add_ego_input(DRIVER_DATA_VEH_PREFERRED_REL_LANE,
+		[](Cursor& c, const Value& v) {
+		c.ego_vehicle->set_preferred_relative_lane(v.long_value);
+		return 1;
+	});
+	add_ego_input(DRIVER_DATA_VEH_USE_PREFERRED_LANE,
+		[](Cursor& c, const Value& v) {
+		c.ego_vehicle->set_vissim_use_preferred_lane(v.long_value);
+		return 1;
+	});
+	add_ego_input(DRIVER_DATA_VEH_CURRENT_LINK,
+		[](Cursor& c, const Value& v) {
+		c.ego_vehicle->set_link(v.long_value);
+		/* Returning 0 avoids getting sent lots of DRIVER_DATA_VEH_NEXT_LINKS
+		messages. DriverModelSetValue returns 1 instead when there is a
+		signal graph, which needs the routes. */
+		return 0;
+	});
+	add_ego_input(DRIVER_DATA_VEH_NEXT_LINKS,
+		[](Cursor& c, const Value& v) {
+		c.ego_vehicle->add_next_link(v.long_value);
+		return 1;
+	});
+	add_ego_input(DRIVER_DATA_VEH_ACTIVE_LANE_CHANGE,
+		[](Cursor& c, const Value& v) {
+		c.ego_vehicle->set_active_lane_change_direction(v.long_value);
+		return 1;
+	});
+	add_ego_input(DRIVER_DATA_LANE_END_DISTANCE,
+		[](Cursor& c, const Value& v) {
+		c.ego_vehicle->set_lane_end_distance(v.double_value, v.index1);
+		return 1;
+	});
+	add_ego_input(DRIVER_DATA_SIGNAL_DISTANCE,
+		[](Cursor& c, const Value& v) {
+		c.ego_vehicle->read_traffic_light(v.index1, v.double_value);
+		return 1;
+	});
+	add_ego_input(DRIVER_DATA_DESIRED_ACCELERATION,
+		[](Cursor& c, const Value& v) {
+		c.ego_vehicle->set_vissim_acceleration(v.double_value);
+		return 1;
+	});
+	add_ego_input(DRIVER_DATA_DESIRED_LANE_ANGLE,
+		[](Cursor& c, const Value& v) {
+		c.ego_vehicle->set_desired_lane_angle(v.double_value);
+		return 1;
+	});
+	add_ego_input(DRIVER_DATA_REL_TARGET_LANE,
+		[](Cursor& c, const Value& v) {
+		/* Apparently this is VISSIM's suggestion of target lane */
+		c.ego_vehicle->set_relative_target_lane(v.long_value);
+		return 1;
+	});
+
+	/* Nearby vehicles ---------------------------------------------------- */
+	/* Moves the cursor to a new nearby vehicle, owned by the ego vehicle */
+	add_ego_input(DRIVER_DATA_NVEH_ID, [](Cursor& c, const Value& v) {
+		c.nearby_vehicle = v.long_value > 0 ?
+			c.ego_vehicle->emplace_nearby_vehicle(v.long_value, v.index1,
+				v.index2)
+			: nullptr;
+		return 1;
+	});
+	table[DRIVER_DATA_NVEH_ID].subsystem =
+		AllocationCounter::Subsystem::nearby_vehicles;
+	add_nearby_input(DRIVER_DATA_NVEH_LATERAL_POSITION,
+		[](Cursor& c, const Value& v) {
+		c.nearby_vehicle->set_lateral_position(v.double_value);
+		return 1;
+	});
+	add_nearby_input(DRIVER_DATA_NVEH_DISTANCE,
+		[](Cursor& c, const Value& v) {
+		c.nearby_vehicle->set_distance(v.double_value);
+		return 1;
+	});
+	add_nearby_input(DRIVER_DATA_NVEH_REL_VELOCITY,
+		[](Cursor& c, const Value& v) {
+		c.nearby_vehicle->set_relative_velocity(v.double_value);
+		return 1;
+	});
+	add_nearby_input(DRIVER_DATA_NVEH_ACCELERATION,
+		[](Cursor& c, const Value& v) {
+		c.nearby_vehicle->set_acceleration(v.double_value);
+		return 1;
+	});
+	add_nearby_input(DRIVER_DATA_NVEH_LENGTH, [](Cursor& c, const Value& v) {
+		c.nearby_vehicle->set_length(v.double_value);
+		return 1;
+	});
+	add_nearby_input(DRIVER_DATA_NVEH_WIDTH, [](Cursor& c, const Value& v) {
+		c.nearby_vehicle->set_width(v.double_value);
+		return 1;
+	});
+	add_nearby_input(DRIVER_DATA_NVEH_CATEGORY,
+		[](Cursor& c, const Value& v) {
+		c.nearby_vehicle->set_category(v.long_value);
+		return 1;
+	});
+	add_nearby_input(DRIVER_DATA_NVEH_LANE_CHANGE,
+		[](Cursor& c, const Value& v) {
+		c.nearby_vehicle->set_lane_change_direction(v.long_value);
+		return 1;
+	});
+	add_nearby_input(DRIVER_DATA_NVEH_TYPE, [](Cursor& c, const Value& v) {
+		c.nearby_vehicle->set_type(VehicleType(v.long_value),
+			c.ego_vehicle->get_type());
+		return 1;
+	});
+
+	/* Data not used by the model ----------------------------------------- */
+	const long ignored_types[] = {
+		DRIVER_DATA_VEH_LANE_ANGLE,
+		DRIVER_DATA_VEH_WEIGHT,
+		DRIVER_DATA_VEH_MAX_ACCELERATION,
+		DRIVER_DATA_VEH_Z_COORDINATE,
+		DRIVER_DATA_VEH_REAR_Z_COORDINATE,
+		/* We define the vehicle color instead */
+		DRIVER_DATA_VEH_COLOR,
+		DRIVER_DATA_VEH_REL_TARGET_LANE,
+		DRIVER_DATA_VEH_INTAC_STATE,
+		DRIVER_DATA_VEH_INTAC_TARGET_TYPE,
+		DRIVER_DATA_VEH_INTAC_TARGET_ID,
+		DRIVER_DATA_VEH_INTAC_HEADWAY,
+		DRIVER_DATA_VEH_UDA,
+		DRIVER_DATA_NVEH_LANE_ANGLE,
+		DRIVER_DATA_NVEH_WEIGHT,
+		DRIVER_DATA_NVEH_TURNING_INDICATOR,
+		DRIVER_DATA_NVEH_UDA,
+		DRIVER_DATA_NO_OF_LANES,
+		DRIVER_DATA_LANE_WIDTH,
+		DRIVER_DATA_RADIUS,
+		DRIVER_DATA_MIN_RADIUS,
+		DRIVER_DATA_DIST_TO_MIN_RADIUS,
+		DRIVER_DATA_SLOPE,
+		DRIVER_DATA_SLOPE_AHEAD,
+		DRIVER_DATA_SPEED_LIMIT_DISTANCE,
+		DRIVER_DATA_SPEED_LIMIT_VALUE,
+		/* Behavior data suggested by VISSIM's internal model */
+		DRIVER_DATA_ACTIVE_LANE_CHANGE,
+	};
+	for (long type : ignored_types) table[type].handler = accept;
+
+	return table;
+}
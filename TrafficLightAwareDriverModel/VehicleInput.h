@@ -0,0 +1,98 @@
+/*==========================================================================*/
+/*  VehicleInput.h															*/
+/*  Applies vehicle related data sent by VISSIM to an ego vehicle			*/
+/*                                                                          */
+/*  Version of 2022-06	                              Fernando V. Monteiro  */
+/*==========================================================================*/
+
+#pragma once
+
+#include <array>
+
+#include "AllocationCounter.h"
+
+class EgoVehicle;
+class NearbyVehicle;
+
+/* Vehicle and nearby vehicle data set by VISSIM through DriverModelSetValue.
+Kept apart from the DLL interface so that the same code can apply data
+coming from VISSIM or from a recorded run.
+
+Data types are dispatched through a table indexed by the DRIVER_DATA_*
+code, built once when the DLL is loaded. Data types the model does not use
+point to a handler that does nothing. The inputs are applied to the
+vehicles in a cursor: the ego vehicle is set once per vehicle (at
+DRIVER_DATA_VEH_ID) and the nearby vehicle once per nearby vehicle (at
+DRIVER_DATA_NVEH_ID), so the following inputs do not look them up again.
+To handle a new data type, add its handler to build_table. */
+class VehicleInput
+{
+public:
+	/* Targets of the inputs */
+	struct Cursor {
+		EgoVehicle* ego_vehicle{ nullptr };
+		NearbyVehicle* nearby_vehicle{ nullptr };
+	};
+	struct Value {
+		long index1{ 0 };
+		long index2{ 0 };
+		long long_value{ 0 };
+		double double_value{ 0.0 };
+	};
+	/* Same return convention as DriverModelSetValue */
+	using Handler = int (*)(Cursor& cursor, const Value& value);
+
+	/* True if the data type changes the ego vehicle or its nearby
+	vehicles (ignored data types excluded) */
+	static bool is_vehicle_input(long type);
+	/* True if the data type refers to a nearby vehicle */
+	static bool is_nearby_vehicle_input(long type);
+
+	/* The vehicle may be null if it was not created yet */
+	void set_ego_vehicle(EgoVehicle* ego_vehicle) {
+		cursor.ego_vehicle = ego_vehicle;
+		cursor.nearby_vehicle = nullptr;
+	};
+	EgoVehicle* get_ego_vehicle() const { return cursor.ego_vehicle; };
+	/* Returns 0 for data types without handler. Inputs for a missing
+	vehicle are ignored. */
+	int set_value(long type, long index1, long index2, long long_value,
+		double double_value);
+
+private:
+	enum class Target {
+		none, // ignored data types
+		ego_vehicle,
+		nearby_vehicle,
+	};
+	struct Entry {
+		Handler handler{ nullptr };
+		Target target{ Target::none };
+		AllocationCounter::Subsystem subsystem{
+			AllocationCounter::Subsystem::other };
+	};
+	/* Larger than the largest DRIVER_DATA_* code */
+	static const long table_size{ 1024 };
+
+	static std::array<Entry, table_size> build_table();
+	static const std::array<Entry, table_size> table;
+
+	Cursor cursor;
+};
+
+inline int VehicleInput::set_value(long type, long index1, long index2,
+	long long_value, double double_value)
+{
+	if (type < 0 || type >= table_size) return 0;
+	const Entry& entry = table[type];
+	if ((entry.target == Target::ego_vehicle
+		&& cursor.ego_vehicle == nullptr)
+		|| (entry.target == Target::nearby_vehicle
+			&& cursor.nearby_vehicle == nullptr))
+	{
+		return 1;
+	}
+	AllocationCounter::Scope scope{ entry.subsystem };
+	return entry.handler(cursor,
+		Value{ index1, index2, long_value, double_value });
+}
@@ -0,0 +1,58 @@
+#include <mutex>
+#include <new>
+#include <unordered_map>
+#include <vector>
+
+#include "VehicleMemoryPool.h"
+
+namespace
+{
+struct FreeLists {
+	std::mutex mutex;
+	std::unordered_map<size_t, std::vector<void*>> blocks_by_size;
+};
+
+/* Never destroyed: vehicles owned by static objects of other translation
+units may be destroyed after this one's statics */
+FreeLists& get_free_lists()
+{
+	static FreeLists* free_lists = new FreeLists();
+	return *free_lists;
+}
+}
+
+void* VehicleMemoryPool::allocate(size_t size)
+{
+	FreeLists& free_lists = get_free_lists();
+	{
+		std::lock_guard<std::mutex> lock(free_lists.mutex);
+		std::vector<void*>& blocks = free_lists.blocks_by_size[size];
+		if (!blocks.empty())
+		{
+			void* pointer = blocks.back();
+			blocks.pop_back();
+			return pointer;
+		}
+	}
+	return ::operator new(size);
+}
+
+void VehicleMemoryPool::deallocate(void* pointer, size_t size)
+{
+	if (pointer == nullptr) return;
+	FreeLists& free_lists = get_free_lists();
+	std::lock_guard<std::mutex> lock(free_lists.mutex);
+	free_lists.blocks_by_size[size].push_back(pointer);
+}
+
+size_t VehicleMemoryPool::get_n_free_blocks()
+{
+	FreeLists& free_lists = get_free_lists();
+	std::lock_guard<std::mutex> lock(free_lists.mutex);
+	size_t n_blocks = 0;
+	for (const auto& pair : free_lists.blocks_by_size)
+	{
+		n_blocks += pair.second.size();
+	}
+	return n_blocks;
+}
@@ -0,0 +1,26 @@
+/*==========================================================================*/
+/*  VehicleMemoryPool.h														*/
+/*  Recycles the memory of destroyed vehicle objects						*/
+/*                                                                          */
+/*  Version of 2022-06	                              Fernando V. Monteiro  */
+/*==========================================================================*/
+
+#pragma once
+
+#include <cstddef>
+
+/* Free lists of memory blocks, one per block size. When a vehicle object
+is destroyed its block is kept for the next vehicle of the same size
+instead of being returned to the heap. Since there are only a few vehicle
+classes, blocks are reused by vehicles created later in the same run and
+by all the vehicles of the following runs in the same VISSIM session:
+after the first run, creating vehicles does not allocate their objects.
+Blocks are never returned to the operating system. */
+class VehicleMemoryPool
+{
+public:
+	static void* allocate(size_t size);
+	static void deallocate(void* pointer, size_t size);
+	/* Number of blocks waiting to be reused */
+	static size_t get_n_free_blocks();
+};
@@ -0,0 +1,124 @@
+#include <algorithm>
+
+#include "WorkStealingThreadPool.h"
+
+WorkStealingThreadPool::WorkStealingThreadPool(size_t n_threads)
+{
+	if (n_threads == 0)
+	{
+		n_threads = std::max(std::thread::hardware_concurrency(), 1U);
+	}
+	for (size_t i = 0; i < n_threads; i++)
+	{
+		queues.push_back(std::make_unique<TaskQueue>());
+	}
+	/* Worker 0 is the thread calling run */
+	for (size_t i = 1; i < n_threads; i++)
+	{
+		threads.emplace_back(&WorkStealingThreadPool::worker_loop, this, i);
+	}
+}
+
+WorkStealingThreadPool::~WorkStealingThreadPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		is_stopping = true;
+	}
+	batch_started.notify_all();
+	for (std::thread& thread : threads) thread.join();
+}
+
+void WorkStealingThreadPool::run(size_t n_tasks,
+	const std::function<void(size_t)>& task)
+{
+	if (n_tasks == 0) return;
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		current_task = &task;
+		n_unfinished_tasks = n_tasks;
+	}
+	/* Contiguous chunks keep neighboring tasks on the same thread unless
+	they get stolen */
+	size_t n_workers = queues.size();
+	for (size_t w = 0; w < n_workers; w++)
+	{
+		std::lock_guard<std::mutex> lock(queues[w]->mutex);
+		for (size_t i = w * n_tasks / n_workers;
+			i < (w + 1) * n_tasks / n_workers; i++)
+		{
+			queues[w]->task_indices.push_back(i);
+		}
+	}
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		batch_number++;
+	}
+	batch_started.notify_all();
+
+	execute_tasks(0);
+
+	std::unique_lock<std::mutex> lock(mutex);
+	batch_finished.wait(lock, [this] { return n_unfinished_tasks == 0; });
+	current_task = nullptr;
+}
+
+void WorkStealingThreadPool::worker_loop(size_t worker_index)
+{
+	size_t last_batch_number = 0;
+	while (true)
+	{
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			batch_started.wait(lock, [this, last_batch_number] {
+				return is_stopping || batch_number != last_batch_number; });
+			if (is_stopping) return;
+			last_batch_number = batch_number;
+		}
+		execute_tasks(worker_index);
+	}
+}
+
+void WorkStealingThreadPool::execute_tasks(size_t worker_index)
+{
+	size_t n_finished = 0;
+	size_t task_index;
+	while (take_task(worker_index, task_index))
+	{
+		(*current_task)(task_index);
+		n_finished++;
+	}
+	if (n_finished == 0) return;
+
+	std::lock_guard<std::mutex> lock(mutex);
+	n_unfinished_tasks -= n_finished;
+	if (n_unfinished_tasks == 0) batch_finished.notify_all();
+}
+
+bool WorkStealingThreadPool::take_task(size_t worker_index,
+	size_t& task_index)
+{
+	{
+		TaskQueue& own_queue = *queues[worker_index];
+		std::lock_guard<std::mutex> lock(own_queue.mutex);
+		if (!own_queue.task_indices.empty())
+		{
+			task_index = own_queue.task_indices.front();
+			own_queue.task_indices.pop_front();
+			return true;
+		}
+	}
+	for (size_t i = 1; i < queues.size(); i++)
+	{
+		TaskQueue& victim = *queues[(worker_index + i) % queues.size()];
+		std::lock_guard<std::mutex> lock(victim.mutex);
+		if (!victim.task_indices.empty())
+		{
+			task_index = victim.task_indices.back();
+			victim.task_indices.pop_back();
+			return true;
+		}
+	}
+	return false;
+}
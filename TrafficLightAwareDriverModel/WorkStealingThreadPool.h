@@ -0,0 +1,55 @@
+/*==========================================================================*/
+/*  WorkStealingThreadPool.h												*/
+/*  Runs batches of independent tasks on a fixed set of threads			*/
+/*                                                                          */
+/*  Version of 2022-06	                              Fernando V. Monteiro  */
+/*==========================================================================*/
+
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/* Each worker owns a queue of task indices. Workers take tasks from the
+front of their own queue and, once it is empty, steal from the back of the
+other queues, so a few expensive tasks do not leave the other threads idle.
+The thread calling run also works on the batch, so a pool with one thread
+runs everything sequentially on the calling thread. */
+class WorkStealingThreadPool
+{
+public:
+	/* n_threads = 0 uses one thread per hardware core */
+	explicit WorkStealingThreadPool(size_t n_threads);
+	~WorkStealingThreadPool();
+
+	size_t get_n_threads() const { return queues.size(); };
+	/* Calls task(i) for i = 0, ..., n_tasks - 1 and returns after all
+	calls have finished. Tasks may run in any order and must not depend
+	on each other. */
+	void run(size_t n_tasks, const std::function<void(size_t)>& task);
+
+private:
+	struct TaskQueue {
+		std::mutex mutex;
+		std::deque<size_t> task_indices;
+	};
+
+	void worker_loop(size_t worker_index);
+	void execute_tasks(size_t worker_index);
+	bool take_task(size_t worker_index, size_t& task_index);
+
+	std::vector<std::unique_ptr<TaskQueue>> queues;
+	std::vector<std::thread> threads;
+	std::mutex mutex;
+	std::condition_variable batch_started;
+	std::condition_variable batch_finished;
+	const std::function<void(size_t)>* current_task{ nullptr };
+	size_t batch_number{ 0 };
+	size_t n_unfinished_tasks{ 0 };
+	bool is_stopping{ false };
+};